@@ -0,0 +1,71 @@
+# EmbedShaders.cmake
+# Writes compiled SPIR-V modules into a C++ header as constexpr arrays
+#
+# Run in script mode:
+#   cmake -DOUTPUT=<header> -DSPIRV_DIR=<dir> -DSHADERS=<name,name> -P EmbedShaders.cmake
+# Each name is a shader file name from shaders/ (e.g. copy.frag), compiled
+# to <SPIRV_DIR>/<name>.spv.
+
+if(NOT OUTPUT OR NOT SPIRV_DIR OR NOT SHADERS)
+    message(FATAL_ERROR "EmbedShaders.cmake needs OUTPUT, SPIRV_DIR and SHADERS")
+endif()
+string(REPLACE "," ";" SHADERS "${SHADERS}")
+
+# Eight words per line; CMake regexes have no {n} repetition
+string(REPEAT "0x........, " 8 LINE_OF_WORDS)
+
+set(ARRAYS "")
+set(TABLE "")
+
+foreach(NAME IN LISTS SHADERS)
+    file(READ "${SPIRV_DIR}/${NAME}.spv" HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+    if(HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${NAME}.spv is not a SPIR-V module")
+    endif()
+
+    # SPIR-V is a stream of little-endian words
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+    string(REGEX REPLACE "(${LINE_OF_WORDS})" "\\1\n    " WORDS "${WORDS}")
+    string(REGEX REPLACE ", \n    $" "" WORDS "${WORDS}")
+    string(REGEX REPLACE ", $" "" WORDS "${WORDS}")
+    string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+
+    string(MAKE_C_IDENTIFIER "${NAME}" IDENTIFIER)
+    string(APPEND ARRAYS "constexpr uint32_t ${IDENTIFIER}[] = {\n    ${WORDS}\n};\n\n")
+    string(APPEND TABLE "    {\"${NAME}\", ${IDENTIFIER}, sizeof(${IDENTIFIER})},\n")
+endforeach()
+
+set(CONTENT "// Generated by cmake/EmbedShaders.cmake from shaders/; do not edit.
+
+#ifndef OFP_RENDERER_EMBEDDED_SHADERS_H
+#define OFP_RENDERER_EMBEDDED_SHADERS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Shaders {
+
+${ARRAYS}struct EmbeddedShader {
+    const char* name;                       // Source file name in shaders/
+    const uint32_t* code;
+    size_t size;                            // In bytes
+};
+
+constexpr EmbeddedShader EMBEDDED_SHADERS[] = {
+${TABLE}};
+
+} // namespace Shaders
+
+#endif // OFP_RENDERER_EMBEDDED_SHADERS_H
+")
+
+# Leave the header untouched when nothing changed, so dependents are not rebuilt
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" PREVIOUS)
+    if(PREVIOUS STREQUAL CONTENT)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${CONTENT}")
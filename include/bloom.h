@@ -0,0 +1,102 @@
+/**
+ * @file bloom.h
+ * @brief Compute-shader bloom for the glare effect
+ *
+ * The scene is bright-passed into a half-resolution mip chain, downsampled
+ * level by level with a 13-tap filter and then upsampled back with a tent
+ * filter, adding each level onto the next larger one. Level 0 ends up with
+ * a wide, smooth bloom at the cost of a few small dispatches.
+ *
+ * Level 0 and the smaller levels are separate transient images: only level
+ * 0 is still needed after the bloom dispatches, so the rest of the chain
+ * can share memory with targets used later in the frame.
+ */
+
+#ifndef OFP_RENDERER_BLOOM_H
+#define OFP_RENDERER_BLOOM_H
+
+#include "platform.h"
+#include <vulkan/vulkan.h>
+#include "transient_pool.h"
+#include <cstdint>
+
+namespace PostProcessing {
+
+/**
+ * @class Bloom
+ * @brief Bloom mip chain and its downsample/upsample pipelines
+ *
+ * Owned by PostProcessor. The chain images stay in VK_IMAGE_LAYOUT_GENERAL
+ * while in use; their contents do not survive between frames.
+ */
+class Bloom {
+public:
+    static const uint32_t MAX_LEVELS = 8;
+
+    Bloom() = default;
+    ~Bloom() { Shutdown(); }
+
+    /**
+     * @param sampler Linear clamp sampler, owned by the caller
+     */
+    bool Initialize(VkDevice device, VkSampler sampler);
+    void Shutdown();
+
+    /**
+     * @brief Declare the chain for a width x height source in the pool
+     */
+    void DeclareTargets(Vulkan::TransientPool& pool, UINT width, UINT height);
+
+    /**
+     * @brief Create views and descriptors once the pool is compiled
+     * @param sources The two images Record() may read, in
+     *        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+     */
+    bool CreateTargets(const Vulkan::TransientPool& pool, const VkImageView sources[2]);
+    void CleanupTargets();
+
+    /**
+     * @brief Record the bloom of sources[source] into GetOutputView()
+     *
+     * Must be called outside a render pass. Ends with a barrier that makes
+     * the result visible to fragment shaders.
+     * @param levels Chain depth, clamped to [1, GetLevelCount()]
+     */
+    void Record(VkCommandBuffer commandBuffer, uint32_t source, uint32_t levels);
+
+    uint32_t ClampLevels(int levels) const;
+    uint32_t GetLevelCount() const { return m_LevelCount; }
+    VkImageView GetOutputView() const { return m_LevelViews[0]; }
+    Vulkan::TransientImage GetLevel0() const { return m_Level0; }
+    Vulkan::TransientImage GetChain() const { return m_Chain; }     // TRANSIENT_IMAGE_NONE with one level
+
+private:
+    bool CreatePipelines();
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+
+    VkShaderModule m_DownsampleShader = VK_NULL_HANDLE;
+    VkShaderModule m_UpsampleShader = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_DownsamplePipeline = VK_NULL_HANDLE;
+    VkPipeline m_UpsamplePipeline = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;     // Recreated per chain
+
+    Vulkan::TransientImage m_Level0 = Vulkan::TRANSIENT_IMAGE_NONE;
+    Vulkan::TransientImage m_Chain = Vulkan::TRANSIENT_IMAGE_NONE;    // Levels 1..
+    VkImage m_Images[2] = {};                           // Level 0, chain
+    VkImageView m_LevelViews[MAX_LEVELS] = {};
+    VkExtent2D m_LevelExtents[MAX_LEVELS] = {};
+    uint32_t m_LevelCount = 0;
+    VkExtent2D m_SourceExtent = {};
+
+    VkDescriptorSet m_SourceSets[2] = {};               // Level 0 from sources[i]
+    VkDescriptorSet m_DownsampleSets[MAX_LEVELS] = {};  // Level i from level i - 1
+    VkDescriptorSet m_UpsampleSets[MAX_LEVELS] = {};    // Level i from level i + 1
+};
+
+} // namespace PostProcessing
+
+#endif // OFP_RENDERER_BLOOM_H
@@ -0,0 +1,124 @@
+/**
+ * @file command_ring.h
+ * @brief Lock-free single-producer, single-consumer ring of bridge calls
+ *
+ * In threaded mode the game thread serializes each D3D8Bridge call into
+ * this ring and the render thread executes it. Records use the trace
+ * layout from d3d8_trace.h (a TraceRecordHeader followed by the payload,
+ * UP geometry inline), padded to 8 bytes. A record that would straddle
+ * the end of the buffer is preceded by a padding record (op 0) and
+ * written at the start instead, so every payload is contiguous.
+ *
+ * The read and write positions are the only shared state. The consumer
+ * sleeps on a condition variable only once the ring has stayed empty for
+ * a while, and the producer takes the mutex only to wake a sleeping
+ * consumer.
+ */
+
+#ifndef OFP_RENDERER_COMMAND_RING_H
+#define OFP_RENDERER_COMMAND_RING_H
+
+#include "d3d8_trace.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace Bridge {
+
+/**
+ * @struct CommandRingStats
+ * @brief Producer-side counters
+ */
+struct CommandRingStats {
+    uint64_t recordCount = 0;
+    uint64_t bytesWritten = 0;              // Including headers and padding
+    uint64_t fullStalls = 0;                // Records that waited for the consumer to free space
+    uint64_t oversizedRecords = 0;          // Larger than half the ring; the producer runs them itself
+};
+
+/**
+ * @class CommandRing
+ * @brief Byte ring with one producer and one consumer thread
+ */
+class CommandRing {
+public:
+    CommandRing() = default;
+    ~CommandRing() { Shutdown(); }
+
+    /**
+     * @param capacity Buffer size; rounded up to a power of two
+     */
+    bool Initialize(size_t capacity);
+    void Shutdown();
+
+    // Producer
+
+    /**
+     * @brief Reserve space for a record, waiting while the ring is full
+     * @return Space for the payload, or nullptr if the record can never fit
+     */
+    uint8_t* BeginRecord(TraceOp op, uint32_t payloadSize);
+
+    /**
+     * @brief Publish the record to the consumer
+     */
+    void EndRecord();
+
+    /**
+     * @brief Wait until the consumer has released every published record
+     */
+    void WaitUntilDrained();
+
+    // Consumer
+
+    /**
+     * @brief Look at the oldest record without removing it
+     * @param size Payload bytes of the record
+     * @return false if the ring is empty
+     */
+    bool Peek(TraceOp& op, const uint8_t*& payload, uint32_t& size);
+
+    /**
+     * @brief Release the record returned by Peek()
+     */
+    void Pop();
+
+    bool IsEmpty() const { return m_ReadPos == m_Tail.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Block until a record arrives, Wake() is called or a short timeout passes
+     */
+    void WaitForData();
+    void Wake();
+
+    const CommandRingStats& GetStats() const { return m_Stats; }
+
+private:
+    static const size_t RECORD_ALIGNMENT = 8;
+    static const uint32_t SPIN_COUNT = 256;
+
+    static size_t Align(size_t size) { return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1); }
+
+    std::vector<uint8_t> m_Buffer;
+    size_t m_Mask = 0;
+
+    // Free-running positions; only their difference and low bits matter.
+    std::atomic<size_t> m_Head{0};          // Consumed up to here, written by the consumer
+    std::atomic<size_t> m_Tail{0};          // Published up to here, written by the producer
+    size_t m_WritePos = 0;                  // Producer: end of the record being written
+    size_t m_ReadPos = 0;                   // Consumer: start of the next record
+    size_t m_PeekSize = 0;                  // Consumer: size of the record returned by Peek()
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::atomic<bool> m_bConsumerWaiting{false};
+
+    CommandRingStats m_Stats;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_COMMAND_RING_H
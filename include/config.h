@@ -9,7 +9,7 @@
 #ifndef OFP_RENDERER_CONFIG_H
 #define OFP_RENDERER_CONFIG_H
 
-#include <Windows.h>
+#include "platform.h"
 #include <string>
 
 namespace Config {
@@ -26,6 +26,13 @@ struct RendererSettings {
     UINT width = 1920;                      // Window width
     UINT height = 1080;                     // Window height
     bool fullscreen = false;                // Fullscreen mode
+    UINT framesInFlight = 2;                // Frames the CPU may record ahead of the GPU (1-3)
+    bool asyncTransfer = true;              // Upload textures on a dedicated transfer queue if the GPU has one
+    bool dynamicRendering = true;           // Render without render passes where the GPU supports it
+    bool timelineSemaphores = true;         // Schedule submits on timeline semaphores and vkQueueSubmit2 where supported
+    std::wstring pipelineCachePath = L"ofp_renderer.pipelinecache";  // On-disk pipeline cache
+    std::wstring pipelineWarmUpPath = L"ofp_renderer.pipelinekeys";  // Render states to pre-build at load
+    std::wstring tracePath;                 // Record D3D8 bridge calls here when set (see ofp_replay)
 };
 
 /**
@@ -41,8 +48,9 @@ struct EffectSettings {
     float hardLightStrength = 0.4f;         // Hard light effect strength
     float desaturationStrength = 0.2f;      // Desaturation strength
     float glareStrength = 0.3f;             // Glare effect strength
-    int glareSize = 3;                      // Glare size (1-8)
+    int glareSize = 6;                      // Bloom mip levels (1-8)
     bool glareDarkenSky = false;            // Darken sky with glare
+    bool fusedPostProcessing = true;        // Run all effects in one full-screen pass
 };
 
 /**
@@ -54,6 +62,12 @@ struct PerformanceSettings {
     bool enableLODBias = false;             // Enable LOD bias adjustment
     float LODBias0 = 0.0f;                  // Texture LOD bias
     float LODBias1 = 0.0f;                  // Multi-texture LOD bias
+    bool showGpuProfiler = false;           // Draw per-pass GPU timing bars
+    std::wstring frameStatsPath = L"ofp_renderer_frametimes.csv";  // Frame-time CSV, empty disables
+    UINT frameStatsHotkey = 0x7A;           // Virtual key that dumps the CSV (F11), 0 disables
+    bool drawBatching = true;               // Merge and instance consecutive same-state draws
+    UINT recordingThreads = 2;              // Threads recording secondary command buffers, 0 records inline
+    bool renderThread = false;              // Execute bridge calls on a dedicated render thread
 };
 
 /**
@@ -79,6 +93,14 @@ public:
     bool Save(const std::wstring& filename = L"ofp_renderer.ini");
     void ResetToDefaults();
     
+    /**
+     * @brief Load the default file unless Load() has already been called
+     *
+     * Called by the renderer during initialization, so a host that loads
+     * its own file, or changes settings after loading, keeps them.
+     */
+    bool EnsureLoaded();
+    
     // Getters
     const RendererSettings& GetRenderer() const { return m_Renderer; }
     const EffectSettings& GetEffects() const { return m_Effects; }
@@ -101,6 +123,7 @@ private:
     EffectSettings m_Effects;
     PerformanceSettings m_Performance;
     ScreenshotSettings m_Screenshot;
+    bool m_bLoadAttempted = false;
 };
 
 } // namespace Config
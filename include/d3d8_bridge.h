@@ -12,9 +12,32 @@
 #include <d3d8.h>
 #include <d3d9.h>
 #include <vulkan/vulkan.h>
+#include "command_ring.h"
+#include "d3d8_trace.h"
+#include "draw_batch.h"
+#include "memory_allocator.h"
+#include "pipeline_state_cache.h"
+#include "texture_convert.h"
+#include "uniform_state.h"
+#include "upload_ring.h"
+#include "upload_scheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace Bridge {
 
+/**
+ * @brief Bridge texture; 0 is never a valid handle
+ *
+ * Handles are handed out by the bridge rather than being Vulkan handles,
+ * so a trace creates the same handles again when it is replayed.
+ */
+typedef uint32_t TextureHandle;
+
 /**
  * @struct State
  * @brief Current rendering state
@@ -30,7 +53,9 @@ struct State {
     VkSampler anisotropySampler = VK_NULL_HANDLE;
     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
-    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;    // Pipeline of the next draw packet
+    PipelineKey pipelineKey;                        // Translated fixed-function state
+    bool pipelineDirty = true;                      // pipelineKey changed since the last bind
     
     VkCommandBuffer currentCommandBuffer = VK_NULL_HANDLE;
     VkFence commandBufferFence = VK_NULL_HANDLE;
@@ -53,10 +78,21 @@ struct State {
  * @brief Translates D3D8 calls to Vulkan
  * 
  * This class provides compatibility between the legacy D3D8 API
- * used by OFP and the modern Vulkan API used for rendering.
+ * used by OFP and the modern Vulkan API used for rendering. Draws are
+ * translated into Vulkan::DrawPacket records for the SceneRecorder,
+ * which records them into command buffers when the frame ends.
+ *
+ * With [Performance] RenderThread=true the entry points only serialize
+ * their arguments into a CommandRing, and a dedicated render thread
+ * executes them. Present() then blocks while the render thread is more
+ * than MAX_FRAME_LAG frames behind. State and statistics getters are
+ * not synchronized with the render thread in that mode.
  */
 class D3D8Bridge {
 public:
+    static const uint32_t MAX_FRAME_LAG = 1;            // Frames the game thread may run ahead
+    static const size_t COMMAND_RING_SIZE = 16 * 1024 * 1024;
+
     static D3D8Bridge& GetInstance();
     
     bool Initialize();
@@ -71,6 +107,44 @@ public:
     void SetRenderTargets(VkImage rt, VkImage ds);
     void SetViewport(const VkViewport& viewport);
     void SetScissor(const VkRect2D& scissor);
+    void SetRenderState(D3DRENDERSTATETYPE state, DWORD value);
+    void SetFVF(DWORD fvf);
+    void SetTransform(D3DTRANSFORMSTATETYPE state, const D3DMATRIX* matrix);
+    void SetMaterial(const D3DMATERIAL8* material);
+    void SetLight(DWORD index, const D3DLIGHT8* light);
+    void LightEnable(DWORD index, BOOL enable);
+    
+    // Textures
+    /**
+     * @brief Create a sampled 2D texture in the D3D8 format's upload format
+     * @param levels Mip levels; 0 for the full chain, as in D3D8
+     * @return 0 if the format has no upload path (see texture_convert.h)
+     */
+    TextureHandle CreateTexture(UINT width, UINT height, UINT levels, D3DFORMAT format);
+    
+    /**
+     * @brief Upload a whole mip level; call from the texture's UnlockRect
+     *
+     * The texels are converted into staging memory and copied on the
+     * UploadScheduler's transfer queue. Only the bytes of each row are
+     * read, so pitch may include the lock's padding.
+     *
+     * @param bits First row of the locked level
+     * @param pitch Bytes between rows (block rows for DXT)
+     * @param palette 256 entries of the current palette, for D3DFMT_P8 only
+     * @return false for an unknown texture or level, or a missing palette
+     */
+    bool UpdateTexture(TextureHandle texture, UINT level, const void* bits, UINT pitch, const PALETTEENTRY* palette);
+    void ReleaseTexture(TextureHandle texture);
+    
+    /**
+     * @brief Build pipelines for known state combinations ahead of time
+     *
+     * Keys seen in earlier sessions are saved on shutdown and passed
+     * here at load time, so the first draw with a given state does not
+     * stall on pipeline compilation.
+     */
+    void WarmUpPipelines(const std::vector<PipelineKey>& keys);
     
     // Drawing
     void Draw(UINT vertexCount, UINT startVertex);
@@ -86,6 +160,17 @@ public:
         UINT vertexStride
     );
     
+    /**
+     * @brief Issue one serialized call through the matching entry point
+     *
+     * Used by the render thread and by ofp_replay. The payload must be
+     * exactly the op's arguments plus any trailing UP geometry.
+     *
+     * @param size Payload bytes
+     * @return false if the op is unknown or the size does not match
+     */
+    bool Dispatch(TraceOp op, const uint8_t* payload, uint32_t size);
+    
     // Frame management
     void Clear(DWORD count, const D3DRECT* rects, DWORD flags, D3DCOLOR color, float z, DWORD stencil);
     void BeginScene();
@@ -95,26 +180,162 @@ public:
     // State access
     State& GetState() { return m_State; }
     const State& GetState() const { return m_State; }
+    const UploadRingStats& GetUploadStats() const { return m_UploadRing.GetStats(); }
+    const PipelineStateCacheStats& GetPipelineStats() const { return m_PipelineCache.GetStats(); }
+    const UniformStats& GetUniformStats() const { return m_Uniforms.GetStats(); }
+    const DrawBatchStats& GetBatchStats() const { return m_Batch.GetStats(); }
+    const CommandRingStats& GetCommandStats() const { return m_Commands.GetStats(); }
+    bool IsThreaded() const { return m_Threaded; }
+    
+    /**
+     * @brief Record every following bridge call to a trace file
+     *
+     * Also started by Initialize() when [Renderer] TracePath is set.
+     * Traces are played back with the ofp_replay tool.
+     */
+    bool StartTrace(const std::wstring& path);
+    void StopTrace();
+    bool IsTracing() const { return m_Trace.IsRecording(); }
     
 private:
     D3D8Bridge() = default;
     ~D3D8Bridge() { Shutdown(); }
     
+    /**
+     * @brief Create the scene shader modules from the embedded SPIR-V
+     */
     bool CreateVertexShader();
     bool CreatePixelShader();
+    void DestroyShaders();
     bool CreateSampler();
-    bool CreateUniformBuffer();
-    void UpdateUniformBuffer();
+    
+    /**
+     * @brief Trace a call and, in threaded mode, queue it for the render thread
+     * @param fill Writes the size-byte payload
+     * @return true if the call was queued and must not run on this thread;
+     *         false for a call too large for the ring, once everything
+     *         queued before it has run
+     */
+    template <typename Fill>
+    bool Capture(TraceOp op, uint32_t size, Fill fill)
+    {
+        if (IsRenderThread()) return false;
+        if (m_Trace.IsRecording())
+        {
+            fill(m_Trace.BeginRecord(op, size));
+            m_Trace.EndRecord();
+        }
+        if (!m_Threaded) return false;
+        
+        uint8_t* record = m_Commands.BeginRecord(op, size);
+        if (!record)
+        {
+            // Keep call order: the render thread finishes the queue, then
+            // the caller runs this one itself.
+            m_Commands.WaitUntilDrained();
+            return false;
+        }
+
+        fill(record);
+        m_Commands.EndRecord();
+        return true;
+    }
+    
+    template <typename T>
+    bool Capture(TraceOp op, const T& payload)
+    {
+        return Capture(op, sizeof(T), [&](uint8_t* data) { memcpy(data, &payload, sizeof(T)); });
+    }
+    
+    bool Capture(TraceOp op) { return Capture(op, 0, [](uint8_t*) {}); }
+    
+    static bool IsRenderThread();
+    bool StartRenderThread();
+    void StopRenderThread();
+    void RenderThread();
+    void WaitForRenderThread();
+    
+    /**
+     * @brief Record the pending draws with the state they were queued under
+     *
+     * Called before anything that changes that state, so callers never
+     * have to know whether a batch is pending.
+     */
+    void FlushBatch();
+    static void OnUniformChange(void* context);
+    
+    struct Texture {
+        VkImage image = VK_NULL_HANDLE;     // Null if creation failed
+        Vulkan::Allocation memory;
+        TextureConversion conversion;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levels = 0;
+        Vulkan::UploadTicket lastUpload = 0;
+    };
+    
+    struct TextureLevel {
+        VkImage image = VK_NULL_HANDLE;
+        TextureConversion conversion;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t rowBytes = 0;              // Of the caller's data, before conversion
+        uint32_t rowCount = 0;              // Block rows for DXT
+    };
+    
+    /**
+     * @return false for an unknown texture or level
+     */
+    bool GetTextureLevel(TextureHandle texture, UINT level, TextureLevel& info);
+    void InsertTexture(const TraceCreateTexture& args, const TextureConversion& conversion);  // m_TextureMutex held
+    bool CreateTextureImage(const TraceCreateTexture& args);
+    bool UploadTextureLevel(TextureHandle texture, UINT level, const void* bits, UINT pitch, const PALETTEENTRY* palette);
+    void ReleaseTextureImage(TextureHandle handle);
+    void RetireTextures();
+    void DestroyTextures();
+    
+    bool SelectPipeline(VkPrimitiveTopology topology);
+    VkPipeline CreatePipeline(const PipelineKey& key);
+    void LoadWarmUpList(std::vector<PipelineKey>& keys);
+    void SaveWarmUpList();
     
     State m_State;
-    VkBuffer m_UniformBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_UniformBufferMemory = VK_NULL_HANDLE;
     
     VkShaderModule m_VertexShaderModule = VK_NULL_HANDLE;
     VkShaderModule m_PixelShaderModule = VK_NULL_HANDLE;
     
+    UploadRing m_UploadRing;                // Vertex/index data of UP draws
+    UniformState m_Uniforms;                // Transforms, material and lights
+    DrawBatch m_Batch;                      // UP draws not recorded yet
+    Math::Matrix4 m_World;                  // D3DTS_WORLD, applied when a batch is recorded
+    PipelineStateCache m_PipelineCache;     // PipelineKey -> VkPipeline
+    TraceWriter m_Trace;
+    
+    // CreateTexture adds entries on the issuing thread before queuing the
+    // call; the executing thread creates their images and removes them on
+    // release, so the table is locked.
+    std::unordered_map<TextureHandle, Texture> m_Textures;
+    std::mutex m_TextureMutex;
+    TextureHandle m_NextTexture = 1;
+    std::vector<Texture> m_RetiredTextures; // Released before a frame took their last upload; executing thread only
+    
+    // Threaded mode
+    CommandRing m_Commands;                 // Game thread -> render thread
+    std::thread m_RenderThread;
+    std::atomic<bool> m_StopRenderThread{false};
+    std::mutex m_FrameMutex;
+    std::condition_variable m_FrameCondition;
+    uint64_t m_PresentsQueued = 0;          // Game thread only
+    uint64_t m_PresentsCompleted = 0;       // Guarded by m_FrameMutex
+    double m_PresentWaitMilliseconds = 0.0; // Game thread blocked on back-pressure
+    bool m_Threaded = false;
+    VkExtent2D m_Extent = {};               // Renderer size the viewport and scissor were set for
+    
     bool m_Initialized = false;
     bool m_InScene = false;
+    bool m_FrameActive = false;             // Between the first BeginScene and Present
+    bool m_BatchingEnabled = true;          // [Performance] DrawBatching
+    bool m_FlushingBatch = false;
 };
 
 } // namespace Bridge
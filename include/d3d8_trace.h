@@ -0,0 +1,215 @@
+/**
+ * @file d3d8_trace.h
+ * @brief Binary capture and playback of D3D8Bridge calls
+ *
+ * A trace is a file header followed by a flat stream of records, one per
+ * bridge entry point. Client-memory geometry of UP draws is stored inline
+ * so a trace replays without the game. Recording appends to an in-memory
+ * chunk on the calling thread; a background thread writes full chunks to
+ * disk, so the game thread never waits on file I/O.
+ */
+
+#ifndef OFP_RENDERER_D3D8_TRACE_H
+#define OFP_RENDERER_D3D8_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Bridge {
+
+const uint32_t TRACE_MAGIC = 0x5450464F;    // "OFPT"
+const uint32_t TRACE_VERSION = 1;
+
+/**
+ * @enum TraceOp
+ * @brief Recorded bridge entry point
+ */
+enum class TraceOp : uint16_t {
+    BeginScene = 1,
+    EndScene,
+    Present,
+    SetRenderState,                         // TraceSetRenderState
+    SetFVF,                                 // uint32_t fvf
+    SetViewport,                            // VkViewport
+    SetScissor,                             // VkRect2D
+    DrawIndexedPrimitiveUP,                 // TraceDrawUP, vertex range, indices
+    SetTransform,                           // TraceSetTransform
+    SetMaterial,                            // D3DMATERIAL8
+    SetLight,                               // uint32_t index, D3DLIGHT8
+    LightEnable,                            // TraceLightEnable
+    CreateTexture,                          // TraceCreateTexture
+    UpdateTexture,                          // TraceUpdateTexture, palette, texels
+    ReleaseTexture                          // uint32_t texture
+};
+
+struct TraceFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;                         // Renderer extent when capture started
+    uint32_t height;
+};
+
+struct TraceRecordHeader {
+    uint16_t op;                            // TraceOp
+    uint16_t reserved;
+    uint32_t size;                          // Payload bytes following this header
+};
+
+struct TraceSetRenderState {
+    uint32_t state;
+    uint32_t value;
+};
+
+/**
+ * @struct TraceDrawUP
+ * @brief Arguments of DrawIndexedPrimitiveUP
+ *
+ * Followed by vertexBytes of vertex data (only the referenced range,
+ * starting at minVertexIndex) and indexBytes of index data.
+ */
+struct TraceDrawUP {
+    uint32_t primitiveType;
+    uint32_t minVertexIndex;
+    uint32_t numVertices;
+    uint32_t primitiveCount;
+    uint32_t indexFormat;
+    uint32_t vertexStride;
+    uint32_t vertexBytes;
+    uint32_t indexBytes;
+};
+
+/**
+ * @struct TraceWriterStats
+ * @brief Capture counters, reported when recording stops
+ */
+struct TraceSetTransform {
+    uint32_t state;                         // D3DTRANSFORMSTATETYPE
+    float matrix[16];
+};
+
+struct TraceLightEnable {
+    uint32_t index;
+    uint32_t enable;
+};
+
+struct TraceCreateTexture {
+    uint32_t texture;                       // Handle returned to the caller
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;                        // Resolved; never 0
+    uint32_t format;                        // D3DFORMAT
+};
+
+/**
+ * @struct TraceUpdateTexture
+ * @brief Arguments of UpdateTexture
+ *
+ * Followed by paletteBytes of PALETTEENTRY values (256 of them for P8,
+ * otherwise none) and dataBytes of the level's texels, with the caller's
+ * row padding removed.
+ */
+struct TraceUpdateTexture {
+    uint32_t texture;
+    uint32_t level;
+    uint32_t paletteBytes;
+    uint32_t dataBytes;
+};
+
+struct TraceWriterStats {
+    uint64_t recordCount = 0;
+    uint64_t bytesWritten = 0;
+    uint32_t chunkCount = 0;                // Chunks handed to the writer thread
+    uint32_t deferredSwaps = 0;             // Times the writer was still busy and the chunk kept growing
+};
+
+/**
+ * @class TraceWriter
+ * @brief Double-buffered trace recorder with a background writer thread
+ *
+ * Records go into the front chunk. Once it holds CHUNK_SIZE bytes it is
+ * swapped with the back chunk, which the writer thread drains to disk.
+ * If the writer has not finished the previous chunk the front one simply
+ * keeps growing; the game thread never waits for the disk.
+ */
+class TraceWriter {
+public:
+    static const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+    TraceWriter() = default;
+    ~TraceWriter() { Stop(); }
+
+    bool Start(const std::wstring& path, uint32_t width, uint32_t height);
+    void Stop();
+    bool IsRecording() const { return m_bRecording; }
+
+    /**
+     * @brief Append a record header and return space for its payload
+     *
+     * The pointer is valid until EndRecord().
+     */
+    uint8_t* BeginRecord(TraceOp op, uint32_t payloadSize);
+    void EndRecord();
+
+    void Record(TraceOp op) { BeginRecord(op, 0); EndRecord(); }
+
+    template <typename T>
+    void Record(TraceOp op, const T& payload)
+    {
+        uint8_t* data = BeginRecord(op, sizeof(T));
+        memcpy(data, &payload, sizeof(T));
+        EndRecord();
+    }
+
+    const TraceWriterStats& GetStats() const { return m_Stats; }
+
+private:
+    void WriterThread();
+
+    std::ofstream m_File;
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+
+    std::vector<uint8_t> m_Front;           // Game thread only
+    std::vector<uint8_t> m_Back;            // Owned by the writer while non-empty
+    bool m_bStopping = false;
+
+    TraceWriterStats m_Stats;
+    bool m_bRecording = false;
+};
+
+/**
+ * @class TraceReader
+ * @brief Sequential reader for trace files
+ */
+class TraceReader {
+public:
+    bool Open(const std::wstring& path);
+    const TraceFileHeader& GetHeader() const { return m_Header; }
+
+    /**
+     * @brief Read the next record
+     * @return false at end of file or on a truncated record
+     */
+    bool Next(TraceOp& op, std::vector<uint8_t>& payload);
+
+    /**
+     * @brief Whether Next() stopped on a short read rather than at end of file
+     */
+    bool IsTruncated() const { return m_bTruncated; }
+
+private:
+    std::ifstream m_File;
+    TraceFileHeader m_Header = {};
+    bool m_bTruncated = false;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_D3D8_TRACE_H
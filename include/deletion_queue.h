@@ -0,0 +1,112 @@
+/**
+ * @file deletion_queue.h
+ * @brief Deferred destruction of Vulkan objects the GPU may still use
+ *
+ * Replacing a resource mid-game (resize, texture streaming, pipeline
+ * eviction) used to mean vkDeviceWaitIdle before destroying the old one.
+ * Instead, retired handles are tagged with the frame being recorded and
+ * destroyed once that frame's fence has signalled, i.e. when the frame
+ * slot comes around again framesInFlight frames later.
+ */
+
+#ifndef OFP_RENDERER_DELETION_QUEUE_H
+#define OFP_RENDERER_DELETION_QUEUE_H
+
+#include "vulkan/vulkan.h"
+#include "memory_allocator.h"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace Vulkan {
+
+/**
+ * @enum DeletionType
+ * @brief Kind of object held by a deletion queue entry
+ */
+enum DeletionType : uint32_t {
+    DELETION_IMAGE = 0,
+    DELETION_IMAGE_VIEW,
+    DELETION_BUFFER,
+    DELETION_MEMORY,                        // Allocation returned to the MemoryAllocator
+    DELETION_PIPELINE,
+    DELETION_FRAMEBUFFER,
+    DELETION_DESCRIPTOR_POOL,
+    DELETION_SWAPCHAIN,
+    DELETION_SEMAPHORE,
+    DELETION_TYPE_COUNT
+};
+
+/**
+ * @class DeletionQueue
+ * @brief Retired handles waiting for the frames that used them
+ *
+ * Non-dispatchable handles are all uint64_t on 32-bit builds, so every
+ * type has its own Destroy*() instead of an overload. Each call takes the
+ * handle by reference and clears it. Thread safe, so loader threads may
+ * retire resources too.
+ */
+class DeletionQueue {
+public:
+    static DeletionQueue& GetInstance();
+
+    void Initialize(VkDevice device, uint32_t framesInFlight);
+
+    /**
+     * @brief Destroy everything still queued; the device must be idle
+     */
+    void Shutdown();
+
+    void DestroyImage(VkImage& image) { Push(DELETION_IMAGE, (uint64_t)image); image = VK_NULL_HANDLE; }
+    void DestroyImageView(VkImageView& view) { Push(DELETION_IMAGE_VIEW, (uint64_t)view); view = VK_NULL_HANDLE; }
+    void DestroyBuffer(VkBuffer& buffer) { Push(DELETION_BUFFER, (uint64_t)buffer); buffer = VK_NULL_HANDLE; }
+    void DestroyPipeline(VkPipeline& pipeline) { Push(DELETION_PIPELINE, (uint64_t)pipeline); pipeline = VK_NULL_HANDLE; }
+    void DestroyFramebuffer(VkFramebuffer& framebuffer) { Push(DELETION_FRAMEBUFFER, (uint64_t)framebuffer); framebuffer = VK_NULL_HANDLE; }
+    void DestroyDescriptorPool(VkDescriptorPool& pool) { Push(DELETION_DESCRIPTOR_POOL, (uint64_t)pool); pool = VK_NULL_HANDLE; }
+    void DestroySwapchain(VkSwapchainKHR& swapChain) { Push(DELETION_SWAPCHAIN, (uint64_t)swapChain); swapChain = VK_NULL_HANDLE; }
+    void DestroySemaphore(VkSemaphore& semaphore) { Push(DELETION_SEMAPHORE, (uint64_t)semaphore); semaphore = VK_NULL_HANDLE; }
+    void FreeMemory(Allocation& allocation);
+
+    /**
+     * @brief Start recording frame `frame` (frames submitted so far)
+     *
+     * Must be called after the frame slot's fence or timeline wait. Destroys what
+     * frames up to frame - framesInFlight retired; those have finished.
+     */
+    void BeginFrame(uint64_t frame);
+
+    /**
+     * @brief Destroy everything now; the device must be idle
+     */
+    void Flush();
+
+    uint32_t GetPendingCount();
+
+private:
+    DeletionQueue() = default;
+    ~DeletionQueue() { Shutdown(); }
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    struct Entry {
+        DeletionType type = DELETION_IMAGE;
+        uint64_t handle = 0;
+        Allocation allocation;              // DELETION_MEMORY only
+        uint64_t frame = 0;                 // Frame being recorded when retired
+    };
+
+    void Push(DeletionType type, uint64_t handle);
+    void Release(Entry& entry);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    uint32_t m_FramesInFlight = 1;
+    uint64_t m_Frame = 0;
+
+    std::deque<Entry> m_Entries;            // Retirement order, so frames never decrease
+    uint64_t m_ReleasedCount = 0;
+    std::mutex m_Mutex;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_DELETION_QUEUE_H
@@ -0,0 +1,112 @@
+/**
+ * @file draw_batch.h
+ * @brief Coalescing of consecutive draws that share all render state
+ *
+ * OFP draws trees, grass and infantry as long runs of small UP draws
+ * with identical state. The bridge adds each draw to a DrawBatch
+ * instead of recording it, and records the batch when a state change,
+ * an incompatible draw or the end of the scene flushes it. Draws join a
+ * batch in one of two ways:
+ *
+ *   Instanced  identical geometry (compared by content, as UP pointers
+ *              are often reused scratch memory) with any world matrix;
+ *              recorded once with one world matrix per instance
+ *   Merged     list topologies with the same world matrix; vertices
+ *              are appended and indices rebased into one indexed draw
+ *
+ * The batch only holds CPU copies; the bridge uploads and records it.
+ */
+
+#ifndef OFP_RENDERER_DRAW_BATCH_H
+#define OFP_RENDERER_DRAW_BATCH_H
+
+#include "vulkan/vulkan.h"
+#include "matrix_math.h"
+#include <cstdint>
+#include <vector>
+
+namespace Bridge {
+
+/**
+ * @struct BatchDraw
+ * @brief One indexed draw over the referenced vertex range
+ */
+struct BatchDraw {
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    const void* vertices = nullptr;         // Vertex minVertexIndex
+    uint32_t vertexCount = 0;
+    uint32_t vertexStride = 0;
+    const void* indices = nullptr;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t minVertexIndex = 0;            // Subtracted from every index
+    const Math::Matrix4* world = nullptr;
+};
+
+/**
+ * @struct DrawBatchStats
+ * @brief Draws received versus draws recorded
+ */
+struct DrawBatchStats {
+    uint64_t drawsIn = 0;
+    uint64_t drawsOut = 0;
+    uint64_t mergedDraws = 0;               // Appended to an earlier draw's geometry
+    uint64_t instancedDraws = 0;            // Recorded as extra instances
+};
+
+class DrawBatch {
+public:
+    static const uint32_t MAX_INSTANCES = 1024;
+    static const uint32_t MAX_VERTEX_BYTES = 1024 * 1024;
+
+    bool IsEmpty() const { return m_DrawCount == 0; }
+
+    /**
+     * @brief Add a draw if it can join the pending draws
+     * @return false if the batch has to be flushed first; an empty batch
+     *         accepts any draw
+     */
+    bool Add(const BatchDraw& draw);
+
+    /**
+     * @brief Empty the batch once the caller has recorded it
+     */
+    void Clear();
+
+    VkPrimitiveTopology GetTopology() const { return m_Topology; }
+    VkIndexType GetIndexType() const { return m_IndexType; }
+    uint32_t GetIndexCount() const { return m_IndexCount; }
+    const std::vector<uint8_t>& GetVertices() const { return m_Vertices; }
+    const std::vector<uint8_t>& GetIndices() const { return m_Indices; }     // Rebased to vertex 0
+
+    /**
+     * @brief One world matrix per instance; a single entry unless instanced
+     */
+    const std::vector<Math::Matrix4>& GetWorlds() const { return m_Worlds; }
+    bool IsInstanced() const { return m_Worlds.size() > 1; }
+
+    const DrawBatchStats& GetStats() const { return m_Stats; }
+
+private:
+    bool CanInstance(const BatchDraw& draw) const;
+    bool CanMerge(const BatchDraw& draw) const;
+    void Append(const BatchDraw& draw);
+
+    VkPrimitiveTopology m_Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkIndexType m_IndexType = VK_INDEX_TYPE_UINT16;
+    uint32_t m_VertexStride = 0;
+    uint32_t m_VertexCount = 0;
+    uint32_t m_IndexCount = 0;
+    uint32_t m_DrawCount = 0;
+    uint32_t m_FirstMinVertexIndex = 0;     // Of the first draw, for instancing comparisons
+
+    std::vector<uint8_t> m_Vertices;
+    std::vector<uint8_t> m_Indices;
+    std::vector<Math::Matrix4> m_Worlds;
+
+    DrawBatchStats m_Stats;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_DRAW_BATCH_H
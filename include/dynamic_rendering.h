@@ -0,0 +1,67 @@
+/**
+ * @file dynamic_rendering.h
+ * @brief Render-pass-free rendering through VK_KHR_dynamic_rendering
+ *
+ * With dynamic rendering, passes begin directly on image views, so there
+ * are no VkRenderPass or VkFramebuffer objects. Pipelines are created
+ * against attachment formats only, and resizing or adding a pass
+ * recreates nothing. The renderer enables it in CreateDevice() when the
+ * device has Vulkan 1.3, or 1.2 plus the KHR extension, and
+ * [Renderer] DynamicRendering is on. Otherwise every caller keeps its
+ * render pass.
+ *
+ * Render passes did the attachment layout transitions themselves. On this
+ * path the caller records them with Transition().
+ */
+
+#ifndef OFP_RENDERER_DYNAMIC_RENDERING_H
+#define OFP_RENDERER_DYNAMIC_RENDERING_H
+
+#include "vulkan/vulkan.h"
+
+namespace Vulkan {
+
+/**
+ * @class DynamicRendering
+ * @brief Entry points of the dynamic rendering path
+ */
+class DynamicRendering {
+public:
+    static DynamicRendering& GetInstance();
+
+    /**
+     * @param core Load the Vulkan 1.3 entry points instead of the KHR ones
+     * @return false if the device does not expose them
+     */
+    bool Initialize(VkDevice device, bool core);
+    void Shutdown();
+
+    bool IsEnabled() const { return m_CmdBeginRendering != nullptr; }
+
+    /**
+     * @brief Begin rendering into a single color attachment
+     * @param clearColor Cleared to this if set, otherwise the old contents are discarded
+     * @param flags VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT or 0
+     */
+    void Begin(VkCommandBuffer commandBuffer, VkImageView view, VkExtent2D extent,
+        const VkClearColorValue* clearColor, VkRenderingFlags flags) const;
+    void End(VkCommandBuffer commandBuffer) const;
+
+    /**
+     * @brief Layout transition of a color image with one mip and one layer
+     */
+    static void Transition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+private:
+    DynamicRendering() = default;
+    DynamicRendering(const DynamicRendering&) = delete;
+    DynamicRendering& operator=(const DynamicRendering&) = delete;
+
+    PFN_vkCmdBeginRendering m_CmdBeginRendering = nullptr;
+    PFN_vkCmdEndRendering m_CmdEndRendering = nullptr;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_DYNAMIC_RENDERING_H
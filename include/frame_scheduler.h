@@ -0,0 +1,120 @@
+/**
+ * @file frame_scheduler.h
+ * @brief Timeline semaphore submits through vkQueueSubmit2
+ *
+ * Every submit gets the next value of one monotonic counter, shared by the
+ * graphics queue and any transfer or compute queue. On completion the
+ * submit signals that value on its queue's timeline semaphore. The CPU
+ * waits for a frame's value instead of a fence. Another queue waits for
+ * the same semaphore and value, with a stage mask that blocks only the
+ * work that needs the result.
+ *
+ * Each queue has its own semaphore because queues finish out of order, and
+ * a timeline may only move forward. Values still come from the shared
+ * counter, so a value names exactly one submit and a newer value always
+ * means newer work.
+ *
+ * The renderer enables the scheduler in CreateDevice() when the device has
+ * timeline semaphores and synchronization2 (Vulkan 1.3, or 1.2 with
+ * VK_KHR_synchronization2), and [Renderer] TimelineSemaphores is on.
+ * Otherwise frames keep their fences and binary semaphores.
+ */
+
+#ifndef OFP_RENDERER_FRAME_SCHEDULER_H
+#define OFP_RENDERER_FRAME_SCHEDULER_H
+
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <mutex>
+
+namespace Vulkan {
+
+/**
+ * @class FrameScheduler
+ * @brief Per-queue timelines on one shared counter
+ *
+ * Submit() may be called from any thread. Queues are added during
+ * initialization only.
+ */
+class FrameScheduler {
+public:
+    static const uint32_t MAX_QUEUES = 4;
+
+    static FrameScheduler& GetInstance();
+
+    /**
+     * @param core Load the Vulkan 1.3 synchronization2 entry points instead of the KHR ones
+     * @return false if the device does not expose them
+     */
+    bool Initialize(VkDevice device, bool core);
+    void Shutdown();
+
+    /**
+     * @brief Create the timeline of a queue; adding a queue twice is allowed
+     */
+    bool AddQueue(VkQueue queue);
+
+    bool IsEnabled() const { return m_bInitialized; }
+
+    /**
+     * @brief Submit one command buffer and signal the next counter value
+     *
+     * The timeline is signalled after all commands. A binary semaphore for
+     * the presentation engine may be signalled with it.
+     *
+     * @param waits Binary semaphores, or timelines from GetTimeline() with their values
+     * @param binarySignal Also signalled, or VK_NULL_HANDLE
+     * @return The value to wait for, 0 if the submit failed
+     */
+    uint64_t Submit(VkQueue queue, const VkSemaphoreSubmitInfo* waits, uint32_t waitCount,
+        VkCommandBuffer commandBuffer, VkSemaphore binarySignal);
+
+    /**
+     * @brief Block until the queue's submit with this value has finished
+     *
+     * The value must come from Submit() on the same queue; 0 returns at once.
+     */
+    bool Wait(VkQueue queue, uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+    bool IsComplete(VkQueue queue, uint64_t value) const;
+
+    /**
+     * @brief Semaphore for GPU waits on the queue's submits
+     */
+    VkSemaphore GetTimeline(VkQueue queue) const;
+
+    /**
+     * @brief vkCmdPipelineBarrier2, where each barrier has its own stage masks
+     */
+    void Barrier(VkCommandBuffer commandBuffer, const VkDependencyInfo& dependency) const;
+
+private:
+    FrameScheduler() = default;
+    ~FrameScheduler() { Shutdown(); }
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    struct QueueTimeline {
+        VkQueue queue = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+    };
+
+    const QueueTimeline* FindQueue(VkQueue queue) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    QueueTimeline m_Queues[MAX_QUEUES];
+    uint32_t m_QueueCount = 0;
+    uint64_t m_LastValue = 0;               // Shared by all queues
+
+    PFN_vkQueueSubmit2 m_QueueSubmit2 = nullptr;
+    PFN_vkCmdPipelineBarrier2 m_CmdPipelineBarrier2 = nullptr;
+    PFN_vkWaitSemaphores m_WaitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValue m_GetSemaphoreCounterValue = nullptr;
+
+    std::mutex m_Mutex;                     // Orders value allocation with the submit
+    bool m_bInitialized = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_FRAME_SCHEDULER_H
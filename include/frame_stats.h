@@ -0,0 +1,135 @@
+/**
+ * @file frame_stats.h
+ * @brief CPU frame timing and frame-pacing statistics
+ *
+ * Renderer::BeginFrame/EndFrame split every frame into phases and push
+ * one FrameTiming into a fixed-size ring. Recording is a handful of clock
+ * reads and stores with no locks or allocation. Percentiles, 1%/0.1% lows
+ * and CSV dumps are computed from the ring on demand.
+ */
+
+#ifndef OFP_RENDERER_FRAME_STATS_H
+#define OFP_RENDERER_FRAME_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace Vulkan {
+
+/**
+ * @enum FramePhase
+ * @brief CPU phases of a frame, in the order they occur
+ */
+enum FramePhase : uint32_t {
+    FRAME_PHASE_FENCE_WAIT = 0,             // Waiting for the frame slot's fence
+    FRAME_PHASE_ACQUIRE_WAIT,               // vkAcquireNextImageKHR and image fence
+    FRAME_PHASE_RECORD,                     // Command recording by the game and bridge
+    FRAME_PHASE_SUBMIT,                     // vkQueueSubmit
+    FRAME_PHASE_PRESENT,                    // vkQueuePresentKHR
+    FRAME_PHASE_COUNT
+};
+
+/**
+ * @struct FrameTiming
+ * @brief One ring entry, in nanoseconds
+ */
+struct FrameTiming {
+    uint64_t frameNumber = 0;
+    int64_t intervalNs = 0;                 // Start of the previous frame to start of this one
+    int64_t phaseNs[FRAME_PHASE_COUNT] = {};
+};
+
+/**
+ * @struct FrameStatsSummary
+ * @brief Statistics over the frames currently in the ring
+ */
+struct FrameStatsSummary {
+    uint32_t frameCount = 0;
+    double avgMs = 0.0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double p999Ms = 0.0;
+    double maxMs = 0.0;
+    double avgFps = 0.0;
+    double onePercentLowFps = 0.0;          // FPS over the slowest 1% of frames
+    double pointOnePercentLowFps = 0.0;     // FPS over the slowest 0.1% of frames
+    double avgPhaseMs[FRAME_PHASE_COUNT] = {};
+};
+
+/**
+ * @class FrameStats
+ * @brief Lock-free ring of frame timings with a log-linear histogram
+ *
+ * Written only by the render thread. Readers take a snapshot through the
+ * atomic head; entries older than the ring size are overwritten.
+ */
+class FrameStats {
+public:
+    static const uint32_t RING_SIZE = 4096;                 // Power of two
+    static const uint32_t HISTOGRAM_SUB_BUCKETS = 16;       // Per power of two, ~6% resolution
+    static const uint32_t HISTOGRAM_BUCKETS = 512;          // Covers 0 us .. >60 s
+
+    static FrameStats& GetInstance();
+
+    /**
+     * @brief Start a frame; also closes the interval of the previous one
+     */
+    void BeginFrame()
+    {
+        int64_t now = Now();
+        m_Current.intervalNs = m_FrameStart ? now - m_FrameStart : 0;
+        m_FrameStart = now;
+        m_PhaseStart = now;
+    }
+
+    /**
+     * @brief End a phase that started at the previous Mark (or BeginFrame)
+     */
+    void Mark(FramePhase phase)
+    {
+        int64_t now = Now();
+        m_Current.phaseNs[phase] = now - m_PhaseStart;
+        m_PhaseStart = now;
+    }
+
+    /**
+     * @brief Publish the frame into the ring and histogram
+     */
+    void EndFrame();
+
+    FrameStatsSummary GetSummary() const;
+
+    /**
+     * @brief Write the ring as CSV, and the histogram next to it as
+     *        <name>_histogram.csv
+     */
+    bool DumpCsv(const std::wstring& path) const;
+
+private:
+    FrameStats() = default;
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint32_t BucketIndex(uint64_t microseconds);
+    static uint64_t BucketLowerBound(uint32_t bucket);
+
+    uint32_t Snapshot(FrameTiming* out) const;
+
+    FrameTiming m_Ring[RING_SIZE];
+    std::atomic<uint64_t> m_Head{0};                        // Frames published
+    std::atomic<uint32_t> m_Histogram[HISTOGRAM_BUCKETS] = {};
+
+    FrameTiming m_Current;
+    int64_t m_FrameStart = 0;
+    int64_t m_PhaseStart = 0;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_FRAME_STATS_H
@@ -0,0 +1,126 @@
+/**
+ * @file gpu_profiler.h
+ * @brief GPU timestamp queries with a per-pass breakdown
+ *
+ * Each frame-in-flight slot owns a query pool. A slot's results are read
+ * when the slot comes around again, after its fence has signalled, so
+ * reading never stalls the CPU or the GPU. The numbers shown are always
+ * one ring cycle old.
+ */
+
+#ifndef OFP_RENDERER_GPU_PROFILER_H
+#define OFP_RENDERER_GPU_PROFILER_H
+
+#include "vulkan/vulkan.h"
+#include "vulkan_renderer.h"
+#include <cstdint>
+
+namespace Vulkan {
+
+/**
+ * @enum GpuPass
+ * @brief Timed regions of a frame
+ */
+enum GpuPass : uint32_t {
+    GPU_PASS_SCENE = 0,
+    GPU_PASS_HARD_LIGHT,
+    GPU_PASS_DESATURATION,
+    GPU_PASS_GLARE,
+    GPU_PASS_POST_FUSED,                    // All enabled effects in one pass
+    GPU_PASS_PRESENT_BLIT,
+    GPU_PASS_COUNT
+};
+
+/**
+ * @struct GpuPassStats
+ * @brief Rolling statistics over the last GpuProfiler::HISTORY_SIZE frames
+ */
+struct GpuPassStats {
+    float minMs = 0.0f;
+    float avgMs = 0.0f;
+    float p99Ms = 0.0f;
+    float lastMs = 0.0f;
+    uint32_t sampleCount = 0;
+};
+
+/**
+ * @class GpuProfiler
+ * @brief Timestamp query pools, one per frame slot
+ */
+class GpuProfiler {
+public:
+    static const uint32_t HISTORY_SIZE = 256;
+
+    static GpuProfiler& GetInstance();
+
+    /**
+     * @return false if the queue family does not support timestamps;
+     *         all other calls are then no-ops
+     */
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t framesInFlight);
+    void Shutdown();
+
+    /**
+     * @brief Collect the slot's previous results and reset its queries
+     *
+     * Must be called after the slot's fence wait and outside a render pass.
+     */
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    /**
+     * @brief Stop timing into the frame's command buffer before it is submitted
+     */
+    void EndFrame();
+
+    void BeginPass(GpuPass pass);
+    void EndPass(GpuPass pass);
+
+    const GpuPassStats& GetStats(GpuPass pass) const { return m_Stats[pass]; }
+    static const char* GetPassName(GpuPass pass);
+
+    bool IsEnabled() const { return m_bInitialized; }
+
+private:
+    GpuProfiler() = default;
+    ~GpuProfiler() { Shutdown(); }
+
+    void CollectResults(uint32_t frameIndex);
+    void UpdateStats(GpuPass pass, float milliseconds);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueryPool m_QueryPools[MAX_FRAMES_IN_FLIGHT] = {};
+    uint32_t m_WrittenPasses[MAX_FRAMES_IN_FLIGHT] = {};   // Bit per GpuPass with both timestamps recorded
+    uint32_t m_OpenPasses = 0;                              // Bit per GpuPass begun but not ended
+
+    VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+    uint32_t m_CurrentFrame = 0;
+    uint32_t m_FramesInFlight = 0;
+    float m_TimestampPeriod = 1.0f;                         // Nanoseconds per tick
+    uint64_t m_TimestampMask = ~0ull;
+
+    float m_History[GPU_PASS_COUNT][HISTORY_SIZE] = {};
+    uint32_t m_HistoryHead[GPU_PASS_COUNT] = {};
+    GpuPassStats m_Stats[GPU_PASS_COUNT];
+
+    bool m_bInitialized = false;
+};
+
+/**
+ * @class GpuScope
+ * @brief Times a pass for the lifetime of the object
+ */
+class GpuScope {
+public:
+    explicit GpuScope(GpuPass pass) : m_Pass(pass) { GpuProfiler::GetInstance().BeginPass(pass); }
+    ~GpuScope() { GpuProfiler::GetInstance().EndPass(m_Pass); }
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+    GpuPass m_Pass;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_GPU_PROFILER_H
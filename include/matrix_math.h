@@ -0,0 +1,70 @@
+/**
+ * @file matrix_math.h
+ * @brief 4x4 matrix operations for transform concatenation
+ *
+ * Matrices use the D3D8 memory layout: row-major, transforming row
+ * vectors (v' = v * M), so D3DMATRIX values can be copied in directly.
+ * Shaders reading the same memory as column-major GLSL matrices get the
+ * transposes they need for M * v.
+ *
+ * With SSE2 (always on x64, the MSVC default on x86) the operations use
+ * SSE, otherwise the scalar versions. Both evaluate every element with
+ * the same operation order and no fused multiply-add, so their results
+ * are identical.
+ */
+
+#ifndef OFP_RENDERER_MATRIX_MATH_H
+#define OFP_RENDERER_MATRIX_MATH_H
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define OFP_MATRIX_SIMD 1
+#endif
+
+namespace Math {
+
+/**
+ * @struct Matrix4
+ * @brief 16-byte aligned so each row is one SSE register
+ */
+struct alignas(16) Matrix4 {
+    float m[4][4];
+};
+
+void Identity(Matrix4& out);
+
+/**
+ * @brief out = a * b, so a is applied first; out may alias a or b
+ */
+void Multiply(const Matrix4& a, const Matrix4& b, Matrix4& out);
+
+void Transpose(const Matrix4& a, Matrix4& out);
+
+/**
+ * @brief Inverse-transpose of the upper 3x3, for transforming normals
+ *
+ * Row 3 and column 3 of out are those of the identity.
+ * @return false if the 3x3 is singular; out is then the identity
+ */
+bool InverseTranspose3x3(const Matrix4& a, Matrix4& out);
+
+/**
+ * @brief Maps D3D clip space onto Vulkan's
+ *
+ * Both use a 0..1 depth range, so only Y is flipped. Applied to the
+ * projection once, with the window-space winding left as in D3D.
+ */
+void ClipSpaceFixup(Matrix4& out);
+
+// Reference implementations, also used when SSE is unavailable
+void MultiplyScalar(const Matrix4& a, const Matrix4& b, Matrix4& out);
+void TransposeScalar(const Matrix4& a, Matrix4& out);
+bool InverseTranspose3x3Scalar(const Matrix4& a, Matrix4& out);
+
+/**
+ * @brief "SSE" or "Scalar"
+ */
+const char* GetMatrixImplementationName();
+
+} // namespace Math
+
+#endif // OFP_RENDERER_MATRIX_MATH_H
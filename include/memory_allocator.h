@@ -0,0 +1,168 @@
+/**
+ * @file memory_allocator.h
+ * @brief Device memory sub-allocator shared by all renderer modules
+ *
+ * Drivers cap the number of live vkAllocateMemory allocations (often at
+ * 4096), so resources are placed into large blocks instead. Each block
+ * is managed by a buddy allocator, which keeps every sub-allocation
+ * aligned to its own power-of-two size.
+ */
+
+#ifndef OFP_RENDERER_MEMORY_ALLOCATOR_H
+#define OFP_RENDERER_MEMORY_ALLOCATOR_H
+
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace Vulkan {
+
+class MemoryBlock;
+
+/**
+ * @enum AllocationFlags
+ * @brief Options for MemoryAllocator::Allocate*
+ */
+enum AllocationFlags : uint32_t {
+    ALLOCATION_DEDICATED = 1 << 0,          // Own VkDeviceMemory (large render targets)
+    ALLOCATION_MAPPED = 1 << 1,             // Persistently mapped; requires host-visible memory
+};
+
+/**
+ * @struct Allocation
+ * @brief A bound range of device memory
+ */
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;                 // Set for ALLOCATION_MAPPED
+    uint32_t memoryTypeIndex = 0;
+    MemoryBlock* block = nullptr;           // nullptr for dedicated allocations
+    uint32_t level = 0;                     // Buddy level inside the block
+};
+
+/**
+ * @struct MemoryHeapSummary
+ * @brief Budget and fragmentation of one memory heap
+ */
+struct MemoryHeapSummary {
+    VkDeviceSize budget = 0;                // Heap size reported by the driver
+    VkDeviceSize reserved = 0;              // Bytes held in blocks and dedicated allocations
+    VkDeviceSize used = 0;                  // Bytes handed out to resources
+    VkDeviceSize largestFreeRange = 0;      // Largest free buddy range in any block
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+
+    /**
+     * @brief 0 when all free space is one range, approaching 1 when scattered
+     */
+    float Fragmentation() const
+    {
+        VkDeviceSize free = reserved - used;
+        return free ? 1.0f - (float)largestFreeRange / (float)free : 0.0f;
+    }
+};
+
+/**
+ * @class MemoryBlock
+ * @brief One VkDeviceMemory split by a buddy allocator
+ */
+class MemoryBlock {
+public:
+    static const VkDeviceSize MIN_ALLOCATION = 256;
+
+    MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, void* mapped);
+
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& level);
+    void Free(VkDeviceSize offset, uint32_t level);
+
+    VkDeviceSize LargestFreeRange() const;
+
+    VkDeviceMemory GetMemory() const { return m_Memory; }
+    VkDeviceSize GetSize() const { return m_Size; }
+    VkDeviceSize GetUsed() const { return m_Used; }
+    uint32_t GetMemoryTypeIndex() const { return m_MemoryTypeIndex; }
+    bool IsLinear() const { return m_Linear; }
+    bool IsEmpty() const { return m_Used == 0; }
+    uint8_t* GetMapped() const { return m_Mapped; }
+
+private:
+    VkDeviceSize LevelSize(uint32_t level) const { return m_Size >> level; }
+
+    VkDeviceMemory m_Memory;
+    VkDeviceSize m_Size;                    // Power of two
+    VkDeviceSize m_Used = 0;
+    uint32_t m_MemoryTypeIndex;
+    bool m_Linear;                          // Buffers/linear images vs optimal images
+    uint8_t* m_Mapped;
+
+    std::vector<std::unordered_set<VkDeviceSize>> m_FreeLists;  // Free offsets per level
+};
+
+/**
+ * @class MemoryAllocator
+ * @brief Owns all device memory blocks
+ *
+ * Blocks are kept per memory type and per resource kind. Linear
+ * resources (buffers) and optimal-tiling images never share a block, so
+ * bufferImageGranularity never needs padding between neighbours.
+ */
+class MemoryAllocator {
+public:
+    static MemoryAllocator& GetInstance();
+
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Shutdown();
+
+    /**
+     * @brief Find a memory type allowed by typeFilter with the required flags
+     * @param preferred Extra flags picked when available (e.g. DEVICE_LOCAL for staging)
+     * @return Memory type index, or UINT32_MAX if none matches
+     */
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0) const;
+    VkMemoryPropertyFlags GetMemoryTypeFlags(uint32_t memoryTypeIndex) const { return m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags; }
+
+    bool AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, uint32_t flags, Allocation& allocation);
+    bool AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, uint32_t flags, Allocation& allocation);
+
+    /**
+     * @brief Allocate optimal-image memory for merged requirements, e.g. of
+     *        several images aliased onto one range; the caller binds it
+     * @param preferred As for FindMemoryType (LAZILY_ALLOCATED for transient attachments)
+     */
+    bool AllocateImageMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, uint32_t flags, Allocation& allocation);
+    void Free(Allocation& allocation);
+
+    void GetHeapSummaries(std::vector<MemoryHeapSummary>& summaries);
+    void LogSummary();
+
+private:
+    MemoryAllocator() = default;
+    ~MemoryAllocator() { Shutdown(); }
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    bool Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, uint32_t flags, bool linear, Allocation& allocation);
+    bool AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, uint32_t flags, Allocation& allocation);
+    VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties = {};
+
+    std::vector<std::unique_ptr<MemoryBlock>> m_Blocks;
+    uint32_t m_DedicatedCount[VK_MAX_MEMORY_TYPES] = {};
+    VkDeviceSize m_DedicatedBytes[VK_MAX_MEMORY_TYPES] = {};
+
+    std::mutex m_Mutex;
+    bool m_bInitialized = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_MEMORY_ALLOCATOR_H
@@ -0,0 +1,90 @@
+/**
+ * @file pipeline_cache.h
+ * @brief Persistent VkPipelineCache shared by all pipeline owners
+ *
+ * The cache is loaded from disk when the device is created and written
+ * back on shutdown, so pipelines compiled during one session are reused
+ * by the next one instead of being rebuilt by the driver.
+ */
+
+#ifndef OFP_RENDERER_PIPELINE_CACHE_H
+#define OFP_RENDERER_PIPELINE_CACHE_H
+
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <string>
+
+namespace Vulkan {
+
+/**
+ * @struct PipelineCacheFileHeader
+ * @brief Header written in front of the driver's cache blob
+ *
+ * A file whose header does not match the running device and driver is
+ * ignored and the cache starts cold.
+ */
+struct PipelineCacheFileHeader {
+    uint32_t magic;                         // PIPELINE_CACHE_MAGIC
+    uint32_t version;                       // PIPELINE_CACHE_VERSION
+    uint32_t vendorID;                      // VkPhysicalDeviceProperties::vendorID
+    uint32_t deviceID;                      // VkPhysicalDeviceProperties::deviceID
+    uint32_t driverVersion;                 // VkPhysicalDeviceProperties::driverVersion
+    uint8_t uuid[VK_UUID_SIZE];             // VkPhysicalDeviceProperties::pipelineCacheUUID
+    uint64_t dataSize;                      // Size of the blob following the header
+    uint32_t dataChecksum;                  // FNV-1a of the blob
+};
+
+/**
+ * @class PipelineCache
+ * @brief Owns the process-wide VkPipelineCache
+ *
+ * All graphics and compute pipelines should be created through
+ * CreateGraphicsPipelines()/CreateComputePipelines() so creation time
+ * is accounted for and reported as cold or warm on shutdown.
+ */
+class PipelineCache {
+public:
+    static PipelineCache& GetInstance();
+
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::wstring& filename);
+    void Shutdown();
+
+    /**
+     * @brief Write the current cache contents to disk
+     *
+     * The data is written to a temporary file first and then renamed
+     * over the old one, so a crash never leaves a truncated cache.
+     */
+    bool Save();
+
+    VkResult CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines);
+    VkResult CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+    VkPipelineCache GetHandle() const { return m_Cache; }
+    bool IsWarm() const { return m_bWarm; }
+
+private:
+    PipelineCache() = default;
+    ~PipelineCache() { Shutdown(); }
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    bool LoadFromDisk(std::string& blob);
+    void FillHeader(PipelineCacheFileHeader& header) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_Properties = {};
+    std::wstring m_Filename;
+
+    uint32_t m_PipelineCount = 0;           // Pipelines created this session
+    double m_CreateMilliseconds = 0.0;      // Time spent inside vkCreate*Pipelines
+
+    bool m_bWarm = false;
+    bool m_bInitialized = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_PIPELINE_CACHE_H
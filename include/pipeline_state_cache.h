@@ -0,0 +1,135 @@
+/**
+ * @file pipeline_state_cache.h
+ * @brief Maps translated D3D8 fixed-function state to Vulkan pipelines
+ *
+ * D3D8 render states can change between any two draws, while Vulkan
+ * bakes them into immutable pipelines. The bridge packs the state that
+ * affects pipeline creation into a 16-byte key and looks the pipeline
+ * up in an open-addressing table before every draw.
+ */
+
+#ifndef OFP_RENDERER_PIPELINE_STATE_CACHE_H
+#define OFP_RENDERER_PIPELINE_STATE_CACHE_H
+
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Bridge {
+
+/**
+ * @struct PipelineKey
+ * @brief Pipeline-relevant render state, already translated to Vulkan enums
+ *
+ * Dynamic values such as the alpha reference, viewport and scissor are
+ * not part of the key.
+ */
+struct PipelineKey {
+    uint32_t fvf = 0;                                   // D3DFVF_* vertex layout
+    uint8_t topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    uint8_t blendEnable = 0;
+    uint8_t srcBlend = VK_BLEND_FACTOR_ONE;
+    uint8_t dstBlend = VK_BLEND_FACTOR_ZERO;
+    uint8_t depthTestEnable = 1;
+    uint8_t depthWriteEnable = 1;
+    uint8_t depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    uint8_t cullMode = VK_CULL_MODE_BACK_BIT;
+    uint8_t alphaTestEnable = 0;
+    uint8_t alphaCompareOp = VK_COMPARE_OP_ALWAYS;
+    uint8_t instanced = 0;                              // Per-instance world matrices in binding 1
+    uint8_t padding[1] = {};
+
+    bool operator==(const PipelineKey& other) const { return memcmp(this, &other, sizeof(PipelineKey)) == 0; }
+    bool operator!=(const PipelineKey& other) const { return !(*this == other); }
+
+    uint64_t Hash() const
+    {
+        uint64_t words[2];
+        memcpy(words, this, sizeof(words));
+        uint64_t hash = words[0] * 0x9E3779B97F4A7C15ull;
+        hash ^= (words[1] + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        return hash ^ (hash >> 29);
+    }
+};
+
+static_assert(sizeof(PipelineKey) == 16, "PipelineKey must stay two 64-bit words");
+
+/**
+ * @struct PipelineStateCacheStats
+ * @brief Lookup counters
+ */
+struct PipelineStateCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint32_t pipelineCount = 0;
+    uint32_t capacity = 0;
+};
+
+/**
+ * @class PipelineStateCache
+ * @brief Open-addressing (linear probing) table from PipelineKey to VkPipeline
+ *
+ * The table only stores handles; pipelines are built by the caller on a
+ * miss and handed back through Insert(). The table is kept at most half
+ * full so probe sequences stay short.
+ */
+class PipelineStateCache {
+public:
+    PipelineStateCache() { Reset(64); }
+
+    /**
+     * @brief Find the pipeline for a key
+     * @return VK_NULL_HANDLE on a miss
+     */
+    VkPipeline Lookup(const PipelineKey& key)
+    {
+        uint32_t index = (uint32_t)key.Hash() & m_Mask;
+        for (;;)
+        {
+            const Entry& entry = m_Entries[index];
+            if (entry.pipeline == VK_NULL_HANDLE)
+            {
+                m_Stats.misses++;
+                return VK_NULL_HANDLE;
+            }
+            if (entry.key == key)
+            {
+                m_Stats.hits++;
+                return entry.pipeline;
+            }
+            index = (index + 1) & m_Mask;
+        }
+    }
+
+    void Insert(const PipelineKey& key, VkPipeline pipeline);
+
+    /**
+     * @brief Hand every cached pipeline to the caller and empty the table
+     */
+    void Clear(std::vector<VkPipeline>& pipelines);
+
+    /**
+     * @brief Keys of all cached pipelines, for the warm-up list
+     */
+    void GetKeys(std::vector<PipelineKey>& keys) const;
+
+    const PipelineStateCacheStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Entry {
+        PipelineKey key;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    void Reset(uint32_t capacity);
+    void Grow();
+
+    std::vector<Entry> m_Entries;
+    uint32_t m_Mask = 0;
+    PipelineStateCacheStats m_Stats;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_PIPELINE_STATE_CACHE_H
@@ -0,0 +1,55 @@
+/**
+ * @file platform.h
+ * @brief Minimal Win32 shim for the platform-independent renderer core
+ *
+ * The DLL is Windows-only, but the renderer core (Vulkan::Renderer in
+ * headless mode, memory and pipeline caches) is also built on Linux,
+ * where CI renders headless frames on a software Vulkan driver.
+ * On Windows this simply includes <windows.h>.
+ */
+
+#ifndef OFP_RENDERER_PLATFORM_H
+#define OFP_RENDERER_PLATFORM_H
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#else
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+
+typedef void* HWND;
+typedef unsigned int UINT;
+typedef unsigned long DWORD;
+typedef int BOOL;
+typedef int INT;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+inline void OutputDebugStringA(const char* message)
+{
+    fputs(message, stderr);
+}
+
+template <size_t N>
+inline int sprintf_s(char (&buffer)[N], const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int result = vsnprintf(buffer, N, format, args);
+    va_end(args);
+    return result;
+}
+
+#endif // _WIN32
+
+#endif // OFP_RENDERER_PLATFORM_H
@@ -9,7 +9,12 @@
 #ifndef OFP_RENDERER_POST_PROCESSING_H
 #define OFP_RENDERER_POST_PROCESSING_H
 
+#include "platform.h"
 #include <vulkan/vulkan.h>
+#include "memory_allocator.h"
+#include "bloom.h"
+#include "transient_pool.h"
+#include <cstdint>
 
 namespace PostProcessing {
 
@@ -25,6 +30,35 @@ struct EffectConfig {
     float param2 = 0.0f;
 };
 
+/**
+ * @enum EffectId
+ * @brief Effect index used in the uber shader's specialization constants
+ */
+enum EffectId : uint32_t {
+    EFFECT_HARD_LIGHT = 0,
+    EFFECT_DESATURATE,
+    EFFECT_GLARE,
+    EFFECT_COUNT
+};
+
+/**
+ * @struct UberPushConstants
+ * @brief Effect strengths, laid out as in shaders/post_uber.frag
+ */
+struct UberPushConstants {
+    float hardLight[4] = {};                // rgb strength
+    float desaturation = 0.0f;
+    float glareStrength = 0.0f;
+    float glareSize = 0.0f;                 // Bloom levels in use
+    float glareDarkenSky = 0.0f;
+};
+
+/**
+ * @brief Create a module from the SPIR-V embedded at build time
+ * @param name Source file name in shaders/, e.g. "post_uber.frag"
+ */
+bool LoadShaderModule(VkDevice device, const char* name, VkShaderModule& module);
+
 /**
  * @class PostProcessor
  * @brief Manages post-processing effects
@@ -34,9 +68,17 @@ struct EffectConfig {
  * - Managing post-processing shaders
  * - Applying effects in the correct order
  * - Blending the result with the final image
+ *
+ * All effects are permutations of one uber fragment shader. In fused
+ * mode the Apply* calls only record which effects run and in what
+ * order, and EndPostProcessing() draws the whole chain in a single
+ * full-screen pass. Otherwise each Apply* call is its own pass,
+ * ping-ponging between the two render targets.
  */
 class PostProcessor {
 public:
+    static const uint32_t MAX_PERMUTATIONS = 16;    // Every ordered subset of EFFECT_COUNT effects
+    
     static PostProcessor& GetInstance();
     
     bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice, UINT width, UINT height);
@@ -44,50 +86,93 @@ public:
     
     void Resize(UINT width, UINT height);
     
-    void BeginPostProcessing();
+    /**
+     * @brief Start the chain for this frame
+     *
+     * The scene must already be in GetInputImage(), in
+     * SHADER_READ_ONLY_OPTIMAL layout, and no render pass may be active.
+     */
+    void BeginPostProcessing(VkCommandBuffer commandBuffer);
     void EndPostProcessing();
     
     void ApplyHardLight(float strengthR, float strengthG, float strengthB);
     void ApplyDesaturation(float strength);
     void ApplyGlare(float strength, int size, bool darkenSky);
     
+    /**
+     * @brief Switch between fused and separate passes
+     *
+     * Target lifetimes differ between the modes, so this rebuilds the
+     * render targets. Like Resize(), it does not wait for the device; the
+     * old targets go through the deletion queue.
+     */
+    void SetFused(bool fused);
+    bool IsFused() const { return m_bFused; }
+    
+    VkImage GetInputImage() const { return m_IntermediateImage; }
+    VkImage GetOutputImage() const { return m_OutputImage; }           // SHADER_READ_ONLY_OPTIMAL after EndPostProcessing()
     VkImageView GetOutputView() const { return m_OutputImageView; }
+    const Vulkan::TransientPoolStats& GetTargetStats() const { return m_Targets.GetStats(); }
     
 private:
     PostProcessor() = default;
     ~PostProcessor() { Shutdown(); }
 
     void CleanupRenderTargets();
-    UINT FindMemoryType(VkPhysicalDeviceMemoryProperties properties, UINT typeFilter, VkMemoryPropertyFlags propertiesFlags);
     bool CreateRenderTargets(UINT width, UINT height);
+    bool CreateRenderPass();
+    bool CreateDescriptors();
+    bool AllocateDescriptorSets();
     bool CreateShaders();
     bool CreateSamplers();
-    
-    void RenderQuad();
+    bool CreatePipelineLayout();
+    
+    /**
+     * @brief Pipeline for a set of effects in a given order
+     * @param mask Bit per EffectId
+     * @param order EffectId per slot, 4 bits each, 0xF for unused slots
+     */
+    VkPipeline GetPermutation(uint32_t mask, uint32_t order);
+    VkPipeline CreatePermutation(uint32_t mask, uint32_t order);
+    void RunEffect(EffectId effect);
+    
+    /**
+     * @brief Draw a full-screen pass from the current target into the other
+     *
+     * One oversized triangle, so no pixel along a quad diagonal is
+     * shaded twice and no vertex buffer is bound.
+     */
+    void RenderQuad(VkPipeline pipeline);
     
     VkDevice m_Device = VK_NULL_HANDLE;
     VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
     
     VkImage m_IntermediateImage = VK_NULL_HANDLE;
     VkImageView m_IntermediateImageView = VK_NULL_HANDLE;
-    VkDeviceMemory m_IntermediateImageMemory = VK_NULL_HANDLE;
     
     VkImage m_OutputImage = VK_NULL_HANDLE;
     VkImageView m_OutputImageView = VK_NULL_HANDLE;
-    VkDeviceMemory m_OutputImageMemory = VK_NULL_HANDLE;
     
     VkSampler m_Sampler = VK_NULL_HANDLE;
     
-    VkShaderModule m_HardLightShader = VK_NULL_HANDLE;
-    VkShaderModule m_DesaturateShader = VK_NULL_HANDLE;
-    VkShaderModule m_GlareShader = VK_NULL_HANDLE;
-    VkShaderModule m_CopyShader = VK_NULL_HANDLE;
+    // Index 0 is the intermediate target, 1 the output target. Neither
+    // the render pass nor the framebuffers exist with dynamic rendering.
+    VkRenderPass m_RenderPass = VK_NULL_HANDLE;
+    VkFramebuffer m_Framebuffers[2] = {};
+    VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;     // Recreated with the targets
+    VkDescriptorSet m_DescriptorSets[2] = {};       // Samples target i
     
+    VkShaderModule m_FullscreenShader = VK_NULL_HANDLE;
+    VkShaderModule m_UberShader = VK_NULL_HANDLE;
     VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
-    VkPipeline m_HardLightPipeline = VK_NULL_HANDLE;
-    VkPipeline m_DesaturatePipeline = VK_NULL_HANDLE;
-    VkPipeline m_GlarePipeline = VK_NULL_HANDLE;
-    VkPipeline m_CopyPipeline = VK_NULL_HANDLE;
+    
+    struct Permutation {
+        uint32_t key = 0;                           // mask | order << 8
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+    Permutation m_Permutations[MAX_PERMUTATIONS];
+    uint32_t m_PermutationCount = 0;
     
     UINT m_Width = 0;
     UINT m_Height = 0;
@@ -95,7 +180,20 @@ private:
     EffectConfig m_HardLight;
     EffectConfig m_Desaturate;
     EffectConfig m_Glare;
-    
+    UberPushConstants m_PushConstants;
+    Bloom m_Bloom;
+    Vulkan::TransientPool m_Targets;                // Both targets and the bloom chain
+    
+    // Per-frame chain state
+    VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+    uint32_t m_FrameMask = 0;
+    uint32_t m_FrameOrder = 0xFFF;
+    uint32_t m_FrameEffectCount = 0;
+    uint32_t m_CurrentTarget = 0;                   // Target holding the latest result
+    
+    bool m_bFused = true;
+    bool m_bDynamicRendering = false;
+    bool m_bSynchronization2 = false;               // Per-barrier stage masks through the FrameScheduler
     bool m_Initialized = false;
 };
 
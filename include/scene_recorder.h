@@ -0,0 +1,179 @@
+/**
+ * @file scene_recorder.h
+ * @brief Deferred, optionally multi-threaded recording of the scene's draws
+ *
+ * The D3D8 bridge does not record Vulkan commands itself. It translates
+ * each draw into a self-contained DrawPacket and queues it here, and the
+ * renderer records the queued packets when the frame ends.
+ *
+ * With worker threads the packets are split into contiguous chunks, one
+ * per thread, and each chunk is recorded into a secondary command buffer
+ * from that thread's own per-frame command pool. The calling thread
+ * records the first chunk itself, then the primary executes the chunks in
+ * order, so the draw order is unchanged. The scene subpass then uses
+ * VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, and anything else drawn
+ * in it has to go through BeginOverlay()/EndOverlay(). With dynamic
+ * rendering the secondaries inherit the attachment format instead of a
+ * render pass and framebuffer.
+ *
+ * Without workers the packets are recorded inline into the primary.
+ */
+
+#ifndef OFP_RENDERER_SCENE_RECORDER_H
+#define OFP_RENDERER_SCENE_RECORDER_H
+
+#include "vulkan/vulkan.h"
+#include "vulkan_renderer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Vulkan {
+
+/**
+ * @struct DrawPacket
+ * @brief Everything one indexed draw needs, so any thread can record it
+ *
+ * Buffers and descriptor sets must stay valid until the frame's fence
+ * has signalled.
+ */
+struct DrawPacket {
+    static const uint32_t MAX_DYNAMIC_OFFSETS = 4;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;     // Set 0
+    uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS] = {};
+    uint32_t dynamicOffsetCount = 0;
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;             // Bound to bindings 0..vertexBindingCount-1
+    VkDeviceSize vertexOffsets[2] = {};
+    uint32_t vertexBindingCount = 1;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t indexCount = 0;
+    uint32_t instanceCount = 1;
+
+    VkViewport viewport = {};
+    VkRect2D scissor = {};
+};
+
+/**
+ * @struct SceneRecorderStats
+ * @brief Counters since Initialize()
+ */
+struct SceneRecorderStats {
+    uint64_t frameCount = 0;
+    uint64_t packetCount = 0;
+    uint64_t parallelFrames = 0;            // Frames split across more than one thread
+    uint64_t chunkCount = 0;                // Secondary command buffers executed
+    double recordMilliseconds = 0.0;        // Spent in Record() on the calling thread
+};
+
+/**
+ * @class SceneRecorder
+ * @brief Queue of draw packets and the worker pool that records them
+ *
+ * Add() and all other calls must come from the thread that calls
+ * Renderer::EndFrame().
+ */
+class SceneRecorder {
+public:
+    static const uint32_t MAX_WORKERS = 8;
+    static const uint32_t MIN_PACKETS_PER_CHUNK = 128;  // Smaller frames are not worth a thread handoff
+
+    static SceneRecorder& GetInstance();
+
+    /**
+     * @param workerCount Extra recording threads; 0 records inline into the primary
+     */
+    bool Initialize(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t workerCount);
+    void Shutdown();
+
+    /**
+     * @brief Whether the scene subpass must be begun with secondary contents
+     */
+    bool UsesSecondaryBuffers() const { return m_WorkerCount > 0; }
+
+    /**
+     * @brief Reset the slot's command pools and start a new packet list
+     * @param frameIndex Slot whose fence has already been waited on
+     * @param renderPass VK_NULL_HANDLE when the scene uses dynamic rendering
+     * @param colorFormat Scene attachment format, inherited with dynamic rendering
+     */
+    void BeginFrame(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkFormat colorFormat);
+
+    void Add(const DrawPacket& packet) { m_Packets.push_back(packet); }
+
+    /**
+     * @brief Record the queued packets into the primary's current subpass
+     */
+    void Record(VkCommandBuffer primary);
+
+    /**
+     * @brief Command buffer for further commands in the scene subpass
+     *
+     * The primary itself when recording inline, otherwise a secondary
+     * that EndOverlay() executes.
+     */
+    VkCommandBuffer BeginOverlay(VkCommandBuffer primary);
+    void EndOverlay(VkCommandBuffer primary);
+
+    const SceneRecorderStats& GetStats() const { return m_Stats; }
+
+private:
+    SceneRecorder() = default;
+    ~SceneRecorder() { Shutdown(); }
+    SceneRecorder(const SceneRecorder&) = delete;
+    SceneRecorder& operator=(const SceneRecorder&) = delete;
+
+    static const uint32_t CONTEXT_COUNT = MAX_WORKERS + 1;  // Context 0 is the calling thread
+    static const uint32_t SCENE_BUFFER = 0;
+    static const uint32_t OVERLAY_BUFFER = 1;
+
+    struct Context {
+        VkCommandPool pools[MAX_FRAMES_IN_FLIGHT] = {};
+        VkCommandBuffer buffers[MAX_FRAMES_IN_FLIGHT][2] = {};  // SCENE_BUFFER, OVERLAY_BUFFER
+    };
+
+    struct Job {
+        uint32_t frameIndex = 0;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+        size_t first[CONTEXT_COUNT] = {};
+        size_t count[CONTEXT_COUNT] = {};
+    };
+
+    void WorkerThread(uint32_t context);
+    void RecordChunk(uint32_t context, const Job& job);
+    bool BeginSecondary(VkCommandBuffer buffer, const Job& job);
+    void RecordPackets(VkCommandBuffer cmd, size_t first, size_t count) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    uint32_t m_FramesInFlight = 0;
+    uint32_t m_WorkerCount = 0;
+    Context m_Contexts[CONTEXT_COUNT];
+
+    std::vector<DrawPacket> m_Packets;
+    Job m_Frame;                            // Set by BeginFrame(), chunks filled in by Record()
+
+    std::vector<std::thread> m_Threads;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCondition;
+    std::condition_variable m_DoneCondition;
+    Job m_Job;                              // Published to the workers under m_Mutex
+    uint64_t m_Generation = 0;              // Incremented for every published job
+    uint32_t m_Pending = 0;                 // Worker chunks not recorded yet
+    bool m_bStopping = false;
+
+    SceneRecorderStats m_Stats;
+    bool m_bInitialized = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_SCENE_RECORDER_H
@@ -0,0 +1,47 @@
+/**
+ * @file shader_interface.h
+ * @brief Vertex locations, uniform bindings and specialization constants of the scene shaders
+ *
+ * Included by the bridge and, through GL_GOOGLE_include_directive, by
+ * shaders/scene.vert and shaders/scene.frag, so the pipeline and the
+ * shaders cannot disagree. Only preprocessor definitions, which C++ and
+ * GLSL both accept; the uniform blocks themselves are mirrored in
+ * shaders/scene_uniforms.glsl.
+ */
+
+#ifndef OFP_RENDERER_SHADER_INTERFACE_H
+#define OFP_RENDERER_SHADER_INTERFACE_H
+
+// Vertex inputs of binding 0, in D3D8 FVF order
+#define SCENE_LOCATION_POSITION         0   // vec3 XYZ or vec4 XYZRHW
+#define SCENE_LOCATION_NORMAL           1
+#define SCENE_LOCATION_DIFFUSE          2   // B8G8R8A8_UNORM
+#define SCENE_LOCATION_SPECULAR         3   // B8G8R8A8_UNORM
+#define SCENE_LOCATION_TEXCOORD         4   // Up to eight vec2 sets, 4-11
+
+// Per-instance world matrix of instanced draws: one D3D8 row per location
+#define SCENE_INSTANCE_BINDING          1   // Vertex buffer binding, VK_VERTEX_INPUT_RATE_INSTANCE
+#define SCENE_LOCATION_INSTANCE_WORLD   12  // Rows at 12-15, after the FVF attributes
+
+// Set 0, all UNIFORM_BUFFER_DYNAMIC, std140; see uniform_state.h
+#define SCENE_BINDING_TRANSFORM         0
+#define SCENE_BINDING_OBJECT            1
+#define SCENE_BINDING_LIGHTING          2
+
+#define SCENE_MAX_LIGHTS                8
+
+// Vertex stage specialization constants
+#define SCENE_SPEC_INSTANCED            0   // World matrix from the instance binding
+#define SCENE_SPEC_VERTEX_FORMAT        1   // SCENE_FORMAT_* bits
+
+// Fragment stage specialization constants
+#define SCENE_SPEC_ALPHA_COMPARE_OP     0   // VkCompareOp; ALWAYS when the alpha test is off
+
+// Which FVF components the vertex actually has. The shader always reads
+// position, normal, diffuse and the instance rows; the pipeline points
+// absent ones at the start of the vertex and the shader ignores them.
+#define SCENE_FORMAT_PRETRANSFORMED     1u  // Position is D3DFVF_XYZRHW
+#define SCENE_FORMAT_NORMAL             2u
+#define SCENE_FORMAT_DIFFUSE            4u
+
+#endif // OFP_RENDERER_SHADER_INTERFACE_H
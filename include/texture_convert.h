@@ -0,0 +1,127 @@
+/**
+ * @file texture_convert.h
+ * @brief Expansion of legacy D3D8 texture formats to 32-bit texels
+ *
+ * 16-bit formats (R5G6B5, X1R5G5B5, A1R5G5B5, A4R4G4B4, X4R4G4B4), P8 and
+ * X8R8G8B8 are expanded to BGRA8 or RGBA8, normally straight into upload
+ * staging memory. A8R8G8B8 in BGRA order and DXT1-5 (as BC1-3) upload
+ * unchanged.
+ *
+ * Every format has a scalar reference kernel. SSE2 and AVX2 kernels are
+ * selected at run time and produce bit-identical output: channels are
+ * widened by bit replication, (x << 3) | (x >> 2) for 5 bits, which is
+ * exact in integer arithmetic at any vector width.
+ */
+
+#ifndef OFP_RENDERER_TEXTURE_CONVERT_H
+#define OFP_RENDERER_TEXTURE_CONVERT_H
+
+#include "vulkan/vulkan.h"
+#include <cstdint>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define OFP_TEXTURE_SIMD 1
+#endif
+
+namespace Bridge {
+
+/**
+ * @enum TextureFormat
+ * @brief Layout of the source texels
+ */
+enum TextureFormat : uint32_t {
+    TEXTURE_FORMAT_RAW = 0,                 // Uploaded as is
+    TEXTURE_FORMAT_R5G6B5,
+    TEXTURE_FORMAT_X1R5G5B5,
+    TEXTURE_FORMAT_A1R5G5B5,
+    TEXTURE_FORMAT_A4R4G4B4,
+    TEXTURE_FORMAT_X4R4G4B4,
+    TEXTURE_FORMAT_X8R8G8B8,
+    TEXTURE_FORMAT_A8R8G8B8,                // Only converted for RGBA order
+    TEXTURE_FORMAT_P8,
+    TEXTURE_FORMAT_COUNT
+};
+
+/**
+ * @enum TexelOrder
+ * @brief Byte order of the 32-bit output texels
+ */
+enum TexelOrder : uint32_t {
+    TEXEL_ORDER_BGRA = 0,                   // VK_FORMAT_B8G8R8A8_UNORM, same as D3D's ARGB in memory
+    TEXEL_ORDER_RGBA,                       // VK_FORMAT_R8G8B8A8_UNORM
+    TEXEL_ORDER_COUNT
+};
+
+/**
+ * @enum SimdLevel
+ * @brief Instruction set of the conversion kernels
+ */
+enum SimdLevel : uint32_t {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_LEVEL_COUNT
+};
+
+/**
+ * @struct TextureConversion
+ * @brief How a D3D8 format is uploaded
+ */
+struct TextureConversion {
+    TextureFormat source = TEXTURE_FORMAT_RAW;
+    VkFormat format = VK_FORMAT_UNDEFINED;  // Of the Vulkan image
+    uint32_t blockSize = 1;                 // Texels per block edge (4 for DXT)
+    uint32_t bytesPerBlock = 4;             // Of the uploaded data
+};
+
+/**
+ * @brief Find the upload path for a D3DFORMAT value
+ * @return false for formats with no upload path
+ */
+bool GetTextureConversion(uint32_t d3dFormat, TexelOrder order, TextureConversion& conversion);
+
+/**
+ * @brief Convert D3D8 PALETTEENTRY values (R, G, B, alpha bytes) into
+ *        output texels for TEXTURE_FORMAT_P8
+ */
+void ConvertPalette(const uint8_t entries[256 * 4], TexelOrder order, uint32_t palette[256]);
+
+/**
+ * @brief Convert one row of count texels with the kernels of a given level
+ *
+ * Falls back to the best lower level the format has kernels for.
+ * @param palette Output of ConvertPalette() for TEXTURE_FORMAT_P8
+ */
+void ConvertTexels(TextureFormat format, TexelOrder order, SimdLevel level,
+                   const void* source, uint32_t* destination, uint32_t count, const uint32_t* palette);
+
+/**
+ * @brief Convert a width x height image into tightly packed 32-bit texels
+ * @param sourcePitch Bytes per source row, 0 when tightly packed
+ */
+void ConvertTexture(TextureFormat format, TexelOrder order, const void* source, uint32_t sourcePitch,
+                    uint32_t* destination, uint32_t width, uint32_t height, const uint32_t* palette);
+
+/**
+ * @brief Best level supported by the CPU and OS, detected once
+ */
+SimdLevel GetSimdLevel();
+
+uint32_t GetSourceTexelSize(TextureFormat format);
+const char* GetTextureFormatName(TextureFormat format);
+const char* GetSimdLevelName(SimdLevel level);
+
+/**
+ * @brief Converts the first n <= count texels and returns n; the caller
+ *        finishes the row with the scalar kernel
+ */
+typedef uint32_t (*TexelKernel)(const void* source, uint32_t* destination, uint32_t count, const uint32_t* palette);
+
+// Kernel tables of texture_convert_sse2.cpp and texture_convert_avx2.cpp;
+// formats without a kernel at that level are left null.
+void GetSse2Kernels(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT]);
+void GetAvx2Kernels(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT]);
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_TEXTURE_CONVERT_H
@@ -0,0 +1,134 @@
+/**
+ * @file texture_kernels.h
+ * @brief Vector kernels shared by the SSE2 and AVX2 texture converters
+ *
+ * Only included by texture_convert_sse2.cpp and texture_convert_avx2.cpp,
+ * which are compiled for their instruction set. The kernels are written
+ * against a small traits class S:
+ *
+ *   V                      vector type
+ *   LANES16, LANES32       16- and 32-bit lanes per vector
+ *   Load(p), Set16(x), Set32(x), And, Or
+ *   Srli16<N>, Slli16<N>, Srai16<N>, Srli32<N>, Slli32<N>
+ *   Store(p, v)            LANES32 texels
+ *   StoreInterleave(p, lo, hi)  2 * LANES32 texels, texel i = lo[i] | hi[i] << 16
+ */
+
+#ifndef OFP_RENDERER_TEXTURE_KERNELS_H
+#define OFP_RENDERER_TEXTURE_KERNELS_H
+
+#include "texture_convert.h"
+
+namespace Bridge {
+namespace Kernels {
+
+/**
+ * @brief Widen n-bit channels (in 16-bit lanes) to 8 bits by replicating their top bits
+ */
+template <class S, int BITS>
+inline typename S::V Widen(typename S::V x)
+{
+    return S::Or(S::template Slli16<8 - BITS>(x), S::template Srli16<2 * BITS - 8>(x));
+}
+
+template <class S, TextureFormat F>
+inline void Decode16(typename S::V p, typename S::V& r, typename S::V& g, typename S::V& b, typename S::V& a)
+{
+    typedef typename S::V V;
+    const V opaque = S::Set16(0xFF);
+
+    if (F == TEXTURE_FORMAT_R5G6B5)
+    {
+        r = Widen<S, 5>(S::template Srli16<11>(p));
+        g = Widen<S, 6>(S::And(S::template Srli16<5>(p), S::Set16(0x3F)));
+        b = Widen<S, 5>(S::And(p, S::Set16(0x1F)));
+        a = opaque;
+    }
+    else if (F == TEXTURE_FORMAT_X1R5G5B5 || F == TEXTURE_FORMAT_A1R5G5B5)
+    {
+        const V mask = S::Set16(0x1F);
+        r = Widen<S, 5>(S::And(S::template Srli16<10>(p), mask));
+        g = Widen<S, 5>(S::And(S::template Srli16<5>(p), mask));
+        b = Widen<S, 5>(S::And(p, mask));
+        // The sign shift turns the alpha bit into 0 or 0xFFFF.
+        a = (F == TEXTURE_FORMAT_A1R5G5B5) ? S::And(S::template Srai16<15>(p), opaque) : opaque;
+    }
+    else
+    {
+        const V mask = S::Set16(0x0F);
+        r = Widen<S, 4>(S::And(S::template Srli16<8>(p), mask));
+        g = Widen<S, 4>(S::And(S::template Srli16<4>(p), mask));
+        b = Widen<S, 4>(S::And(p, mask));
+        a = (F == TEXTURE_FORMAT_A4R4G4B4) ? Widen<S, 4>(S::template Srli16<12>(p)) : opaque;
+    }
+}
+
+template <class S, TextureFormat F, TexelOrder O>
+uint32_t Convert16(const void* source, uint32_t* destination, uint32_t count, const uint32_t*)
+{
+    typedef typename S::V V;
+    const uint16_t* in = static_cast<const uint16_t*>(source);
+    const uint32_t n = count - count % S::LANES16;
+
+    for (uint32_t i = 0; i < n; i += S::LANES16)
+    {
+        V r, g, b, a;
+        Decode16<S, F>(S::Load(in + i), r, g, b, a);
+
+        // Bytes 0-1 and 2-3 of each output texel
+        V lo = S::Or(O == TEXEL_ORDER_BGRA ? b : r, S::template Slli16<8>(g));
+        V hi = S::Or(O == TEXEL_ORDER_BGRA ? r : b, S::template Slli16<8>(a));
+        S::StoreInterleave(destination + i, lo, hi);
+    }
+    return n;
+}
+
+template <class S, TextureFormat F, TexelOrder O>
+uint32_t Convert32(const void* source, uint32_t* destination, uint32_t count, const uint32_t*)
+{
+    typedef typename S::V V;
+    const uint32_t* in = static_cast<const uint32_t*>(source);
+    const uint32_t n = count - count % S::LANES32;
+    const V alpha = S::Set32(F == TEXTURE_FORMAT_X8R8G8B8 ? 0xFF000000u : 0u);
+    const V greenAlpha = S::Set32(0xFF00FF00u);
+    const V redBlue = S::Set32(0x00FF00FFu);
+
+    for (uint32_t i = 0; i < n; i += S::LANES32)
+    {
+        V p = S::Load(in + i);
+        if (O == TEXEL_ORDER_RGBA)
+        {
+            V rb = S::And(p, redBlue);
+            p = S::Or(S::And(p, greenAlpha), S::Or(S::template Slli32<16>(rb), S::template Srli32<16>(rb)));
+        }
+        S::Store(destination + i, S::Or(p, alpha));
+    }
+    return n;
+}
+
+/**
+ * @brief Fill the 16- and 32-bit entries of a kernel table
+ */
+template <class S>
+void FillKernels(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+    kernels[TEXTURE_FORMAT_R5G6B5][TEXEL_ORDER_BGRA] = Convert16<S, TEXTURE_FORMAT_R5G6B5, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_R5G6B5][TEXEL_ORDER_RGBA] = Convert16<S, TEXTURE_FORMAT_R5G6B5, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_X1R5G5B5][TEXEL_ORDER_BGRA] = Convert16<S, TEXTURE_FORMAT_X1R5G5B5, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_X1R5G5B5][TEXEL_ORDER_RGBA] = Convert16<S, TEXTURE_FORMAT_X1R5G5B5, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_A1R5G5B5][TEXEL_ORDER_BGRA] = Convert16<S, TEXTURE_FORMAT_A1R5G5B5, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_A1R5G5B5][TEXEL_ORDER_RGBA] = Convert16<S, TEXTURE_FORMAT_A1R5G5B5, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_A4R4G4B4][TEXEL_ORDER_BGRA] = Convert16<S, TEXTURE_FORMAT_A4R4G4B4, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_A4R4G4B4][TEXEL_ORDER_RGBA] = Convert16<S, TEXTURE_FORMAT_A4R4G4B4, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_X4R4G4B4][TEXEL_ORDER_BGRA] = Convert16<S, TEXTURE_FORMAT_X4R4G4B4, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_X4R4G4B4][TEXEL_ORDER_RGBA] = Convert16<S, TEXTURE_FORMAT_X4R4G4B4, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_X8R8G8B8][TEXEL_ORDER_BGRA] = Convert32<S, TEXTURE_FORMAT_X8R8G8B8, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_X8R8G8B8][TEXEL_ORDER_RGBA] = Convert32<S, TEXTURE_FORMAT_X8R8G8B8, TEXEL_ORDER_RGBA>;
+    kernels[TEXTURE_FORMAT_A8R8G8B8][TEXEL_ORDER_BGRA] = Convert32<S, TEXTURE_FORMAT_A8R8G8B8, TEXEL_ORDER_BGRA>;
+    kernels[TEXTURE_FORMAT_A8R8G8B8][TEXEL_ORDER_RGBA] = Convert32<S, TEXTURE_FORMAT_A8R8G8B8, TEXEL_ORDER_RGBA>;
+}
+
+} // namespace Kernels
+} // namespace Bridge
+
+#endif // OFP_RENDERER_TEXTURE_KERNELS_H
@@ -0,0 +1,126 @@
+/**
+ * @file transient_pool.h
+ * @brief Aliased memory for render targets that only live within a frame
+ *
+ * Users declare their images and the passes of a frame that read or write
+ * them. Compile() derives each image's lifetime as the range of passes
+ * that touch it and places images whose lifetimes do not overlap on the
+ * same memory. Attachment-only images are created as transient
+ * attachments and prefer lazily allocated memory, which tile-based GPUs
+ * never back with real pages.
+ *
+ * Aliased images do not keep their contents across passes, so every pass
+ * must treat an image's first use in the frame as VK_IMAGE_LAYOUT_UNDEFINED.
+ */
+
+#ifndef OFP_RENDERER_TRANSIENT_POOL_H
+#define OFP_RENDERER_TRANSIENT_POOL_H
+
+#include "vulkan/vulkan.h"
+#include "memory_allocator.h"
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace Vulkan {
+
+typedef uint32_t TransientImage;
+static const TransientImage TRANSIENT_IMAGE_NONE = UINT32_MAX;
+
+/**
+ * @struct TransientImageDesc
+ * @brief A 2D single-layer image
+ */
+struct TransientImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 1;
+    VkImageUsageFlags usage = 0;
+};
+
+/**
+ * @struct TransientPoolStats
+ * @brief Memory of the compiled pool against one allocation per image
+ */
+struct TransientPoolStats {
+    VkDeviceSize naiveBytes = 0;            // Sum of all image sizes
+    VkDeviceSize allocatedBytes = 0;        // Sum of all memory slots
+    VkDeviceSize lazyBytes = 0;             // Part of allocatedBytes in lazily allocated memory
+    uint32_t imageCount = 0;
+    uint32_t slotCount = 0;
+
+    VkDeviceSize SavedBytes() const { return naiveBytes - allocatedBytes; }
+};
+
+/**
+ * @class TransientPool
+ * @brief Frame-graph-lite owner of transient images
+ *
+ * Declare images and passes, Compile(), then use the images. Reset()
+ * retires everything to the DeletionQueue and starts a new declaration,
+ * e.g. on resize, without waiting for frames in flight.
+ */
+class TransientPool {
+public:
+    TransientPool() = default;
+    ~TransientPool() { Reset(); }
+
+    void Initialize(VkDevice device) { m_Device = device; }
+
+    TransientImage DeclareImage(const char* name, const TransientImageDesc& desc);
+
+    /**
+     * @brief Declare the next pass of the frame; passes run in declaration order
+     *
+     * TRANSIENT_IMAGE_NONE entries are ignored.
+     */
+    void DeclarePass(const char* name, std::initializer_list<TransientImage> reads, std::initializer_list<TransientImage> writes);
+
+    /**
+     * @brief Create the images, alias their memory and create full views
+     */
+    bool Compile();
+
+    void Reset();
+
+    VkImage GetImage(TransientImage image) const { return image < m_Images.size() ? m_Images[image].image : VK_NULL_HANDLE; }
+    VkImageView GetView(TransientImage image) const { return image < m_Images.size() ? m_Images[image].view : VK_NULL_HANDLE; }
+
+    const TransientPoolStats& GetStats() const { return m_Stats; }
+    void LogSummary() const;
+
+private:
+    struct ImageEntry {
+        std::string name;
+        TransientImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements = {};
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        uint32_t slot = 0;
+        bool lazy = false;
+    };
+
+    struct MemorySlot {
+        VkMemoryRequirements requirements = {};
+        std::vector<uint32_t> images;
+        Allocation allocation;
+        bool lazy = false;
+    };
+
+    bool Overlaps(const MemorySlot& slot, const ImageEntry& image) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    std::vector<ImageEntry> m_Images;
+    std::vector<std::string> m_Passes;
+    std::vector<MemorySlot> m_Slots;
+    TransientPoolStats m_Stats;
+    bool m_bCompiled = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_TRANSIENT_POOL_H
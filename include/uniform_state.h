@@ -0,0 +1,215 @@
+/**
+ * @file uniform_state.h
+ * @brief Dirty-tracked transform, material and light constants
+ *
+ * OFP sets transforms thousands of times a frame, mostly to values that
+ * are already current. The setters only mark a block dirty when its
+ * contents change, and Flush() before each draw writes just the dirty
+ * blocks into a per-frame ring and moves their dynamic offsets. A draw
+ * whose state is unchanged costs one branch, and the scene recorder
+ * skips the descriptor bind when set and offsets match the last draw.
+ *
+ * The projection is stored with the D3D to Vulkan clip-space fixup
+ * already applied and view * projection is cached, so a world change
+ * costs one matrix multiply for its world-view-projection matrix.
+ *
+ * Shader interface (set 0, all UNIFORM_BUFFER_DYNAMIC, std140, matrices
+ * in D3D8 memory order so gl_Position = worldViewProjection * position):
+ *
+ *   binding 0  TransformConstants
+ *   binding 1  ObjectConstants
+ *   binding 2  LightingConstants
+ *
+ * The binding numbers come from shader_interface.h, and the blocks are
+ * declared for the scene shaders in shaders/scene_uniforms.glsl.
+ */
+
+#ifndef OFP_RENDERER_UNIFORM_STATE_H
+#define OFP_RENDERER_UNIFORM_STATE_H
+
+#include "vulkan/vulkan.h"
+#include "matrix_math.h"
+#include "upload_ring.h"
+#include "shader_interface.h"
+#include <cstdint>
+
+namespace Bridge {
+
+const uint32_t MAX_ACTIVE_LIGHTS = SCENE_MAX_LIGHTS;    // Light indices accepted by SetLight()
+
+/**
+ * @enum UniformBlock
+ * @brief Uniform buffer blocks, in binding order
+ */
+enum UniformBlock : uint32_t {
+    UNIFORM_BLOCK_TRANSFORM = SCENE_BINDING_TRANSFORM,  // View and projection
+    UNIFORM_BLOCK_OBJECT,                   // World and the matrices derived from it
+    UNIFORM_BLOCK_LIGHTING,                 // Material, ambient, enabled lights and alpha reference
+    UNIFORM_BLOCK_COUNT
+};
+
+static_assert(UNIFORM_BLOCK_OBJECT == SCENE_BINDING_OBJECT && UNIFORM_BLOCK_LIGHTING == SCENE_BINDING_LIGHTING,
+    "Uniform blocks must be in the shaders' binding order");
+
+struct TransformConstants {
+    Math::Matrix4 view;
+    Math::Matrix4 projection;               // Including the clip-space fixup
+    Math::Matrix4 viewProjection;
+    float screenToClip[4];                  // 2 / width, 2 / height, for D3DFVF_XYZRHW positions
+};
+
+struct ObjectConstants {
+    Math::Matrix4 worldViewProjection;
+    Math::Matrix4 world;
+    Math::Matrix4 normal;                   // Inverse-transpose of the world 3x3
+};
+
+struct MaterialConstants {
+    float diffuse[4];
+    float ambient[4];
+    float specular[4];
+    float emissive[4];
+    float power;
+    float padding[3];
+};
+
+struct LightConstants {
+    float diffuse[4];
+    float specular[4];
+    float ambient[4];
+    float position[4];                      // w = range
+    float direction[4];                     // w = D3DLIGHTTYPE
+    float attenuation[4];                   // Constant, linear, quadratic, falloff
+    float spot[4];                          // cos(theta / 2), cos(phi / 2)
+};
+
+struct LightingConstants {
+    MaterialConstants material;
+    float ambient[4];                       // D3DRS_AMBIENT
+    uint32_t lightCount;                    // Enabled lights, packed at the front
+    float alphaReference;                   // D3DRS_ALPHAREF, 0-255
+    uint32_t padding[2];
+    LightConstants lights[MAX_ACTIVE_LIGHTS];
+};
+
+/**
+ * @struct UniformStats
+ * @brief Counters showing how much per-draw work the dirty tracking saves
+ */
+struct UniformStats {
+    uint64_t drawCount = 0;                 // Flush() calls
+    uint64_t cleanDrawCount = 0;            // Draws with nothing to update
+    uint64_t blockWrites[UNIFORM_BLOCK_COUNT] = {};
+    uint64_t matrixMultiplies = 0;
+    uint64_t descriptorBinds = 0;           // Flushes that changed the set or its offsets
+    VkDeviceSize bytesWritten = 0;
+};
+
+/**
+ * @brief Called before any constant changes, while the old values are current
+ */
+typedef void (*UniformChangeCallback)(void* context);
+
+/**
+ * @class UniformState
+ * @brief Shadow copy of the fixed-function constants with per-block dirty bits
+ */
+class UniformState {
+public:
+    UniformState() = default;
+    ~UniformState() { Shutdown(); }
+
+    /**
+     * @brief Create the descriptor set and pipeline layouts and the uniform ring
+     */
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Shutdown();
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+    VkPipelineLayout GetPipelineLayout() const { return m_PipelineLayout; }
+
+    /**
+     * @brief Let the owner record draws queued under the old values
+     */
+    void SetChangeCallback(UniformChangeCallback callback, void* context)
+    {
+        m_ChangeCallback = callback;
+        m_ChangeContext = context;
+    }
+
+    // Setters compare against the current value; only changes mark a block dirty.
+    void SetWorld(const Math::Matrix4& matrix);
+    void SetView(const Math::Matrix4& matrix);
+    void SetProjection(const Math::Matrix4& matrix);
+    void SetMaterial(const MaterialConstants& material);
+    void SetAmbient(const float color[4]);
+    void SetAlphaReference(float reference);
+    void SetTargetSize(uint32_t width, uint32_t height);
+    bool SetLight(uint32_t index, const LightConstants& light);
+    bool EnableLight(uint32_t index, bool enable);
+
+    /**
+     * @brief Start a new command buffer
+     *
+     * Every block is rewritten into a new descriptor set on the next
+     * Flush(), since the slot's pool and ring are reset.
+     * @param frameIndex Slot whose fence has already been waited on
+     */
+    void BeginFrame(uint32_t frameIndex);
+
+    /**
+     * @brief Write the dirty state before a draw
+     * @param descriptorSet Set 0 for the draw
+     * @param offsets Its dynamic offsets, in block order
+     * @return false if the ring or descriptor pool ran out
+     */
+    bool Flush(VkDescriptorSet& descriptorSet, uint32_t offsets[UNIFORM_BLOCK_COUNT]);
+
+    const UniformStats& GetStats() const { return m_Stats; }
+
+private:
+    static const uint32_t DIRTY_ALL = (1u << UNIFORM_BLOCK_COUNT) - 1;
+    static const uint32_t STALE_VIEW_PROJECTION = 1u << 0;
+    static const uint32_t STALE_WORLD_VIEW_PROJECTION = 1u << 1;
+    static const uint32_t STALE_NORMAL = 1u << 2;
+    static const uint32_t DESCRIPTOR_SETS_PER_FRAME = 8;
+
+    bool Update(void* state, const void* value, size_t size);
+    void UpdateMatrices();
+    bool WriteBlocks(uint32_t blocks);
+    bool AllocateDescriptorSet(VkBuffer buffer);
+    void FillLighting(LightingConstants& lighting) const;
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_DescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPools[Vulkan::MAX_FRAMES_IN_FLIGHT] = {};
+    uint32_t m_CurrentFrame = 0;
+
+    UploadRing m_Ring;
+    VkDeviceSize m_Alignment = 256;         // minUniformBufferOffsetAlignment
+    VkBuffer m_Buffer = VK_NULL_HANDLE;     // Ring buffer the current descriptor set points at
+    VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+    uint32_t m_Offsets[UNIFORM_BLOCK_COUNT] = {};
+
+    Math::Matrix4 m_Projection;             // As set, for change detection
+    TransformConstants m_Transform;
+    ObjectConstants m_Object;
+    MaterialConstants m_Material = {};
+    float m_Ambient[4] = {};
+    float m_AlphaReference = 0.0f;
+    LightConstants m_Lights[MAX_ACTIVE_LIGHTS] = {};
+    uint32_t m_EnabledLights = 0;           // Bit per light index
+    uint32_t m_Dirty = DIRTY_ALL;           // Blocks to write and bind
+    uint32_t m_Stale = 0;                   // Derived matrices to recompute first
+
+    UniformChangeCallback m_ChangeCallback = nullptr;
+    void* m_ChangeContext = nullptr;
+
+    UniformStats m_Stats;
+    bool m_bInitialized = false;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_UNIFORM_STATE_H
@@ -0,0 +1,104 @@
+/**
+ * @file upload_ring.h
+ * @brief Per-frame streaming buffer for client-memory geometry
+ *
+ * D3D8 "UP" draws hand the runtime raw vertex and index pointers on
+ * every call. The ring copies that data into persistently mapped,
+ * host-visible memory with a bump pointer; each frame-in-flight slot
+ * has its own region, reclaimed once the slot's fence has signalled.
+ */
+
+#ifndef OFP_RENDERER_UPLOAD_RING_H
+#define OFP_RENDERER_UPLOAD_RING_H
+
+#include "vulkan/vulkan.h"
+#include "vulkan_renderer.h"
+#include "memory_allocator.h"
+#include <cstdint>
+#include <vector>
+
+namespace Bridge {
+
+/**
+ * @struct UploadAllocation
+ * @brief A sub-range of the ring valid until the frame retires
+ */
+struct UploadAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void* data = nullptr;                   // Mapped pointer at offset
+};
+
+/**
+ * @struct UploadRingStats
+ * @brief Usage counters for sizing the ring
+ */
+struct UploadRingStats {
+    VkDeviceSize capacity = 0;              // Bytes per frame slot
+    VkDeviceSize lastFrameBytes = 0;        // Bytes used by the last finished frame
+    VkDeviceSize highWaterMark = 0;         // Largest per-frame usage seen
+    uint64_t allocationCount = 0;           // Total sub-allocations
+    uint32_t growCount = 0;                 // Times a frame overflowed the ring
+};
+
+/**
+ * @class UploadRing
+ * @brief Bump allocator over one mapped buffer per frame slot
+ *
+ * When a frame runs out of space an overflow chunk is chained for the
+ * rest of that frame. The next time the slot comes around its chunks
+ * are replaced by a single buffer large enough for the peak usage.
+ */
+class UploadRing {
+public:
+    UploadRing() = default;
+    ~UploadRing() { Shutdown(); }
+
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize sizePerFrame, VkBufferUsageFlags usage);
+    void Shutdown();
+
+    /**
+     * @brief Reset the bump pointer of a frame slot
+     * @param frameIndex Slot whose fence has already been waited on
+     */
+    void BeginFrame(uint32_t frameIndex);
+
+    /**
+     * @brief Reserve space in the current frame's region
+     * @return false only if a new overflow chunk could not be created
+     */
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, UploadAllocation& allocation);
+
+    const UploadRingStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Chunk {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        Vulkan::Allocation memory;
+        uint8_t* mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+    struct FrameRegion {
+        std::vector<Chunk> chunks;          // chunks.back() is the active one
+        VkDeviceSize head = 0;              // Bump pointer into chunks.back()
+        VkDeviceSize used = 0;              // Bytes used across all chunks
+    };
+
+    bool CreateChunk(VkDeviceSize size, Chunk& chunk);
+    void DestroyChunk(Chunk& chunk);
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+    VkBufferUsageFlags m_Usage = 0;
+
+    FrameRegion m_Frames[Vulkan::MAX_FRAMES_IN_FLIGHT];
+    uint32_t m_CurrentFrame = 0;
+
+    UploadRingStats m_Stats;
+    bool m_bInitialized = false;
+};
+
+} // namespace Bridge
+
+#endif // OFP_RENDERER_UPLOAD_RING_H
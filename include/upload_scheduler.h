@@ -0,0 +1,189 @@
+/**
+ * @file upload_scheduler.h
+ * @brief Batched texture uploads on a dedicated transfer queue
+ *
+ * Texture data is copied into mapped staging memory and the buffer to
+ * image copies are recorded into batches. A batch is submitted to the
+ * transfer queue when it is full or when the next frame begins, so the
+ * copies run while the graphics queue is still busy with earlier frames.
+ *
+ * With a separate transfer queue family the images change owner: each
+ * copy ends with a release barrier on the transfer queue and the frame
+ * that first sees the batch records the matching acquire barrier. The
+ * frame's submit waits on the batch's semaphore in the fragment shader
+ * stage, so everything before that keeps running during the copy.
+ *
+ * With the FrameScheduler, batches signal the transfer queue's timeline
+ * instead of a fence and a fresh binary semaphore each, and the frame
+ * waits once for the newest value it has seen.
+ */
+
+#ifndef OFP_RENDERER_UPLOAD_SCHEDULER_H
+#define OFP_RENDERER_UPLOAD_SCHEDULER_H
+
+#include "vulkan/vulkan.h"
+#include "memory_allocator.h"
+#include "texture_convert.h"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Vulkan {
+
+/**
+ * @struct ImageUpload
+ * @brief The full contents of one mip level of a 2D color image
+ *
+ * The mip level's previous contents are discarded. Afterwards it is in
+ * VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and owned by the graphics
+ * queue family.
+ */
+struct ImageUpload {
+    VkImage image = VK_NULL_HANDLE;         // Created with TRANSFER_DST and exclusive sharing
+    uint32_t width = 0;                     // Of the mip level
+    uint32_t height = 0;
+    uint32_t mipLevel = 0;
+    const void* data = nullptr;             // Rows sourcePitch bytes apart
+    VkDeviceSize size = 0;                  // Tightly packed; ignored when converting
+    uint32_t blockSize = 1;                 // Texels per block edge of raw data (4 for DXT)
+
+    // Legacy texels are expanded straight into staging memory, see texture_convert.h
+    Bridge::TextureFormat sourceFormat = Bridge::TEXTURE_FORMAT_RAW;
+    Bridge::TexelOrder texelOrder = Bridge::TEXEL_ORDER_BGRA;
+    uint32_t sourcePitch = 0;               // Bytes per source row (or block row), 0 when tightly packed
+    const uint32_t* palette = nullptr;      // For TEXTURE_FORMAT_P8, from Bridge::ConvertPalette()
+};
+
+/**
+ * @brief Identifies an upload; 0 means the upload failed
+ */
+typedef uint64_t UploadTicket;
+
+/**
+ * @struct UploadSchedulerStats
+ * @brief Counters since Initialize()
+ */
+struct UploadSchedulerStats {
+    uint64_t uploadCount = 0;
+    uint64_t uploadBytes = 0;
+    uint32_t batchCount = 0;                // Batches submitted
+    uint32_t stallCount = 0;                // Times an upload waited for a batch to be recycled
+};
+
+/**
+ * @class UploadScheduler
+ * @brief Staging batches submitted to the transfer queue
+ *
+ * With a dedicated transfer queue, uploads may come from any thread.
+ * Without one the scheduler submits to the graphics queue, and uploads
+ * must then be made on the thread that calls Renderer::EndFrame().
+ */
+class UploadScheduler {
+public:
+    static const uint32_t BATCH_COUNT = 4;
+    static const VkDeviceSize BATCH_STAGING_SIZE = 16 * 1024 * 1024;     // Also the largest single upload
+
+    static UploadScheduler& GetInstance();
+
+    /**
+     * @param queue Queue the copies are submitted to
+     * @param graphicsFamily Family whose frames use the images; ownership
+     *        is transferred when it differs from queueFamily
+     */
+    bool Initialize(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily);
+    void Shutdown();
+
+    /**
+     * @brief Copy the data to staging memory and record the upload
+     *
+     * Blocks only when every batch is still being copied by the GPU.
+     */
+    UploadTicket UploadImage(const ImageUpload& upload);
+
+    /**
+     * @brief Submit the current batch without waiting for the next frame
+     */
+    void Flush();
+
+    /**
+     * @brief True once the upload may be sampled by the frame being recorded
+     */
+    bool IsReady(UploadTicket ticket);
+
+    /**
+     * @brief Hand the submitted batches to the frame being recorded
+     *
+     * Submits the current batch and records the acquire barriers. Must be
+     * called outside a render pass, by a frame that will be submitted.
+     */
+    void BeginFrame(VkCommandBuffer commandBuffer);
+
+    /**
+     * @brief Semaphores the frame's submit must wait on (fragment shader stage)
+     *
+     * They are retired to the DeletionQueue at once and stay valid until
+     * the frame being recorded has finished. Fence path only.
+     */
+    void TakeWaitSemaphores(std::vector<VkSemaphore>& semaphores);
+
+    /**
+     * @brief Transfer queue timeline value the frame's submit must wait on
+     *
+     * Fragment shader stage; 0 if the frame saw no new batch. Timeline path only.
+     */
+    uint64_t TakeWaitValue();
+
+    bool IsOwnershipTransfer() const { return m_QueueFamily != m_GraphicsFamily; }
+    const UploadSchedulerStats& GetStats() const { return m_Stats; }
+
+private:
+    UploadScheduler() = default;
+    ~UploadScheduler() { Shutdown(); }
+    UploadScheduler(const UploadScheduler&) = delete;
+    UploadScheduler& operator=(const UploadScheduler&) = delete;
+
+    struct Batch {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;     // Signalled when the copies are done (fence path)
+        uint64_t timelineValue = 0;         // Same, on the transfer queue's timeline
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        Allocation stagingMemory;
+        VkDeviceSize used = 0;
+        uint32_t uploadCount = 0;
+        bool submitted = false;
+    };
+
+    bool OpenBatch();
+    void SubmitBatch();
+
+    VkDevice m_Device = VK_NULL_HANDLE;
+    VkQueue m_Queue = VK_NULL_HANDLE;
+    uint32_t m_QueueFamily = 0;
+    uint32_t m_GraphicsFamily = 0;
+
+    Batch m_Batches[BATCH_COUNT];
+    uint32_t m_CurrentBatch = 0;
+    bool m_bBatchOpen = false;
+
+    // Submitted but not yet seen by a frame
+    std::vector<VkImageMemoryBarrier> m_PendingAcquires;
+    std::vector<VkSemaphore> m_PendingSemaphores;
+    // Seen by the frame being recorded
+    std::vector<VkSemaphore> m_FrameSemaphores;
+    // Timeline path: newest submitted batch, and the newest one seen by the frame
+    uint64_t m_PendingValue = 0;
+    uint64_t m_FrameValue = 0;
+
+    UploadTicket m_NextTicket = 1;
+    UploadTicket m_ReadyTicket = 0;         // Highest ticket acquired by a frame
+    UploadSchedulerStats m_Stats;
+
+    std::mutex m_Mutex;
+    bool m_bTimeline = false;               // Submit through the FrameScheduler
+    bool m_bInitialized = false;
+};
+
+} // namespace Vulkan
+
+#endif // OFP_RENDERER_UPLOAD_SCHEDULER_H
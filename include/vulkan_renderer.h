@@ -9,17 +9,39 @@
 #ifndef OFP_RENDERER_VULKAN_RENDERER_H
 #define OFP_RENDERER_VULKAN_RENDERER_H
 
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#endif
+#include "platform.h"
 #include "vulkan/vulkan.h"
+#include "config.h"
+#include "memory_allocator.h"
 #include <vector>
 #include <memory>
 #include <cstdint>
 
 namespace Vulkan {
 
+/**
+ * @brief Upper bound for RendererSettings::framesInFlight
+ */
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+/**
+ * @struct FrameData
+ * @brief Per-slot resources of the frames-in-flight ring
+ *
+ * Each slot owns its command pool so the whole pool can be reset once
+ * the slot's last submit has finished, without touching frames the GPU is
+ * still working on. That submit is tracked by a fence or, with the
+ * FrameScheduler, by its value on the graphics queue's timeline.
+ */
+struct FrameData {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    VkFence inFlightFence = VK_NULL_HANDLE;     // Fence path only
+    uint64_t timelineValue = 0;                 // Timeline path only; 0 before the first submit
+};
+
 /**
  * @class Renderer
  * @brief Main Vulkan rendering engine
@@ -27,7 +49,7 @@ namespace Vulkan {
  * This class handles:
  * - Vulkan instance and device creation
  * - Swap chain management
- * - Render pass and pipeline creation
+ * - Render pass (or dynamic rendering) and pipeline creation
  * - Frame rendering
  * - Present to screen
  */
@@ -44,6 +66,20 @@ public:
      */
     bool Initialize(HWND hwnd, uint32_t width, uint32_t height);
     
+    /**
+     * @brief Initialize without a window, surface or swap chain
+     *
+     * Frames render into offscreen images (one per frame slot). Works on
+     * software drivers such as lavapipe; tools/headless_render_test.cpp
+     * draws and reads back a frame this way.
+     *
+     * @param width Render target width
+     * @param height Render target height
+     * @param enableReadback Copy each frame into host memory for ReadbackFrame()
+     * @return true if successful
+     */
+    bool InitializeHeadless(uint32_t width, uint32_t height, bool enableReadback);
+    
     /**
      * @brief Shutdown the renderer and release resources
      */
@@ -60,6 +96,14 @@ public:
      */
     void EndFrame();
     
+    /**
+     * @brief Copy the last submitted headless frame to host memory
+     *
+     * Waits for that frame's fence or timeline value. Pixels are tightly packed BGRA8 rows.
+     * @return false if readback was not enabled or no frame was submitted
+     */
+    bool ReadbackFrame(std::vector<uint8_t>& pixels);
+    
     /**
      * @brief Render the scene
      */
@@ -70,23 +114,67 @@ public:
      */
     void RenderUI();
     
+    /**
+     * @brief Bind the base pipeline with a full-frame viewport and scissor
+     *
+     * Both are dynamic, so they follow the swap chain without rebuilding
+     * the pipeline. Secondary command buffers inherit neither, so call
+     * this in each one that draws with GetPipeline().
+     */
+    void BindPipeline(VkCommandBuffer commandBuffer) const;
+    
     /**
      * @brief Handle window resize
+     *
+     * The swap chain is recreated at the start of the next frame. Without
+     * an explicit call the renderer still recreates it when acquire or
+     * present report it out of date or suboptimal (alt-tab, mode changes).
      */
     void Resize(uint32_t width, uint32_t height);
     
     // Getters
-    VkInstance GetVkInstance() const { return m_Instance; }
-    VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
-    VkDevice GetDevice() const { return m_Device; }
-    VkQueue GetGraphicsQueue() const { return m_GraphicsQueue; }
-    VkCommandBuffer GetCommandBuffer() const { return m_CommandBuffer; }
-    VkRenderPass GetRenderPass() const { return m_RenderPass; }
-    VkFramebuffer GetFramebuffer() const { return m_Framebuffers[0]; }
+    VkInstance GetVkInstance() const { return m_VkInstance; }
+    VkPhysicalDevice GetPhysicalDevice() const { return m_VkPhysicalDevice; }
+    VkDevice GetDevice() const { return m_VkDevice; }
+    VkQueue GetGraphicsQueue() const { return m_VkGraphicsQueue; }
+    VkQueue GetTransferQueue() const { return m_VkTransferQueue; }     // The graphics queue if there is no transfer family
+    VkCommandBuffer GetCommandBuffer() const { return m_Frames[m_CurrentFrame].commandBuffer; }
+    VkRenderPass GetRenderPass() const { return m_VkRenderPass; }
+    VkFramebuffer GetFramebuffer() const { return m_Framebuffers.empty() ? VK_NULL_HANDLE : m_Framebuffers[m_ImageIndex]; }
+    VkFormat GetColorFormat() const { return m_SurfaceFormat.format; }
+    VkPipeline GetPipeline() const { return m_VkPipeline; }             // basic.vert/.frag: clip-space XYZ + UV, 20-byte stride
+    
+    /**
+     * @brief Whether the scene is drawn with dynamic rendering
+     *
+     * GetRenderPass() and GetFramebuffer() are then VK_NULL_HANDLE, and
+     * pipelines chain a VkPipelineRenderingCreateInfo with
+     * GetColorFormat() instead. See dynamic_rendering.h.
+     */
+    bool UsesDynamicRendering() const { return m_bDynamicRendering; }
+    
+    /**
+     * @brief Whether submits go through the FrameScheduler
+     *
+     * Frames and upload batches then signal timeline semaphores through
+     * vkQueueSubmit2 instead of fences. See frame_scheduler.h.
+     */
+    bool UsesTimelineSemaphores() const { return m_bTimelineScheduler; }
     
     uint32_t GetWidth() const { return m_Width; }
     uint32_t GetHeight() const { return m_Height; }
-    bool IsInitialized() const { return m_Initialized; }
+    uint32_t GetCurrentFrame() const { return m_CurrentFrame; }
+    uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+    bool IsInitialized() const { return m_bInitialized; }
+    bool IsHeadless() const { return m_bHeadless; }
+    bool SupportsBCTextures() const { return m_bTextureCompressionBC; }    // DXT1-5 upload as BC1-3
+    uint32_t GetGraphicsQueueFamily() const { return m_GraphicsQueueFamily; }
+    uint32_t GetTransferQueueFamily() const { return m_TransferQueueFamily; }
+    
+    /**
+     * @brief Show per-pass GPU timings as bars in RenderUI()
+     */
+    void SetGpuProfilerOverlay(bool enabled) { m_bShowGpuProfiler = enabled; }
     
 private:
     Renderer() = default;
@@ -94,41 +182,53 @@ private:
     
     bool CreateInstance();
     bool CreateSurface(HWND hwnd);
-    bool PickPhysicalDevice();
-    bool CreateLogicalDevice();
+    bool CreateDevice(HWND hwnd);
     bool CreateSwapChain(uint32_t width, uint32_t height);
-    bool CreateImageViews();
+    bool CreateOffscreenTargets(uint32_t width, uint32_t height);
     bool CreateRenderPass();
-    bool CreateGraphicsPipeline();
     bool CreateFramebuffers();
     bool CreateCommandPool();
     bool CreateCommandBuffer();
-    bool CreateSynchronization();
+    bool CreateSynchronizationObjects();
+    bool CreateShaders();
+    bool CreatePipeline();
+    void UpdatePipeline();
+    void RecordReadback(VkCommandBuffer commandBuffer);
+    void WaitForFrameSlot(uint32_t slot);
     
     void CleanupSwapChain();
-    void RecreateSwapChain(uint32_t width, uint32_t height);
+    bool RecreateSwapChain(uint32_t width, uint32_t height);
+    
+    Config::RendererSettings m_Config;
     
-    VkInstance m_Instance = VK_NULL_HANDLE;
-    VkSurfaceKHR m_Surface = VK_NULL_HANDLE;
-    VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
-    VkDevice m_Device = VK_NULL_HANDLE;
-    VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
-    VkSwapchainKHR m_SwapChain = VK_NULL_HANDLE;
+    VkInstance m_VkInstance = VK_NULL_HANDLE;
+    VkSurfaceKHR m_VkSurface = VK_NULL_HANDLE;
+    VkPhysicalDevice m_VkPhysicalDevice = VK_NULL_HANDLE;
+    VkDevice m_VkDevice = VK_NULL_HANDLE;
+    VkQueue m_VkGraphicsQueue = VK_NULL_HANDLE;
+    uint32_t m_GraphicsQueueFamily = 0;
+    VkQueue m_VkTransferQueue = VK_NULL_HANDLE;
+    uint32_t m_TransferQueueFamily = 0;
+    VkSwapchainKHR m_VkSwapChain = VK_NULL_HANDLE;
+    uint32_t m_InstanceVersion = VK_API_VERSION_1_0;
     
     std::vector<VkImage> m_SwapChainImages;
     std::vector<VkImageView> m_SwapChainImageViews;
     std::vector<VkFramebuffer> m_Framebuffers;
+    std::vector<uint32_t> m_ImageFrameSlots;  // Frame slot last rendering to each image, UINT32_MAX if none
     
-    VkRenderPass m_RenderPass = VK_NULL_HANDLE;
-    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
-    VkPipeline m_GraphicsPipeline = VK_NULL_HANDLE;
+    VkRenderPass m_VkRenderPass = VK_NULL_HANDLE;
+    VkPipelineLayout m_VkPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_VkPipeline = VK_NULL_HANDLE;
+    VkShaderModule m_VkVertexShader = VK_NULL_HANDLE;
+    VkShaderModule m_VkFragmentShader = VK_NULL_HANDLE;
     
-    VkCommandPool m_CommandPool = VK_NULL_HANDLE;
-    VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+    FrameData m_Frames[MAX_FRAMES_IN_FLIGHT];
     
-    VkSemaphore m_ImageAvailableSemaphore = VK_NULL_HANDLE;
-    VkSemaphore m_RenderFinishedSemaphore = VK_NULL_HANDLE;
-    VkFence m_InFlightFence = VK_NULL_HANDLE;
+    // Headless mode: offscreen images stand in for the swap chain images
+    std::vector<Allocation> m_OffscreenMemory;
+    VkBuffer m_ReadbackBuffers[MAX_FRAMES_IN_FLIGHT] = {};
+    Allocation m_ReadbackMemory[MAX_FRAMES_IN_FLIGHT];
     
     VkExtent2D m_SwapChainExtent;
     VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
@@ -136,10 +236,25 @@ private:
     
     uint32_t m_Width = 0;
     uint32_t m_Height = 0;
+    uint32_t m_FramesInFlight = 2;
     uint32_t m_CurrentFrame = 0;
+    uint32_t m_ImageIndex = 0;
+    uint32_t m_LastSubmittedFrame = UINT32_MAX;
+    uint64_t m_SubmittedFrames = 0;
+    uint32_t m_PendingWidth = 0;            // Requested by Resize(); 0 = use the surface extent
+    uint32_t m_PendingHeight = 0;
     
-    bool m_Initialized = false;
-    bool m_VSyncEnabled = false;
+    bool m_bInitialized = false;
+    bool m_bVSyncEnabled = false;
+    bool m_bHeadless = false;
+    bool m_bTextureCompressionBC = false;
+    bool m_bDynamicRendering = false;       // No render pass or framebuffers; see UsesDynamicRendering()
+    bool m_bTimelineScheduler = false;      // Timeline semaphores instead of fences; see UsesTimelineSemaphores()
+    bool m_bReadback = false;
+    bool m_bSwapChainDirty = false;         // Recreate before the next acquire
+    bool m_bShowGpuProfiler = false;
+    std::wstring m_FrameStatsPath;          // CSV written on Shutdown and on the hotkey
+    UINT m_FrameStatsHotkey = 0;            // Virtual-key code, 0 disables
 };
 
 } // namespace Vulkan
@@ -0,0 +1,11 @@
+#version 450
+
+// The base pipeline has nothing to sample, so the texture coordinate is
+// the color: red and green follow u and v, blue marks covered pixels.
+
+layout(location = 0) in vec2 inTexCoord;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(inTexCoord, 1.0, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 450
+
+// Base pipeline of the renderer: position and texture coordinate, already
+// in clip space, interleaved in one binding with no descriptors.
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+
+layout(location = 0) out vec2 outTexCoord;
+
+void main() {
+    outTexCoord = inTexCoord;
+    gl_Position = vec4(inPosition, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 450
+
+// One triangle covering the screen, drawn with vkCmdDraw(3) and no vertex
+// buffer. Vertices 0-2 map to uv (0,0), (2,0), (0,2); the parts outside
+// the viewport are clipped, and Vulkan clip space has y pointing down.
+
+layout(location = 0) out vec2 outTexCoord;
+
+void main() {
+    outTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(outTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,63 @@
+#version 450
+
+// Fused post-processing chain. The enabled effects and their order are
+// specialization constants, so every permutation compiles down to only
+// the effects it uses; strengths come from push constants.
+
+// Bit per effect id: 0 hard light, 1 desaturate, 2 glare
+layout(constant_id = 0) const uint EFFECT_MASK = 0;
+// Effect id per slot, 4 bits each, first slot in the low bits; 0xF = empty
+layout(constant_id = 1) const uint EFFECT_ORDER = 0xFFF;
+
+layout(binding = 0) uniform sampler2D inputTexture;
+layout(binding = 1) uniform sampler2D bloomTexture;   // Level 0 of the bloom chain
+
+layout(push_constant) uniform Params {
+    vec4 hardLight;         // rgb strength
+    float desaturation;
+    float glareStrength;
+    float glareSize;        // Bloom levels summed into bloomTexture
+    float glareDarkenSky;   // 1 to dim what the glow covers, 0 to only add it
+} params;
+
+layout(location = 0) in vec2 inTexCoord;
+layout(location = 0) out vec4 outColor;
+
+vec3 applyHardLight(vec3 color) {
+    vec3 hardLight = color * 2.0;
+    hardLight = mix(hardLight, 1.0 - 2.0 * (1.0 - color), step(0.5, color));
+    return mix(color, hardLight, params.hardLight.rgb);
+}
+
+vec3 applyDesaturate(vec3 color) {
+    float luminance = dot(color, vec3(0.299, 0.587, 0.114));
+    return mix(color, vec3(luminance), params.desaturation);
+}
+
+vec3 applyGlare(vec3 color) {
+    vec3 bloom = texture(bloomTexture, inTexCoord).rgb / max(params.glareSize, 1.0) * params.glareStrength;
+    // Darken sky: large bright areas, the sky above all, are dimmed by up
+    // to half under their own glow, so they keep some contrast instead of
+    // washing out to white.
+    float glow = dot(bloom, vec3(0.299, 0.587, 0.114));
+    color *= 1.0 - params.glareDarkenSky * min(glow, 0.5);
+    return color + bloom;
+}
+
+vec3 applyEffect(uint id, vec3 color) {
+    if ((EFFECT_MASK & (1u << id)) == 0u) return color;
+    if (id == 0u) return applyHardLight(color);
+    if (id == 1u) return applyDesaturate(color);
+    if (id == 2u) return applyGlare(color);
+    return color;
+}
+
+void main() {
+    vec4 color = texture(inputTexture, inTexCoord);
+
+    color.rgb = applyEffect((EFFECT_ORDER >> 0) & 0xFu, color.rgb);
+    color.rgb = applyEffect((EFFECT_ORDER >> 4) & 0xFu, color.rgb);
+    color.rgb = applyEffect((EFFECT_ORDER >> 8) & 0xFu, color.rgb);
+
+    outColor = color;
+}
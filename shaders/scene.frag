@@ -0,0 +1,45 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Fragment stage of the D3D8 bridge pipelines: the interpolated vertex
+// color, with the D3D alpha test. The compare op is a specialization
+// constant, so pipelines without the test compile the branch away; the
+// reference is dynamic and comes from the lighting block.
+
+#include "../include/shader_interface.h"
+#include "scene_uniforms.glsl"
+
+// VkCompareOp values
+const uint COMPARE_NEVER = 0u;
+const uint COMPARE_LESS = 1u;
+const uint COMPARE_EQUAL = 2u;
+const uint COMPARE_LESS_OR_EQUAL = 3u;
+const uint COMPARE_GREATER = 4u;
+const uint COMPARE_NOT_EQUAL = 5u;
+const uint COMPARE_GREATER_OR_EQUAL = 6u;
+const uint COMPARE_ALWAYS = 7u;
+
+layout(constant_id = SCENE_SPEC_ALPHA_COMPARE_OP) const uint ALPHA_COMPARE_OP = 7u;   // COMPARE_ALWAYS
+
+layout(location = 0) in vec4 inColor;
+layout(location = 0) out vec4 outColor;
+
+bool alphaTest(float alpha) {
+    // D3D compares 8-bit values; compare whole steps so EQUAL works.
+    float value = floor(alpha * 255.0 + 0.5);
+    float reference = lighting.alphaReference;
+
+    if (ALPHA_COMPARE_OP == COMPARE_NEVER) return false;
+    if (ALPHA_COMPARE_OP == COMPARE_LESS) return value < reference;
+    if (ALPHA_COMPARE_OP == COMPARE_EQUAL) return value == reference;
+    if (ALPHA_COMPARE_OP == COMPARE_LESS_OR_EQUAL) return value <= reference;
+    if (ALPHA_COMPARE_OP == COMPARE_GREATER) return value > reference;
+    if (ALPHA_COMPARE_OP == COMPARE_NOT_EQUAL) return value != reference;
+    if (ALPHA_COMPARE_OP == COMPARE_GREATER_OR_EQUAL) return value >= reference;
+    return true;
+}
+
+void main() {
+    if (ALPHA_COMPARE_OP != COMPARE_ALWAYS && !alphaTest(inColor.a)) discard;
+    outColor = inColor;
+}
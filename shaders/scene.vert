@@ -0,0 +1,98 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Fixed-function vertex processing for the D3D8 bridge. Untransformed
+// vertices go through the world-view-projection block, or through the
+// instance's own world matrix for instanced batches, and, when they have
+// a normal, per-vertex D3D lighting with the material and enabled
+// lights; pretransformed (XYZRHW) vertices are in render-target pixels.
+
+#include "../include/shader_interface.h"
+#include "scene_uniforms.glsl"
+
+layout(constant_id = SCENE_SPEC_INSTANCED) const bool INSTANCED = false;
+layout(constant_id = SCENE_SPEC_VERTEX_FORMAT) const uint VERTEX_FORMAT = 0u;
+
+// D3DLIGHTTYPE; anything else is a point light
+const uint LIGHT_SPOT = 2u;
+const uint LIGHT_DIRECTIONAL = 3u;
+
+layout(location = SCENE_LOCATION_POSITION) in vec4 inPosition;   // w = 1 for XYZ, rhw for XYZRHW
+layout(location = SCENE_LOCATION_NORMAL) in vec3 inNormal;
+layout(location = SCENE_LOCATION_DIFFUSE) in vec4 inDiffuse;
+// D3D8 rows, so columns of the GLSL matrix, like the uniform blocks
+layout(location = SCENE_LOCATION_INSTANCE_WORLD) in mat4 inInstanceWorld;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 applyLight(LightData light, vec3 position, vec3 normal, vec3 diffuse) {
+    uint type = uint(light.direction.w);
+    vec3 toLight;
+    float attenuation = 1.0;
+
+    if (type == LIGHT_DIRECTIONAL) {
+        toLight = -normalize(light.direction.xyz);
+    } else {
+        vec3 delta = light.position.xyz - position;
+        float lightDistance = length(delta);
+        if (lightDistance > light.position.w) return vec3(0.0);
+
+        toLight = delta / max(lightDistance, 1e-6);
+        float falloff = dot(light.attenuation.xyz, vec3(1.0, lightDistance, lightDistance * lightDistance));
+        attenuation = 1.0 / max(falloff, 1e-6);
+
+        if (type == LIGHT_SPOT) {
+            // Full inside theta, none outside phi, falloff power in between
+            float rho = dot(-toLight, normalize(light.direction.xyz));
+            if (rho <= light.spot.y) return vec3(0.0);
+            if (rho < light.spot.x) {
+                attenuation *= pow((rho - light.spot.y) / (light.spot.x - light.spot.y), light.attenuation.w);
+            }
+        }
+    }
+
+    vec3 ambient = light.ambient.rgb * lighting.material.ambient.rgb;
+    vec3 lit = light.diffuse.rgb * diffuse * max(dot(normal, toLight), 0.0);
+    return attenuation * (ambient + lit);
+}
+
+void main() {
+    bool hasDiffuse = (VERTEX_FORMAT & SCENE_FORMAT_DIFFUSE) != 0u;
+
+    if ((VERTEX_FORMAT & SCENE_FORMAT_PRETRANSFORMED) != 0u) {
+        // D3D pixel centers are at integer coordinates, Vulkan's at +0.5.
+        vec2 ndc = (inPosition.xy + 0.5) * transforms.screenToClip.xy - 1.0;
+        gl_Position = vec4(ndc, inPosition.z, 1.0) / inPosition.w;
+        outColor = hasDiffuse ? inDiffuse : vec4(1.0);
+        return;
+    }
+
+    vec4 position = vec4(inPosition.xyz, 1.0);
+    vec4 worldPosition;
+    if (INSTANCED) {
+        worldPosition = inInstanceWorld * position;
+        gl_Position = transforms.viewProjection * worldPosition;
+    } else {
+        worldPosition = objectData.world * position;
+        gl_Position = objectData.worldViewProjection * position;
+    }
+
+    // Without a normal there is nothing to light; D3D uses the vertex color.
+    if ((VERTEX_FORMAT & SCENE_FORMAT_NORMAL) == 0u) {
+        outColor = hasDiffuse ? inDiffuse : vec4(1.0);
+        return;
+    }
+
+    // Instances have no precomputed normal matrix; invert their world 3x3 here.
+    mat3 normalMatrix = INSTANCED ? transpose(inverse(mat3(inInstanceWorld))) : mat3(objectData.normal);
+    vec3 normal = normalize(normalMatrix * inNormal);
+
+    // D3DMCS_COLOR1, the default diffuse source, prefers the vertex color.
+    vec4 diffuse = hasDiffuse ? inDiffuse : lighting.material.diffuse;
+    vec3 color = lighting.material.emissive.rgb + lighting.ambient.rgb * lighting.material.ambient.rgb;
+    for (uint i = 0u; i < lighting.lightCount; i++) {
+        color += applyLight(lighting.lights[i], worldPosition.xyz, normal, diffuse.rgb);
+    }
+
+    outColor = vec4(clamp(color, 0.0, 1.0), diffuse.a);
+}
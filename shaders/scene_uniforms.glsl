@@ -0,0 +1,42 @@
+// Set 0 uniform blocks of the scene shaders. Mirrors TransformConstants,
+// ObjectConstants and LightingConstants in uniform_state.h; matrices are
+// in D3D8 memory order, so they multiply column vectors from the left.
+
+struct MaterialData {
+    vec4 diffuse;
+    vec4 ambient;
+    vec4 specular;
+    vec4 emissive;
+    float power;
+};
+
+struct LightData {
+    vec4 diffuse;
+    vec4 specular;
+    vec4 ambient;
+    vec4 position;          // w = range
+    vec4 direction;         // w = D3DLIGHTTYPE
+    vec4 attenuation;       // Constant, linear, quadratic, falloff
+    vec4 spot;              // cos(theta / 2), cos(phi / 2)
+};
+
+layout(set = 0, binding = SCENE_BINDING_TRANSFORM, std140) uniform TransformConstants {
+    mat4 view;
+    mat4 projection;        // Including the clip-space fixup
+    mat4 viewProjection;
+    vec4 screenToClip;      // 2 / width, 2 / height of the render target
+} transforms;
+
+layout(set = 0, binding = SCENE_BINDING_OBJECT, std140) uniform ObjectConstants {
+    mat4 worldViewProjection;
+    mat4 world;
+    mat4 normal;            // Inverse-transpose of the world 3x3
+} objectData;
+
+layout(set = 0, binding = SCENE_BINDING_LIGHTING, std140) uniform LightingConstants {
+    MaterialData material;
+    vec4 ambient;           // D3DRS_AMBIENT
+    uint lightCount;        // Enabled lights, packed at the front
+    float alphaReference;   // D3DRS_ALPHAREF, 0-255
+    LightData lights[SCENE_MAX_LIGHTS];
+} lighting;
@@ -0,0 +1,401 @@
+#include "bloom.h"
+#include "post_processing.h"
+#include "deletion_queue.h"
+#include "pipeline_cache.h"
+
+namespace PostProcessing {
+
+namespace {
+
+const VkFormat BLOOM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+const uint32_t GROUP_SIZE = 8;
+
+// Bright-pass on the 8-bit scene: everything above the threshold blooms,
+// with a soft knee below it instead of a hard cut.
+const float BLOOM_THRESHOLD = 0.7f;
+const float BLOOM_KNEE = 0.35f;
+const float UPSAMPLE_RADIUS = 1.0f;
+
+// Layouts as in shaders/bloom_downsample.comp and bloom_upsample.comp
+struct DownsampleParams {
+    float sourceTexelSize[2];
+    float threshold;
+    float knee;
+    uint32_t prefilter;
+};
+
+struct UpsampleParams {
+    float sourceTexelSize[2];
+    float radius;
+};
+
+void ComputeBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStage)
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStage, 0,
+        1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+} // namespace
+
+bool Bloom::Initialize(VkDevice device, VkSampler sampler)
+{
+    m_Device = device;
+    m_Sampler = sampler;
+
+    if (!LoadShaderModule(m_Device, "bloom_downsample.comp", m_DownsampleShader) ||
+        !LoadShaderModule(m_Device, "bloom_upsample.comp", m_UpsampleShader))
+    {
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    return CreatePipelines();
+}
+
+bool Bloom::CreatePipelines()
+{
+    VkPushConstantRange pushConstants{};
+    pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstants.offset = 0;
+    pushConstants.size = sizeof(DownsampleParams);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstants;
+
+    if (vkCreatePipelineLayout(m_Device, &layoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkComputePipelineCreateInfo pipelineInfos[2] = {};
+    VkShaderModule modules[2] = {m_DownsampleShader, m_UpsampleShader};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        pipelineInfos[i].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfos[i].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfos[i].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfos[i].stage.module = modules[i];
+        pipelineInfos[i].stage.pName = "main";
+        pipelineInfos[i].layout = m_PipelineLayout;
+    }
+
+    VkPipeline pipelines[2] = {};
+    if (Vulkan::PipelineCache::GetInstance().CreateComputePipelines(2, pipelineInfos, pipelines) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[Bloom] Failed to create compute pipelines\n");
+        return false;
+    }
+
+    m_DownsamplePipeline = pipelines[0];
+    m_UpsamplePipeline = pipelines[1];
+    return true;
+}
+
+void Bloom::Shutdown()
+{
+    if (!m_Device) return;
+
+    CleanupTargets();
+
+    if (m_DownsamplePipeline) vkDestroyPipeline(m_Device, m_DownsamplePipeline, nullptr);
+    if (m_UpsamplePipeline) vkDestroyPipeline(m_Device, m_UpsamplePipeline, nullptr);
+    if (m_PipelineLayout) vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+    if (m_DescriptorSetLayout) vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
+    if (m_DownsampleShader) vkDestroyShaderModule(m_Device, m_DownsampleShader, nullptr);
+    if (m_UpsampleShader) vkDestroyShaderModule(m_Device, m_UpsampleShader, nullptr);
+
+    m_DownsamplePipeline = VK_NULL_HANDLE;
+    m_UpsamplePipeline = VK_NULL_HANDLE;
+    m_PipelineLayout = VK_NULL_HANDLE;
+    m_DescriptorSetLayout = VK_NULL_HANDLE;
+    m_DownsampleShader = VK_NULL_HANDLE;
+    m_UpsampleShader = VK_NULL_HANDLE;
+    m_Device = VK_NULL_HANDLE;
+}
+
+void Bloom::DeclareTargets(Vulkan::TransientPool& pool, UINT width, UINT height)
+{
+    // Level 0 is half resolution; stop before a level gets thinner than
+    // the tent filter.
+    m_SourceExtent = {width, height};
+    m_LevelCount = 0;
+    UINT levelWidth = width / 2;
+    UINT levelHeight = height / 2;
+    while (m_LevelCount < MAX_LEVELS && levelWidth >= 2 && levelHeight >= 2)
+    {
+        m_LevelExtents[m_LevelCount++] = {levelWidth, levelHeight};
+        levelWidth /= 2;
+        levelHeight /= 2;
+    }
+
+    m_Level0 = Vulkan::TRANSIENT_IMAGE_NONE;
+    m_Chain = Vulkan::TRANSIENT_IMAGE_NONE;
+    if (m_LevelCount == 0) return;
+
+    Vulkan::TransientImageDesc desc;
+    desc.format = BLOOM_FORMAT;
+    desc.width = m_LevelExtents[0].width;
+    desc.height = m_LevelExtents[0].height;
+    desc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    m_Level0 = pool.DeclareImage("BloomLevel0", desc);
+
+    if (m_LevelCount > 1)
+    {
+        desc.width = m_LevelExtents[1].width;
+        desc.height = m_LevelExtents[1].height;
+        desc.mipLevels = m_LevelCount - 1;
+        m_Chain = pool.DeclareImage("BloomChain", desc);
+    }
+}
+
+bool Bloom::CreateTargets(const Vulkan::TransientPool& pool, const VkImageView sources[2])
+{
+    if (m_LevelCount == 0) return false;
+
+    m_Images[0] = pool.GetImage(m_Level0);
+    m_Images[1] = pool.GetImage(m_Chain);
+
+    for (uint32_t level = 0; level < m_LevelCount; level++)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = level == 0 ? m_Images[0] : m_Images[1];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = BLOOM_FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level == 0 ? 0 : level - 1;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_LevelViews[level]) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[Bloom] Failed to create mip view\n");
+            return false;
+        }
+    }
+
+    // A new pool per chain: frames in flight may still bind the previous
+    // chain's sets, so that pool is retired rather than reset. It is sized
+    // for the deepest chain.
+    const uint32_t maxSets = 2 + 2 * MAX_LEVELS;
+    VkDescriptorPoolSize poolSizes[2] = {};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = maxSets;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = maxSets;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = maxSets;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[Bloom] Failed to create descriptor pool\n");
+        return false;
+    }
+
+    // One set per dispatch: sources, downsample levels 1.., upsample levels ..n-2
+    const uint32_t setCount = 2 + 2 * (m_LevelCount - 1);
+    VkDescriptorSetLayout layouts[2 + 2 * MAX_LEVELS];
+    for (uint32_t i = 0; i < setCount; i++) layouts[i] = m_DescriptorSetLayout;
+
+    VkDescriptorSet sets[2 + 2 * MAX_LEVELS] = {};
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts;
+
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, sets) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[Bloom] Failed to allocate descriptor sets\n");
+        return false;
+    }
+
+    VkDescriptorImageInfo imageInfos[2 * (2 + 2 * MAX_LEVELS)] = {};
+    VkWriteDescriptorSet writes[2 * (2 + 2 * MAX_LEVELS)] = {};
+    uint32_t writeCount = 0;
+
+    auto addSet = [&](VkDescriptorSet set, VkImageView input, VkImageLayout inputLayout, VkImageView output)
+    {
+        VkDescriptorImageInfo& sampled = imageInfos[writeCount];
+        sampled.sampler = m_Sampler;
+        sampled.imageView = input;
+        sampled.imageLayout = inputLayout;
+
+        VkWriteDescriptorSet& sampledWrite = writes[writeCount++];
+        sampledWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        sampledWrite.dstSet = set;
+        sampledWrite.dstBinding = 0;
+        sampledWrite.descriptorCount = 1;
+        sampledWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sampledWrite.pImageInfo = &sampled;
+
+        VkDescriptorImageInfo& storage = imageInfos[writeCount];
+        storage.imageView = output;
+        storage.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet& storageWrite = writes[writeCount++];
+        storageWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        storageWrite.dstSet = set;
+        storageWrite.dstBinding = 1;
+        storageWrite.descriptorCount = 1;
+        storageWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        storageWrite.pImageInfo = &storage;
+    };
+
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        m_SourceSets[i] = sets[next++];
+        addSet(m_SourceSets[i], sources[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_LevelViews[0]);
+    }
+    for (uint32_t level = 1; level < m_LevelCount; level++)
+    {
+        m_DownsampleSets[level] = sets[next++];
+        addSet(m_DownsampleSets[level], m_LevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, m_LevelViews[level]);
+    }
+    for (uint32_t level = 0; level + 1 < m_LevelCount; level++)
+    {
+        m_UpsampleSets[level] = sets[next++];
+        addSet(m_UpsampleSets[level], m_LevelViews[level + 1], VK_IMAGE_LAYOUT_GENERAL, m_LevelViews[level]);
+    }
+
+    vkUpdateDescriptorSets(m_Device, writeCount, writes, 0, nullptr);
+
+    char msg[128];
+    sprintf_s(msg, "[Bloom] %u levels from %ux%u\n", m_LevelCount, m_LevelExtents[0].width, m_LevelExtents[0].height);
+    OutputDebugStringA(msg);
+
+    return true;
+}
+
+void Bloom::CleanupTargets()
+{
+    Vulkan::DeletionQueue& deletionQueue = Vulkan::DeletionQueue::GetInstance();
+    deletionQueue.DestroyDescriptorPool(m_DescriptorPool);
+
+    for (uint32_t level = 0; level < MAX_LEVELS; level++)
+    {
+        deletionQueue.DestroyImageView(m_LevelViews[level]);
+        m_DownsampleSets[level] = VK_NULL_HANDLE;
+        m_UpsampleSets[level] = VK_NULL_HANDLE;
+    }
+    m_SourceSets[0] = m_SourceSets[1] = VK_NULL_HANDLE;
+
+    // The images themselves belong to the transient pool.
+    m_Images[0] = m_Images[1] = VK_NULL_HANDLE;
+}
+
+uint32_t Bloom::ClampLevels(int levels) const
+{
+    if (levels < 1) return 1;
+    return (uint32_t)levels < m_LevelCount ? (uint32_t)levels : m_LevelCount;
+}
+
+void Bloom::Record(VkCommandBuffer commandBuffer, uint32_t source, uint32_t levels)
+{
+    if (!m_Images[0] || !commandBuffer) return;
+    levels = ClampLevels((int)levels);
+
+    // The source was just rendered or copied; the chain is rewritten from
+    // scratch, so its previous contents (sampled last frame) are discarded.
+    VkMemoryBarrier sourceBarrier{};
+    sourceBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    sourceBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    sourceBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkImageMemoryBarrier chainBarriers[2] = {};
+    uint32_t chainBarrierCount = m_Images[1] ? 2 : 1;
+    for (uint32_t i = 0; i < chainBarrierCount; i++)
+    {
+        chainBarriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        chainBarriers[i].srcAccessMask = 0;
+        chainBarriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        chainBarriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        chainBarriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        chainBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        chainBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        chainBarriers[i].image = m_Images[i];
+        chainBarriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        chainBarriers[i].subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        chainBarriers[i].subresourceRange.layerCount = 1;
+    }
+
+    // Aliased memory may have been written by an earlier user, hence the
+    // color-attachment and transfer stages as sources.
+    vkCmdPipelineBarrier(commandBuffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &sourceBarrier, 0, nullptr, chainBarrierCount, chainBarriers);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DownsamplePipeline);
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        VkExtent2D sourceExtent = level == 0 ? m_SourceExtent : m_LevelExtents[level - 1];
+        VkDescriptorSet set = level == 0 ? m_SourceSets[source & 1] : m_DownsampleSets[level];
+
+        DownsampleParams params{};
+        params.sourceTexelSize[0] = 1.0f / sourceExtent.width;
+        params.sourceTexelSize[1] = 1.0f / sourceExtent.height;
+        params.threshold = BLOOM_THRESHOLD;
+        params.knee = BLOOM_KNEE;
+        params.prefilter = level == 0 ? 1 : 0;
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+        vkCmdDispatch(commandBuffer, (m_LevelExtents[level].width + GROUP_SIZE - 1) / GROUP_SIZE,
+            (m_LevelExtents[level].height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+        ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_UpsamplePipeline);
+    for (uint32_t level = levels - 1; level-- > 0;)
+    {
+        UpsampleParams params{};
+        params.sourceTexelSize[0] = 1.0f / m_LevelExtents[level + 1].width;
+        params.sourceTexelSize[1] = 1.0f / m_LevelExtents[level + 1].height;
+        params.radius = UPSAMPLE_RADIUS;
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_UpsampleSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+        vkCmdDispatch(commandBuffer, (m_LevelExtents[level].width + GROUP_SIZE - 1) / GROUP_SIZE,
+            (m_LevelExtents[level].height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+        ComputeBarrier(commandBuffer, level == 0 ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    if (levels == 1)
+    {
+        ComputeBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+}
+
+} // namespace PostProcessing
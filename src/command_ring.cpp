@@ -0,0 +1,139 @@
+#include <windows.h>
+#include "../include/command_ring.h"
+#include <chrono>
+#include <thread>
+
+namespace Bridge {
+
+bool CommandRing::Initialize(size_t capacity)
+{
+    size_t size = RECORD_ALIGNMENT;
+    while (size < capacity) size <<= 1;
+
+    m_Buffer.assign(size, 0);
+    m_Mask = size - 1;
+    m_Head.store(0);
+    m_Tail.store(0);
+    m_WritePos = 0;
+    m_ReadPos = 0;
+    m_PeekSize = 0;
+    m_Stats = CommandRingStats();
+    return true;
+}
+
+void CommandRing::Shutdown()
+{
+    m_Buffer.clear();
+    m_Buffer.shrink_to_fit();
+    m_Mask = 0;
+}
+
+uint8_t* CommandRing::BeginRecord(TraceOp op, uint32_t payloadSize)
+{
+    size_t capacity = m_Buffer.size();
+    size_t total = Align(sizeof(TraceRecordHeader) + payloadSize);
+    if (total > capacity / 2)
+    {
+        m_Stats.oversizedRecords++;
+        return nullptr;
+    }
+
+    size_t write = m_Tail.load(std::memory_order_relaxed);
+    size_t offset = write & m_Mask;
+    size_t contiguous = capacity - offset;
+    size_t padding = (contiguous < total) ? contiguous : 0;
+
+    if (write + padding + total - m_Head.load(std::memory_order_acquire) > capacity)
+    {
+        m_Stats.fullStalls++;
+        while (write + padding + total - m_Head.load(std::memory_order_acquire) > capacity) std::this_thread::yield();
+    }
+
+    if (padding)
+    {
+        TraceRecordHeader skip = {0, 0, (uint32_t)(padding - sizeof(TraceRecordHeader))};
+        memcpy(&m_Buffer[offset], &skip, sizeof(skip));
+        write += padding;
+        offset = 0;
+    }
+
+    TraceRecordHeader header = {(uint16_t)op, 0, payloadSize};
+    memcpy(&m_Buffer[offset], &header, sizeof(header));
+
+    m_WritePos = write + total;
+    m_Stats.recordCount++;
+    m_Stats.bytesWritten += padding + total;
+    return &m_Buffer[offset + sizeof(header)];
+}
+
+void CommandRing::EndRecord()
+{
+    // Sequentially consistent so this store and the load of the waiting
+    // flag cannot both miss the consumer's flag store and tail load.
+    m_Tail.store(m_WritePos);
+    if (m_bConsumerWaiting.load())
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Condition.notify_one();
+    }
+}
+
+void CommandRing::WaitUntilDrained()
+{
+    // The consumer releases a record only after executing it.
+    while (m_Head.load(std::memory_order_acquire) != m_Tail.load(std::memory_order_relaxed)) std::this_thread::yield();
+}
+
+bool CommandRing::Peek(TraceOp& op, const uint8_t*& payload, uint32_t& size)
+{
+    for (;;)
+    {
+        if (m_ReadPos == m_Tail.load(std::memory_order_acquire)) return false;
+
+        TraceRecordHeader header;
+        size_t offset = m_ReadPos & m_Mask;
+        memcpy(&header, &m_Buffer[offset], sizeof(header));
+
+        if (header.op == 0)
+        {
+            m_ReadPos += sizeof(header) + header.size;
+            m_Head.store(m_ReadPos, std::memory_order_release);
+            continue;
+        }
+
+        op = (TraceOp)header.op;
+        payload = &m_Buffer[offset + sizeof(header)];
+        size = header.size;
+        m_PeekSize = Align(sizeof(header) + header.size);
+        return true;
+    }
+}
+
+void CommandRing::Pop()
+{
+    m_ReadPos += m_PeekSize;
+    m_PeekSize = 0;
+    m_Head.store(m_ReadPos, std::memory_order_release);
+}
+
+void CommandRing::WaitForData()
+{
+    for (uint32_t i = 0; i < SPIN_COUNT; i++)
+    {
+        if (!IsEmpty()) return;
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_bConsumerWaiting.store(true);
+    if (m_ReadPos == m_Tail.load()) m_Condition.wait_for(lock, std::chrono::milliseconds(1));
+    m_bConsumerWaiting.store(false);
+}
+
+void CommandRing::Wake()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Condition.notify_one();
+}
+
+} // namespace Bridge
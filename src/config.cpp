@@ -0,0 +1,217 @@
+#include "../include/config.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+std::string Trim(const std::string& text)
+{
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return std::string();
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool ParseBool(const std::string& value)
+{
+    return value == "true" || value == "1" || value == "yes" || value == "on";
+}
+
+// INI values are plain ASCII; paths are widened character by character.
+std::wstring Widen(const std::string& text)
+{
+    return std::wstring(text.begin(), text.end());
+}
+
+std::string Narrow(const std::wstring& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (wchar_t c : text) result.push_back((char)c);
+    return result;
+}
+
+const char* FormatBool(bool value)
+{
+    return value ? "true" : "false";
+}
+
+void ApplyValue(Config::ConfigManager& config, const std::string& section, const std::string& key, const std::string& value)
+{
+    if (section == "Renderer")
+    {
+        Config::RendererSettings& r = config.GetRenderer();
+        if (key == "EnableValidation") r.enableValidation = ParseBool(value);
+        else if (key == "EnableVSync") r.enableVSync = ParseBool(value);
+        else if (key == "EnableAnisotropy") r.enableAnisotropy = ParseBool(value);
+        else if (key == "AnisotropyLevel") r.anisotropyLevel = (UINT)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "Width") r.width = (UINT)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "Height") r.height = (UINT)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "Fullscreen") r.fullscreen = ParseBool(value);
+        else if (key == "FramesInFlight") r.framesInFlight = (UINT)strtoul(value.c_str(), nullptr, 10);
+        else if (key == "AsyncTransfer") r.asyncTransfer = ParseBool(value);
+        else if (key == "DynamicRendering") r.dynamicRendering = ParseBool(value);
+        else if (key == "TimelineSemaphores") r.timelineSemaphores = ParseBool(value);
+        else if (key == "PipelineCachePath") r.pipelineCachePath = Widen(value);
+        else if (key == "PipelineWarmUpPath") r.pipelineWarmUpPath = Widen(value);
+        else if (key == "TracePath") r.tracePath = Widen(value);
+    }
+    else if (section == "Effects")
+    {
+        Config::EffectSettings& e = config.GetEffects();
+        if (key == "EnablePostProcessing") e.enablePostProcessing = ParseBool(value);
+        else if (key == "EnableHardLight") e.enableHardLight = ParseBool(value);
+        else if (key == "EnableDesaturate") e.enableDesaturate = ParseBool(value);
+        else if (key == "EnableGlare") e.enableGlare = ParseBool(value);
+        else if (key == "HardLightStrength") e.hardLightStrength = strtof(value.c_str(), nullptr);
+        else if (key == "DesaturationStrength") e.desaturationStrength = strtof(value.c_str(), nullptr);
+        else if (key == "GlareStrength") e.glareStrength = strtof(value.c_str(), nullptr);
+        else if (key == "GlareSize") e.glareSize = atoi(value.c_str());
+        else if (key == "GlareDarkenSky") e.glareDarkenSky = ParseBool(value);
+        else if (key == "FusedPostProcessing") e.fusedPostProcessing = ParseBool(value);
+    }
+    else if (section == "Performance")
+    {
+        Config::PerformanceSettings& p = config.GetPerformance();
+        if (key == "EnableAutoFallback") p.enableAutoFallback = ParseBool(value);
+        else if (key == "EnableLODBias") p.enableLODBias = ParseBool(value);
+        else if (key == "LODBias0") p.LODBias0 = strtof(value.c_str(), nullptr);
+        else if (key == "LODBias1") p.LODBias1 = strtof(value.c_str(), nullptr);
+        else if (key == "ShowGpuProfiler") p.showGpuProfiler = ParseBool(value);
+        else if (key == "FrameStatsPath") p.frameStatsPath = Widen(value);
+        else if (key == "FrameStatsHotkey") p.frameStatsHotkey = (UINT)strtoul(value.c_str(), nullptr, 0);
+        else if (key == "DrawBatching") p.drawBatching = ParseBool(value);
+        else if (key == "RecordingThreads") p.recordingThreads = (UINT)strtoul(value.c_str(), nullptr, 0);
+        else if (key == "RenderThread") p.renderThread = ParseBool(value);
+    }
+    else if (section == "Screenshot")
+    {
+        Config::ScreenshotSettings& s = config.GetScreenshot();
+        if (key == "EnableScreenshots") s.enableScreenshots = ParseBool(value);
+        else if (key == "AutoSave") s.autoSave = ParseBool(value);
+        else if (key == "SavePath") s.savePath = Widen(value);
+        else if (key == "Format") s.format = Widen(value);
+    }
+}
+
+} // namespace
+
+namespace Config {
+
+ConfigManager& ConfigManager::GetInstance()
+{
+    static ConfigManager instance;
+    return instance;
+}
+
+bool ConfigManager::Load(const std::wstring& filename)
+{
+    m_bLoadAttempted = true;
+
+    std::ifstream file{std::filesystem::path(filename)};
+    if (!file)
+    {
+        OutputDebugStringA("[Config] Configuration file not found, using defaults\n");
+        return false;
+    }
+
+    std::string section;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+
+        if (line[0] == '[')
+        {
+            size_t end = line.find(']');
+            section = (end != std::string::npos) ? Trim(line.substr(1, end - 1)) : std::string();
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) continue;
+
+        ApplyValue(*this, section, Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)));
+    }
+
+    return true;
+}
+
+bool ConfigManager::EnsureLoaded()
+{
+    if (m_bLoadAttempted) return true;
+    return Load();
+}
+
+bool ConfigManager::Save(const std::wstring& filename)
+{
+    std::ofstream file{std::filesystem::path(filename), std::ios::trunc};
+    if (!file)
+    {
+        OutputDebugStringA("[Config] Failed to write configuration file\n");
+        return false;
+    }
+
+    file << "[Renderer]\n";
+    file << "EnableValidation=" << FormatBool(m_Renderer.enableValidation) << "\n";
+    file << "EnableVSync=" << FormatBool(m_Renderer.enableVSync) << "\n";
+    file << "EnableAnisotropy=" << FormatBool(m_Renderer.enableAnisotropy) << "\n";
+    file << "AnisotropyLevel=" << m_Renderer.anisotropyLevel << "\n";
+    file << "Width=" << m_Renderer.width << "\n";
+    file << "Height=" << m_Renderer.height << "\n";
+    file << "Fullscreen=" << FormatBool(m_Renderer.fullscreen) << "\n";
+    file << "FramesInFlight=" << m_Renderer.framesInFlight << "\n";
+    file << "AsyncTransfer=" << FormatBool(m_Renderer.asyncTransfer) << "\n";
+    file << "DynamicRendering=" << FormatBool(m_Renderer.dynamicRendering) << "\n";
+    file << "TimelineSemaphores=" << FormatBool(m_Renderer.timelineSemaphores) << "\n";
+    file << "PipelineCachePath=" << Narrow(m_Renderer.pipelineCachePath) << "\n";
+    file << "PipelineWarmUpPath=" << Narrow(m_Renderer.pipelineWarmUpPath) << "\n";
+    file << "TracePath=" << Narrow(m_Renderer.tracePath) << "\n";
+    file << "\n";
+
+    file << "[Effects]\n";
+    file << "EnablePostProcessing=" << FormatBool(m_Effects.enablePostProcessing) << "\n";
+    file << "EnableHardLight=" << FormatBool(m_Effects.enableHardLight) << "\n";
+    file << "EnableDesaturate=" << FormatBool(m_Effects.enableDesaturate) << "\n";
+    file << "EnableGlare=" << FormatBool(m_Effects.enableGlare) << "\n";
+    file << "HardLightStrength=" << m_Effects.hardLightStrength << "\n";
+    file << "DesaturationStrength=" << m_Effects.desaturationStrength << "\n";
+    file << "GlareStrength=" << m_Effects.glareStrength << "\n";
+    file << "GlareSize=" << m_Effects.glareSize << "\n";
+    file << "GlareDarkenSky=" << FormatBool(m_Effects.glareDarkenSky) << "\n";
+    file << "FusedPostProcessing=" << FormatBool(m_Effects.fusedPostProcessing) << "\n";
+    file << "\n";
+
+    file << "[Performance]\n";
+    file << "EnableAutoFallback=" << FormatBool(m_Performance.enableAutoFallback) << "\n";
+    file << "EnableLODBias=" << FormatBool(m_Performance.enableLODBias) << "\n";
+    file << "LODBias0=" << m_Performance.LODBias0 << "\n";
+    file << "LODBias1=" << m_Performance.LODBias1 << "\n";
+    file << "ShowGpuProfiler=" << FormatBool(m_Performance.showGpuProfiler) << "\n";
+    file << "FrameStatsPath=" << Narrow(m_Performance.frameStatsPath) << "\n";
+    file << "FrameStatsHotkey=" << m_Performance.frameStatsHotkey << "\n";
+    file << "DrawBatching=" << FormatBool(m_Performance.drawBatching) << "\n";
+    file << "RecordingThreads=" << m_Performance.recordingThreads << "\n";
+    file << "RenderThread=" << FormatBool(m_Performance.renderThread) << "\n";
+    file << "\n";
+
+    file << "[Screenshot]\n";
+    file << "EnableScreenshots=" << FormatBool(m_Screenshot.enableScreenshots) << "\n";
+    file << "AutoSave=" << FormatBool(m_Screenshot.autoSave) << "\n";
+    file << "SavePath=" << Narrow(m_Screenshot.savePath) << "\n";
+    file << "Format=" << Narrow(m_Screenshot.format) << "\n";
+
+    return (bool)file;
+}
+
+void ConfigManager::ResetToDefaults()
+{
+    m_Renderer = RendererSettings();
+    m_Effects = EffectSettings();
+    m_Performance = PerformanceSettings();
+    m_Screenshot = ScreenshotSettings();
+}
+
+} // namespace Config
@@ -0,0 +1,1459 @@
+#include <windows.h>
+#include "../include/d3d8_bridge.h"
+#include "../include/vulkan_renderer.h"
+#include "../include/pipeline_cache.h"
+#include "../include/post_processing.h"
+#include "../include/scene_recorder.h"
+#include "../include/shader_interface.h"
+#include "../include/deletion_queue.h"
+#include "../include/config.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+const VkDeviceSize UPLOAD_RING_SIZE = 4 * 1024 * 1024;
+const VkDeviceSize UPLOAD_ALIGNMENT = 16;
+const uint32_t WARM_UP_LIST_MAGIC = 0x4B50464F; // "OFPK"
+const uint32_t WARM_UP_LIST_MAX_KEYS = 65536;
+const uint32_t PALETTE_BYTES = 256 * sizeof(PALETTEENTRY);
+
+thread_local bool t_RenderThread = false;
+
+UINT GetIndexCount(D3DPRIMITIVETYPE primitiveType, UINT primitiveCount)
+{
+    switch (primitiveType)
+    {
+        case D3DPT_POINTLIST:     return primitiveCount;
+        case D3DPT_LINELIST:      return primitiveCount * 2;
+        case D3DPT_LINESTRIP:     return primitiveCount + 1;
+        case D3DPT_TRIANGLELIST:  return primitiveCount * 3;
+        case D3DPT_TRIANGLESTRIP: return primitiveCount + 2;
+        case D3DPT_TRIANGLEFAN:   return primitiveCount + 2;
+        default:                  return 0;
+    }
+}
+
+VkPrimitiveTopology ToVkTopology(D3DPRIMITIVETYPE primitiveType)
+{
+    switch (primitiveType)
+    {
+        case D3DPT_POINTLIST:     return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+        case D3DPT_LINELIST:      return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+        case D3DPT_LINESTRIP:     return VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+        case D3DPT_TRIANGLESTRIP: return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+        case D3DPT_TRIANGLEFAN:   return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN;
+        default:                  return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    }
+}
+
+VkBlendFactor ToVkBlendFactor(DWORD blend)
+{
+    switch (blend)
+    {
+        case D3DBLEND_ZERO:         return VK_BLEND_FACTOR_ZERO;
+        case D3DBLEND_ONE:          return VK_BLEND_FACTOR_ONE;
+        case D3DBLEND_SRCCOLOR:     return VK_BLEND_FACTOR_SRC_COLOR;
+        case D3DBLEND_INVSRCCOLOR:  return VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+        case D3DBLEND_SRCALPHA:     return VK_BLEND_FACTOR_SRC_ALPHA;
+        case D3DBLEND_INVSRCALPHA:  return VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        case D3DBLEND_DESTALPHA:    return VK_BLEND_FACTOR_DST_ALPHA;
+        case D3DBLEND_INVDESTALPHA: return VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+        case D3DBLEND_DESTCOLOR:    return VK_BLEND_FACTOR_DST_COLOR;
+        case D3DBLEND_INVDESTCOLOR: return VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+        case D3DBLEND_SRCALPHASAT:  return VK_BLEND_FACTOR_SRC_ALPHA_SATURATE;
+        default:                    return VK_BLEND_FACTOR_ONE;
+    }
+}
+
+VkCompareOp ToVkCompareOp(DWORD func)
+{
+    // D3DCMP_NEVER..D3DCMP_ALWAYS are VK_COMPARE_OP_NEVER..ALWAYS shifted by one.
+    if (func < D3DCMP_NEVER || func > D3DCMP_ALWAYS) return VK_COMPARE_OP_ALWAYS;
+    return (VkCompareOp)(func - D3DCMP_NEVER);
+}
+
+VkCullModeFlags ToVkCullMode(DWORD cull)
+{
+    // D3D treats clockwise triangles as front facing, as does the pipeline.
+    switch (cull)
+    {
+        case D3DCULL_CW:  return VK_CULL_MODE_FRONT_BIT;
+        case D3DCULL_CCW: return VK_CULL_MODE_BACK_BIT;
+        default:          return VK_CULL_MODE_NONE;
+    }
+}
+
+void ToFloat4(const D3DCOLORVALUE& color, float out[4])
+{
+    out[0] = color.r;
+    out[1] = color.g;
+    out[2] = color.b;
+    out[3] = color.a;
+}
+
+void ToFloat4(D3DCOLOR color, float out[4])
+{
+    out[0] = ((color >> 16) & 0xFF) / 255.0f;
+    out[1] = ((color >> 8) & 0xFF) / 255.0f;
+    out[2] = (color & 0xFF) / 255.0f;
+    out[3] = ((color >> 24) & 0xFF) / 255.0f;
+}
+
+} // namespace
+
+namespace Bridge {
+
+D3D8Bridge& D3D8Bridge::GetInstance()
+{
+    static D3D8Bridge instance;
+    return instance;
+}
+
+bool D3D8Bridge::Initialize()
+{
+    if (m_Initialized) return true;
+
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    if (!renderer.IsInitialized())
+    {
+        OutputDebugStringA("[D3D8Bridge] Renderer must be initialized first\n");
+        return false;
+    }
+
+    if (!m_UploadRing.Initialize(renderer.GetDevice(), renderer.GetPhysicalDevice(), UPLOAD_RING_SIZE,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to create upload ring\n");
+        return false;
+    }
+
+    if (!m_Uniforms.Initialize(renderer.GetDevice(), renderer.GetPhysicalDevice()))
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to create uniform state\n");
+        m_UploadRing.Shutdown();
+        return false;
+    }
+    m_State.descriptorSetLayout = m_Uniforms.GetDescriptorSetLayout();
+    m_State.pipelineLayout = m_Uniforms.GetPipelineLayout();
+    m_Uniforms.SetChangeCallback(OnUniformChange, this);
+
+    // Every pipeline, including the warm-up list below, is built from these.
+    if (!CreateVertexShader() || !CreatePixelShader())
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to create scene shaders\n");
+        DestroyShaders();
+        m_Uniforms.Shutdown();
+        m_UploadRing.Shutdown();
+        return false;
+    }
+
+    Math::Identity(m_World);
+    m_BatchingEnabled = Config::ConfigManager::GetInstance().GetPerformance().drawBatching;
+
+    m_State.viewport = {0.0f, 0.0f, (float)renderer.GetWidth(), (float)renderer.GetHeight(), 0.0f, 1.0f};
+    m_State.scissor = {{0, 0}, {renderer.GetWidth(), renderer.GetHeight()}};
+    m_Extent = {renderer.GetWidth(), renderer.GetHeight()};
+    m_Uniforms.SetTargetSize(m_Extent.width, m_Extent.height);
+
+    std::vector<PipelineKey> warmUpKeys;
+    LoadWarmUpList(warmUpKeys);
+    WarmUpPipelines(warmUpKeys);
+
+    const std::wstring& tracePath = Config::ConfigManager::GetInstance().GetRenderer().tracePath;
+    if (!tracePath.empty()) StartTrace(tracePath);
+
+    m_Initialized = true;
+
+    if (Config::ConfigManager::GetInstance().GetPerformance().renderThread && !StartRenderThread())
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to start render thread, running on the calling thread\n");
+    }
+
+    OutputDebugStringA("[D3D8Bridge] Initialized successfully\n");
+    return true;
+}
+
+void D3D8Bridge::Shutdown()
+{
+    if (!m_Initialized) return;
+
+    // Runs everything still queued before touching any state.
+    StopRenderThread();
+    StopTrace();
+
+    VkDevice device = Vulkan::Renderer::GetInstance().GetDevice();
+    vkDeviceWaitIdle(device);
+
+    const PipelineStateCacheStats& stats = m_PipelineCache.GetStats();
+    char msg[256];
+    sprintf_s(msg, "[D3D8Bridge] Pipeline cache: %u pipelines, %llu hits, %llu misses\n",
+        stats.pipelineCount, (unsigned long long)stats.hits, (unsigned long long)stats.misses);
+    OutputDebugStringA(msg);
+
+    const DrawBatchStats& batchStats = m_Batch.GetStats();
+    if (batchStats.drawsOut > 0)
+    {
+        sprintf_s(msg, "[D3D8Bridge] Draw batching: %llu draws in, %llu out (%.2f:1), %llu merged, %llu instanced\n",
+            (unsigned long long)batchStats.drawsIn, (unsigned long long)batchStats.drawsOut,
+            (double)batchStats.drawsIn / (double)batchStats.drawsOut,
+            (unsigned long long)batchStats.mergedDraws, (unsigned long long)batchStats.instancedDraws);
+        OutputDebugStringA(msg);
+    }
+
+    SaveWarmUpList();
+
+    std::vector<VkPipeline> pipelines;
+    m_PipelineCache.Clear(pipelines);
+    for (VkPipeline pipeline : pipelines) vkDestroyPipeline(device, pipeline, nullptr);
+    m_State.graphicsPipeline = VK_NULL_HANDLE;
+
+    DestroyShaders();
+    DestroyTextures();
+
+    m_Batch.Clear();
+    m_UploadRing.Shutdown();
+    m_Uniforms.Shutdown();
+    m_State.descriptorSetLayout = VK_NULL_HANDLE;
+    m_State.pipelineLayout = VK_NULL_HANDLE;
+
+    m_Initialized = false;
+    OutputDebugStringA("[D3D8Bridge] Shutdown complete\n");
+}
+
+bool D3D8Bridge::CreateVertexShader()
+{
+    return PostProcessing::LoadShaderModule(Vulkan::Renderer::GetInstance().GetDevice(), "scene.vert", m_VertexShaderModule);
+}
+
+bool D3D8Bridge::CreatePixelShader()
+{
+    return PostProcessing::LoadShaderModule(Vulkan::Renderer::GetInstance().GetDevice(), "scene.frag", m_PixelShaderModule);
+}
+
+void D3D8Bridge::DestroyShaders()
+{
+    VkDevice device = Vulkan::Renderer::GetInstance().GetDevice();
+    if (m_VertexShaderModule) vkDestroyShaderModule(device, m_VertexShaderModule, nullptr);
+    if (m_PixelShaderModule) vkDestroyShaderModule(device, m_PixelShaderModule, nullptr);
+    m_VertexShaderModule = VK_NULL_HANDLE;
+    m_PixelShaderModule = VK_NULL_HANDLE;
+}
+
+bool D3D8Bridge::StartTrace(const std::wstring& path)
+{
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    return m_Trace.Start(path, renderer.GetWidth(), renderer.GetHeight());
+}
+
+void D3D8Bridge::StopTrace()
+{
+    m_Trace.Stop();
+}
+
+bool D3D8Bridge::IsRenderThread()
+{
+    return t_RenderThread;
+}
+
+bool D3D8Bridge::StartRenderThread()
+{
+    if (m_Threaded) return true;
+    if (!m_Commands.Initialize(COMMAND_RING_SIZE)) return false;
+
+    m_StopRenderThread.store(false);
+    m_PresentsQueued = 0;
+    m_PresentsCompleted = 0;
+    m_PresentWaitMilliseconds = 0.0;
+    m_RenderThread = std::thread(&D3D8Bridge::RenderThread, this);
+    m_Threaded = true;
+
+    OutputDebugStringA("[D3D8Bridge] Executing bridge calls on a render thread\n");
+    return true;
+}
+
+void D3D8Bridge::StopRenderThread()
+{
+    if (!m_Threaded) return;
+
+    m_StopRenderThread.store(true);
+    m_Commands.Wake();
+    m_RenderThread.join();
+    m_Threaded = false;
+
+    const CommandRingStats& stats = m_Commands.GetStats();
+    char msg[256];
+    sprintf_s(msg, "[D3D8Bridge] Render thread: %llu calls, %.1f MB queued, %llu full-ring stalls, %llu run inline, %.1f ms waiting at Present\n",
+        (unsigned long long)stats.recordCount, stats.bytesWritten / (1024.0 * 1024.0), (unsigned long long)stats.fullStalls,
+        (unsigned long long)stats.oversizedRecords, m_PresentWaitMilliseconds);
+    OutputDebugStringA(msg);
+
+    m_Commands.Shutdown();
+}
+
+void D3D8Bridge::RenderThread()
+{
+    t_RenderThread = true;
+
+    for (;;)
+    {
+        TraceOp op;
+        const uint8_t* payload;
+        uint32_t size;
+        if (m_Commands.Peek(op, payload, size))
+        {
+            Dispatch(op, payload, size);
+            m_Commands.Pop();
+
+            if (op == TraceOp::Present)
+            {
+                std::lock_guard<std::mutex> lock(m_FrameMutex);
+                m_PresentsCompleted++;
+                m_FrameCondition.notify_one();
+            }
+            continue;
+        }
+
+        // The stop flag is set after the last record was published, so
+        // seeing it makes any remaining records visible.
+        if (m_StopRenderThread.load())
+        {
+            if (m_Commands.IsEmpty()) break;
+            continue;
+        }
+
+        m_Commands.WaitForData();
+    }
+
+    t_RenderThread = false;
+}
+
+void D3D8Bridge::WaitForRenderThread()
+{
+    m_PresentsQueued++;
+
+    std::unique_lock<std::mutex> lock(m_FrameMutex);
+    if (m_PresentsCompleted + MAX_FRAME_LAG >= m_PresentsQueued) return;
+
+    auto start = std::chrono::steady_clock::now();
+    m_FrameCondition.wait(lock, [this] { return m_PresentsCompleted + MAX_FRAME_LAG >= m_PresentsQueued; });
+    m_PresentWaitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool D3D8Bridge::Dispatch(TraceOp op, const uint8_t* payload, uint32_t size)
+{
+    // Each case breaks out on a size mismatch, so a truncated or corrupt
+    // record is never read past its end.
+    switch (op)
+    {
+        case TraceOp::BeginScene:
+            if (size != 0) break;
+            BeginScene();
+            return true;
+        case TraceOp::EndScene:
+            if (size != 0) break;
+            EndScene();
+            return true;
+        case TraceOp::Present:
+            if (size != 0) break;
+            Present(nullptr, nullptr, nullptr, nullptr);
+            return true;
+        case TraceOp::SetRenderState:
+        {
+            TraceSetRenderState args;
+            if (size != sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+            SetRenderState((D3DRENDERSTATETYPE)args.state, args.value);
+            return true;
+        }
+        case TraceOp::SetFVF:
+        {
+            uint32_t fvf;
+            if (size != sizeof(fvf)) break;
+            memcpy(&fvf, payload, sizeof(fvf));
+            SetFVF(fvf);
+            return true;
+        }
+        case TraceOp::SetViewport:
+        {
+            VkViewport viewport;
+            if (size != sizeof(viewport)) break;
+            memcpy(&viewport, payload, sizeof(viewport));
+            SetViewport(viewport);
+            return true;
+        }
+        case TraceOp::SetScissor:
+        {
+            VkRect2D scissor;
+            if (size != sizeof(scissor)) break;
+            memcpy(&scissor, payload, sizeof(scissor));
+            SetScissor(scissor);
+            return true;
+        }
+        case TraceOp::DrawIndexedPrimitiveUP:
+        {
+            TraceDrawUP args;
+            if (size < sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+
+            // The trailing data must be exactly what the draw will read.
+            uint64_t indexSize = (args.indexFormat == D3DFMT_INDEX32) ? 4 : 2;
+            uint64_t indexCount = GetIndexCount((D3DPRIMITIVETYPE)args.primitiveType, args.primitiveCount);
+            if ((uint64_t)sizeof(args) + args.vertexBytes + args.indexBytes != size ||
+                (uint64_t)args.numVertices * args.vertexStride != args.vertexBytes ||
+                indexCount * indexSize != args.indexBytes)
+            {
+                break;
+            }
+
+            // Only the referenced vertex range was serialized; rebase the
+            // pointer so minVertexIndex lands on its first vertex.
+            const uint8_t* vertices = payload + sizeof(args);
+            const uint8_t* indices = vertices + args.vertexBytes;
+            uintptr_t vertexBase = (uintptr_t)vertices - (uintptr_t)args.minVertexIndex * args.vertexStride;
+
+            DrawIndexedPrimitiveUP((D3DPRIMITIVETYPE)args.primitiveType, args.minVertexIndex,
+                args.numVertices, args.primitiveCount, indices, (D3DFORMAT)args.indexFormat,
+                (const void*)vertexBase, args.vertexStride);
+            return true;
+        }
+        case TraceOp::SetTransform:
+        {
+            TraceSetTransform args;
+            if (size != sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+            D3DMATRIX matrix;
+            memcpy(&matrix, args.matrix, sizeof(matrix));
+            SetTransform((D3DTRANSFORMSTATETYPE)args.state, &matrix);
+            return true;
+        }
+        case TraceOp::SetMaterial:
+        {
+            D3DMATERIAL8 material;
+            if (size != sizeof(material)) break;
+            memcpy(&material, payload, sizeof(material));
+            SetMaterial(&material);
+            return true;
+        }
+        case TraceOp::SetLight:
+        {
+            uint32_t index;
+            D3DLIGHT8 light;
+            if (size != sizeof(index) + sizeof(light)) break;
+            memcpy(&index, payload, sizeof(index));
+            memcpy(&light, payload + sizeof(index), sizeof(light));
+            SetLight(index, &light);
+            return true;
+        }
+        case TraceOp::LightEnable:
+        {
+            TraceLightEnable args;
+            if (size != sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+            LightEnable(args.index, args.enable ? TRUE : FALSE);
+            return true;
+        }
+        case TraceOp::CreateTexture:
+        {
+            TraceCreateTexture args;
+            if (size != sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+            if (args.texture == 0 || args.levels == 0) break;
+            CreateTextureImage(args);
+            return true;
+        }
+        case TraceOp::UpdateTexture:
+        {
+            TraceUpdateTexture args;
+            if (size < sizeof(args)) break;
+            memcpy(&args, payload, sizeof(args));
+
+            // The texels were packed when the call was recorded.
+            TextureLevel info;
+            if ((uint64_t)sizeof(args) + args.paletteBytes + args.dataBytes != size ||
+                (args.paletteBytes != 0 && args.paletteBytes != PALETTE_BYTES) ||
+                !GetTextureLevel(args.texture, args.level, info) ||
+                (uint64_t)info.rowBytes * info.rowCount != args.dataBytes)
+            {
+                break;
+            }
+
+            const uint8_t* palette = payload + sizeof(args);
+            UploadTextureLevel(args.texture, args.level, palette + args.paletteBytes, 0,
+                args.paletteBytes ? reinterpret_cast<const PALETTEENTRY*>(palette) : nullptr);
+            return true;
+        }
+        case TraceOp::ReleaseTexture:
+        {
+            uint32_t texture;
+            if (size != sizeof(texture)) break;
+            memcpy(&texture, payload, sizeof(texture));
+            ReleaseTexture(texture);
+            return true;
+        }
+        default:
+            break;
+    }
+
+    char msg[128];
+    sprintf_s(msg, "[D3D8Bridge] Rejected record: op %u with %u payload bytes\n", (unsigned)op, size);
+    OutputDebugStringA(msg);
+    return false;
+}
+
+void D3D8Bridge::BeginScene()
+{
+    if (Capture(TraceOp::BeginScene)) return;
+
+    if (!m_Initialized || m_InScene) return;
+
+    // D3D8 allows several scenes per Present; the Vulkan frame starts with
+    // the first one.
+    if (!m_FrameActive)
+    {
+        Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+        if (!renderer.BeginFrame()) return;
+
+        m_UploadRing.BeginFrame(renderer.GetCurrentFrame());
+        m_Uniforms.BeginFrame(renderer.GetCurrentFrame());
+        RetireTextures();
+        m_State.currentCommandBuffer = renderer.GetCommandBuffer();
+        m_State.graphicsPipeline = VK_NULL_HANDLE;
+        m_State.pipelineDirty = true;
+        m_FrameActive = true;
+
+        // Like a D3D8 Reset, a resized swap chain starts with a full-target
+        // viewport and scissor.
+        if (renderer.GetWidth() != m_Extent.width || renderer.GetHeight() != m_Extent.height)
+        {
+            m_Extent = {renderer.GetWidth(), renderer.GetHeight()};
+            m_State.viewport = {0.0f, 0.0f, (float)m_Extent.width, (float)m_Extent.height, 0.0f, 1.0f};
+            m_State.scissor = {{0, 0}, m_Extent};
+            m_Uniforms.SetTargetSize(m_Extent.width, m_Extent.height);
+        }
+    }
+
+    m_InScene = true;
+}
+
+void D3D8Bridge::EndScene()
+{
+    if (Capture(TraceOp::EndScene)) return;
+
+    FlushBatch();
+    m_InScene = false;
+}
+
+void D3D8Bridge::Present(const RECT* pSourceRect, const RECT* pDestRect, HWND hDestWindowOverride, const RGNDATA* pDirtyRegion)
+{
+    if (Capture(TraceOp::Present))
+    {
+        WaitForRenderThread();
+        return;
+    }
+
+    if (!m_Initialized || !m_FrameActive) return;
+
+    FlushBatch();
+    Vulkan::Renderer::GetInstance().EndFrame();
+
+    m_State.currentCommandBuffer = VK_NULL_HANDLE;
+    m_FrameActive = false;
+}
+
+void D3D8Bridge::DrawIndexedPrimitiveUP(
+    D3DPRIMITIVETYPE primitiveType,
+    UINT minVertexIndex,
+    UINT numVertices,
+    UINT primitiveCount,
+    CONST void* pIndexData,
+    D3DFORMAT indexDataFormat,
+    CONST void* pVertexData,
+    UINT vertexStride)
+{
+    if (!pIndexData || !pVertexData) return;
+
+    UINT indexCount = GetIndexCount(primitiveType, primitiveCount);
+    if (indexCount == 0 || numVertices == 0) return;
+
+    VkIndexType indexType = (indexDataFormat == D3DFMT_INDEX32) ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+    VkDeviceSize indexSize = (indexType == VK_INDEX_TYPE_UINT32) ? 4 : 2;
+
+    // Only the referenced vertex range is copied; the batch rebases the
+    // indices onto it.
+    VkDeviceSize vertexBytes = (VkDeviceSize)numVertices * vertexStride;
+    VkDeviceSize indexBytes = (VkDeviceSize)indexCount * indexSize;
+
+    const uint8_t* vertexSource = static_cast<const uint8_t*>(pVertexData) + (size_t)minVertexIndex * vertexStride;
+
+    TraceDrawUP args = {};
+    args.primitiveType = (uint32_t)primitiveType;
+    args.minVertexIndex = minVertexIndex;
+    args.numVertices = numVertices;
+    args.primitiveCount = primitiveCount;
+    args.indexFormat = (uint32_t)indexDataFormat;
+    args.vertexStride = vertexStride;
+    args.vertexBytes = (uint32_t)vertexBytes;
+    args.indexBytes = (uint32_t)indexBytes;
+
+    // Client memory is only valid during the call, so the geometry is copied.
+    bool queued = Capture(TraceOp::DrawIndexedPrimitiveUP, (uint32_t)(sizeof(args) + vertexBytes + indexBytes),
+        [&](uint8_t* record)
+        {
+            memcpy(record, &args, sizeof(args));
+            memcpy(record + sizeof(args), vertexSource, (size_t)vertexBytes);
+            memcpy(record + sizeof(args) + vertexBytes, pIndexData, (size_t)indexBytes);
+        });
+    if (queued) return;
+
+    if (!m_InScene) return;
+
+    BatchDraw draw;
+    draw.topology = ToVkTopology(primitiveType);
+    draw.vertices = vertexSource;
+    draw.vertexCount = numVertices;
+    draw.vertexStride = vertexStride;
+    draw.indices = pIndexData;
+    draw.indexCount = indexCount;
+    draw.indexType = indexType;
+    draw.minVertexIndex = minVertexIndex;
+    draw.world = &m_World;
+
+    if (!m_Batch.Add(draw))
+    {
+        FlushBatch();
+        m_Batch.Add(draw);
+    }
+
+    if (!m_BatchingEnabled) FlushBatch();
+}
+
+void D3D8Bridge::FlushBatch()
+{
+    if (m_Batch.IsEmpty() || m_FlushingBatch) return;
+
+    // Setting the batch's world below must not re-enter through the
+    // uniform change callback.
+    m_FlushingBatch = true;
+
+    PipelineKey& key = m_State.pipelineKey;
+    uint8_t instanced = m_Batch.IsInstanced() ? 1 : 0;
+    if (key.instanced != instanced)
+    {
+        key.instanced = instanced;
+        m_State.pipelineDirty = true;
+    }
+
+    // Instances take their world matrix from binding 1 instead.
+    const std::vector<Math::Matrix4>& worlds = m_Batch.GetWorlds();
+    if (!instanced) m_Uniforms.SetWorld(worlds[0]);
+
+    Vulkan::DrawPacket packet;
+    UploadAllocation allocation;
+    VkDeviceSize vertexBytes = m_Batch.GetVertices().size();
+    VkDeviceSize indexOffset = (vertexBytes + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+    VkDeviceSize indexBytes = m_Batch.GetIndices().size();
+    VkDeviceSize instanceOffset = (indexOffset + indexBytes + UPLOAD_ALIGNMENT - 1) & ~(UPLOAD_ALIGNMENT - 1);
+    VkDeviceSize instanceBytes = instanced ? worlds.size() * sizeof(Math::Matrix4) : 0;
+
+    if (SelectPipeline(m_Batch.GetTopology()) && m_Uniforms.Flush(packet.descriptorSet, packet.dynamicOffsets) &&
+        m_UploadRing.Allocate(instanceOffset + instanceBytes, UPLOAD_ALIGNMENT, allocation))
+    {
+        uint8_t* destination = static_cast<uint8_t*>(allocation.data);
+        memcpy(destination, m_Batch.GetVertices().data(), (size_t)vertexBytes);
+        memcpy(destination + indexOffset, m_Batch.GetIndices().data(), (size_t)indexBytes);
+        if (instanced) memcpy(destination + instanceOffset, worlds.data(), (size_t)instanceBytes);
+
+        // Recorded when the frame ends, possibly on another thread.
+        packet.pipeline = m_State.graphicsPipeline;
+        packet.pipelineLayout = m_State.pipelineLayout;
+        packet.dynamicOffsetCount = UNIFORM_BLOCK_COUNT;
+        packet.vertexBuffer = allocation.buffer;
+        packet.vertexOffsets[0] = allocation.offset;
+        packet.vertexOffsets[1] = allocation.offset + instanceOffset;
+        packet.vertexBindingCount = instanced ? 2 : 1;
+        packet.indexBuffer = allocation.buffer;
+        packet.indexOffset = allocation.offset + indexOffset;
+        packet.indexType = m_Batch.GetIndexType();
+        packet.indexCount = m_Batch.GetIndexCount();
+        packet.instanceCount = (uint32_t)worlds.size();
+        packet.viewport = m_State.viewport;
+        packet.scissor = m_State.scissor;
+        Vulkan::SceneRecorder::GetInstance().Add(packet);
+
+        // The next non-UP draw must rebind the application's own streams.
+        m_State.vertexBuffer = VK_NULL_HANDLE;
+        m_State.indexBuffer = VK_NULL_HANDLE;
+    }
+
+    m_Batch.Clear();
+    m_FlushingBatch = false;
+}
+
+void D3D8Bridge::OnUniformChange(void* context)
+{
+    static_cast<D3D8Bridge*>(context)->FlushBatch();
+}
+
+void D3D8Bridge::SetViewport(const VkViewport& viewport)
+{
+    if (Capture(TraceOp::SetViewport, viewport)) return;
+
+    FlushBatch();
+    m_State.viewport = viewport;
+}
+
+void D3D8Bridge::SetScissor(const VkRect2D& scissor)
+{
+    if (Capture(TraceOp::SetScissor, scissor)) return;
+
+    FlushBatch();
+    m_State.scissor = scissor;
+}
+
+void D3D8Bridge::SetRenderState(D3DRENDERSTATETYPE state, DWORD value)
+{
+    TraceSetRenderState args = {(uint32_t)state, (uint32_t)value};
+    if (Capture(TraceOp::SetRenderState, args)) return;
+
+    if (state == D3DRS_AMBIENT)
+    {
+        float color[4];
+        ToFloat4((D3DCOLOR)value, color);
+        m_Uniforms.SetAmbient(color);
+        return;
+    }
+
+    // Dynamic, so changing it does not need another pipeline.
+    if (state == D3DRS_ALPHAREF)
+    {
+        m_Uniforms.SetAlphaReference((float)(value & 0xFF));
+        return;
+    }
+
+    PipelineKey key = m_State.pipelineKey;
+
+    switch (state)
+    {
+        case D3DRS_ZENABLE:          key.depthTestEnable = value ? 1 : 0; break;
+        case D3DRS_ZWRITEENABLE:     key.depthWriteEnable = value ? 1 : 0; break;
+        case D3DRS_ZFUNC:            key.depthCompareOp = (uint8_t)ToVkCompareOp(value); break;
+        case D3DRS_CULLMODE:         key.cullMode = (uint8_t)ToVkCullMode(value); break;
+        case D3DRS_ALPHABLENDENABLE: key.blendEnable = value ? 1 : 0; break;
+        case D3DRS_SRCBLEND:         key.srcBlend = (uint8_t)ToVkBlendFactor(value); break;
+        case D3DRS_DESTBLEND:        key.dstBlend = (uint8_t)ToVkBlendFactor(value); break;
+        case D3DRS_ALPHATESTENABLE:  key.alphaTestEnable = value ? 1 : 0; break;
+        case D3DRS_ALPHAFUNC:        key.alphaCompareOp = (uint8_t)ToVkCompareOp(value); break;
+        default: return;
+    }
+
+    if (key == m_State.pipelineKey) return;
+
+    FlushBatch();
+    m_State.pipelineKey = key;
+    m_State.pipelineDirty = true;
+}
+
+void D3D8Bridge::SetFVF(DWORD fvf)
+{
+    if (Capture(TraceOp::SetFVF, (uint32_t)fvf)) return;
+
+    if (m_State.pipelineKey.fvf == fvf) return;
+
+    FlushBatch();
+    m_State.pipelineKey.fvf = fvf;
+    m_State.pipelineDirty = true;
+}
+
+void D3D8Bridge::SetTransform(D3DTRANSFORMSTATETYPE state, const D3DMATRIX* matrix)
+{
+    if (!matrix) return;
+
+    TraceSetTransform args;
+    args.state = (uint32_t)state;
+    memcpy(args.matrix, matrix, sizeof(args.matrix));
+    if (Capture(TraceOp::SetTransform, args)) return;
+
+    // D3DMATRIX already has the Math::Matrix4 layout; the copy aligns it.
+    Math::Matrix4 aligned;
+    memcpy(&aligned, matrix, sizeof(aligned));
+    switch (state)
+    {
+        case D3DTS_WORLD:
+            // Only read when a batch is recorded; draws with different
+            // worlds can still be instanced together.
+            m_State.worldMatrix = *matrix;
+            m_World = aligned;
+            break;
+        case D3DTS_VIEW:
+            m_State.viewMatrix = *matrix;
+            m_Uniforms.SetView(aligned);
+            break;
+        case D3DTS_PROJECTION:
+            m_State.projectionMatrix = *matrix;
+            m_Uniforms.SetProjection(aligned);
+            break;
+        default:
+            break;
+    }
+}
+
+void D3D8Bridge::SetMaterial(const D3DMATERIAL8* material)
+{
+    if (!material) return;
+
+    if (Capture(TraceOp::SetMaterial, *material)) return;
+
+    MaterialConstants constants = {};
+    ToFloat4(material->Diffuse, constants.diffuse);
+    ToFloat4(material->Ambient, constants.ambient);
+    ToFloat4(material->Specular, constants.specular);
+    ToFloat4(material->Emissive, constants.emissive);
+    constants.power = material->Power;
+    m_Uniforms.SetMaterial(constants);
+}
+
+void D3D8Bridge::SetLight(DWORD index, const D3DLIGHT8* light)
+{
+    if (!light) return;
+
+    uint32_t lightIndex = (uint32_t)index;
+    bool queued = Capture(TraceOp::SetLight, (uint32_t)(sizeof(lightIndex) + sizeof(D3DLIGHT8)),
+        [&](uint8_t* record)
+        {
+            memcpy(record, &lightIndex, sizeof(lightIndex));
+            memcpy(record + sizeof(lightIndex), light, sizeof(D3DLIGHT8));
+        });
+    if (queued) return;
+
+    LightConstants constants = {};
+    ToFloat4(light->Diffuse, constants.diffuse);
+    ToFloat4(light->Specular, constants.specular);
+    ToFloat4(light->Ambient, constants.ambient);
+    constants.position[0] = light->Position.x;
+    constants.position[1] = light->Position.y;
+    constants.position[2] = light->Position.z;
+    constants.position[3] = light->Range;
+    constants.direction[0] = light->Direction.x;
+    constants.direction[1] = light->Direction.y;
+    constants.direction[2] = light->Direction.z;
+    constants.direction[3] = (float)light->Type;
+    constants.attenuation[0] = light->Attenuation0;
+    constants.attenuation[1] = light->Attenuation1;
+    constants.attenuation[2] = light->Attenuation2;
+    constants.attenuation[3] = light->Falloff;
+    constants.spot[0] = cosf(light->Theta * 0.5f);
+    constants.spot[1] = cosf(light->Phi * 0.5f);
+
+    if (!m_Uniforms.SetLight(index, constants))
+    {
+        char msg[128];
+        sprintf_s(msg, "[D3D8Bridge] Ignoring light %lu, only %u are supported\n", (unsigned long)index, MAX_ACTIVE_LIGHTS);
+        OutputDebugStringA(msg);
+    }
+}
+
+void D3D8Bridge::LightEnable(DWORD index, BOOL enable)
+{
+    TraceLightEnable args = {(uint32_t)index, enable ? 1u : 0u};
+    if (Capture(TraceOp::LightEnable, args)) return;
+
+    m_Uniforms.EnableLight(index, enable != FALSE);
+}
+
+TextureHandle D3D8Bridge::CreateTexture(UINT width, UINT height, UINT levels, D3DFORMAT format)
+{
+    if (!m_Initialized || width == 0 || height == 0) return 0;
+
+    TextureConversion conversion;
+    if (!GetTextureConversion((uint32_t)format, TEXEL_ORDER_BGRA, conversion) ||
+        (conversion.blockSize > 1 && !Vulkan::Renderer::GetInstance().SupportsBCTextures()))
+    {
+        char msg[128];
+        sprintf_s(msg, "[D3D8Bridge] No upload path for texture format %u\n", (unsigned)format);
+        OutputDebugStringA(msg);
+        return 0;
+    }
+
+    UINT fullChain = 1;
+    while ((width >> fullChain) != 0 || (height >> fullChain) != 0) fullChain++;
+
+    TraceCreateTexture args = {};
+    args.width = width;
+    args.height = height;
+    args.levels = (levels == 0 || levels > fullChain) ? fullChain : levels;
+    args.format = (uint32_t)format;
+    {
+        // The entry exists before the call is queued, so the caller can
+        // upload levels right away; the executing thread adds the image.
+        std::lock_guard<std::mutex> lock(m_TextureMutex);
+        args.texture = m_NextTexture++;
+        InsertTexture(args, conversion);
+    }
+
+    if (Capture(TraceOp::CreateTexture, args)) return args.texture;
+
+    if (CreateTextureImage(args)) return args.texture;
+    ReleaseTextureImage(args.texture);
+    return 0;
+}
+
+bool D3D8Bridge::UpdateTexture(TextureHandle texture, UINT level, const void* bits, UINT pitch, const PALETTEENTRY* palette)
+{
+    TextureLevel info;
+    if (!bits || !GetTextureLevel(texture, level, info) || pitch < info.rowBytes) return false;
+
+    const bool paletted = info.conversion.source == TEXTURE_FORMAT_P8;
+    if (paletted && !palette) return false;
+
+    TraceUpdateTexture args = {};
+    args.texture = texture;
+    args.level = level;
+    args.paletteBytes = paletted ? PALETTE_BYTES : 0;
+    args.dataBytes = info.rowBytes * info.rowCount;
+
+    // The locked memory is only valid until UnlockRect returns, so the
+    // rows are copied, without their padding.
+    bool queued = Capture(TraceOp::UpdateTexture, (uint32_t)sizeof(args) + args.paletteBytes + args.dataBytes,
+        [&](uint8_t* record)
+        {
+            memcpy(record, &args, sizeof(args));
+            record += sizeof(args);
+            if (paletted) memcpy(record, palette, PALETTE_BYTES);
+            record += args.paletteBytes;
+
+            const uint8_t* row = static_cast<const uint8_t*>(bits);
+            for (uint32_t y = 0; y < info.rowCount; y++)
+            {
+                memcpy(record + (size_t)y * info.rowBytes, row, info.rowBytes);
+                row += pitch;
+            }
+        });
+    if (queued) return true;
+
+    return UploadTextureLevel(texture, level, bits, pitch, palette);
+}
+
+void D3D8Bridge::ReleaseTexture(TextureHandle texture)
+{
+    if (Capture(TraceOp::ReleaseTexture, (uint32_t)texture)) return;
+
+    ReleaseTextureImage(texture);
+}
+
+bool D3D8Bridge::GetTextureLevel(TextureHandle texture, UINT level, TextureLevel& info)
+{
+    std::lock_guard<std::mutex> lock(m_TextureMutex);
+
+    auto it = m_Textures.find(texture);
+    if (it == m_Textures.end() || level >= it->second.levels) return false;
+
+    const Texture& entry = it->second;
+    info.image = entry.image;
+    info.conversion = entry.conversion;
+    info.width = std::max(entry.width >> level, 1u);
+    info.height = std::max(entry.height >> level, 1u);
+
+    if (entry.conversion.source == TEXTURE_FORMAT_RAW)
+    {
+        const uint32_t block = entry.conversion.blockSize;
+        info.rowBytes = (info.width + block - 1) / block * entry.conversion.bytesPerBlock;
+        info.rowCount = (info.height + block - 1) / block;
+    }
+    else
+    {
+        info.rowBytes = info.width * GetSourceTexelSize(entry.conversion.source);
+        info.rowCount = info.height;
+    }
+    return true;
+}
+
+void D3D8Bridge::InsertTexture(const TraceCreateTexture& args, const TextureConversion& conversion)
+{
+    Texture& texture = m_Textures[args.texture];
+    texture.conversion = conversion;
+    texture.width = args.width;
+    texture.height = args.height;
+    texture.levels = args.levels;
+}
+
+bool D3D8Bridge::CreateTextureImage(const TraceCreateTexture& args)
+{
+    std::lock_guard<std::mutex> lock(m_TextureMutex);
+
+    // A replayed trace brings its own handles and has no entry yet.
+    auto it = m_Textures.find(args.texture);
+    if (it == m_Textures.end())
+    {
+        TextureConversion conversion;
+        if (!GetTextureConversion(args.format, TEXEL_ORDER_BGRA, conversion)) return false;
+        if (args.texture >= m_NextTexture) m_NextTexture = args.texture + 1;
+        InsertTexture(args, conversion);
+        it = m_Textures.find(args.texture);
+    }
+
+    // The entry is kept even if the image fails, so uploads to it are
+    // reported rather than treated as malformed.
+    Texture& texture = it->second;
+    if (texture.image) return true;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = texture.conversion.format;
+    imageInfo.extent = {args.width, args.height, 1};
+    imageInfo.mipLevels = args.levels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkDevice device = Vulkan::Renderer::GetInstance().GetDevice();
+    if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+    {
+        texture.image = VK_NULL_HANDLE;
+        OutputDebugStringA("[D3D8Bridge] Failed to create texture image\n");
+        return false;
+    }
+
+    if (!Vulkan::MemoryAllocator::GetInstance().AllocateForImage(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, texture.memory))
+    {
+        vkDestroyImage(device, texture.image, nullptr);
+        texture.image = VK_NULL_HANDLE;
+        OutputDebugStringA("[D3D8Bridge] Failed to allocate texture memory\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool D3D8Bridge::UploadTextureLevel(TextureHandle texture, UINT level, const void* bits, UINT pitch, const PALETTEENTRY* palette)
+{
+    TextureLevel info;
+    if (!GetTextureLevel(texture, level, info)) return false;
+
+    const bool paletted = info.conversion.source == TEXTURE_FORMAT_P8;
+    if (!info.image || (paletted && !palette))
+    {
+        char msg[128];
+        sprintf_s(msg, "[D3D8Bridge] Skipping upload to texture %u: %s\n", texture, info.image ? "no palette" : "no image");
+        OutputDebugStringA(msg);
+        return false;
+    }
+
+    uint32_t paletteTexels[256];
+    if (paletted) ConvertPalette(reinterpret_cast<const uint8_t*>(palette), TEXEL_ORDER_BGRA, paletteTexels);
+
+    Vulkan::ImageUpload upload;
+    upload.image = info.image;
+    upload.width = info.width;
+    upload.height = info.height;
+    upload.mipLevel = level;
+    upload.data = bits;
+    upload.size = (VkDeviceSize)info.rowBytes * info.rowCount;
+    upload.blockSize = info.conversion.blockSize;
+    upload.sourceFormat = info.conversion.source;
+    upload.texelOrder = TEXEL_ORDER_BGRA;
+    upload.sourcePitch = pitch;
+    upload.palette = paletted ? paletteTexels : nullptr;
+
+    Vulkan::UploadTicket ticket = Vulkan::UploadScheduler::GetInstance().UploadImage(upload);
+    if (ticket == 0)
+    {
+        char msg[128];
+        sprintf_s(msg, "[D3D8Bridge] Upload of texture %u level %u failed\n", texture, level);
+        OutputDebugStringA(msg);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_TextureMutex);
+    auto it = m_Textures.find(texture);
+    if (it != m_Textures.end()) it->second.lastUpload = ticket;
+    return true;
+}
+
+void D3D8Bridge::ReleaseTextureImage(TextureHandle handle)
+{
+    Texture texture;
+    {
+        std::lock_guard<std::mutex> lock(m_TextureMutex);
+        auto it = m_Textures.find(handle);
+        if (it == m_Textures.end()) return;
+        texture = it->second;
+        m_Textures.erase(it);
+    }
+    if (!texture.image) return;
+
+    // Frames in flight may still use the image, which the deletion queue
+    // covers. An upload batch no frame has waited for yet is not covered;
+    // such textures are parked until a frame has taken the batch.
+    if (texture.lastUpload != 0 && !Vulkan::UploadScheduler::GetInstance().IsReady(texture.lastUpload))
+    {
+        m_RetiredTextures.push_back(texture);
+        return;
+    }
+
+    Vulkan::DeletionQueue& deletionQueue = Vulkan::DeletionQueue::GetInstance();
+    deletionQueue.DestroyImage(texture.image);
+    deletionQueue.FreeMemory(texture.memory);
+}
+
+void D3D8Bridge::RetireTextures()
+{
+    // The frame being recorded has just taken the submitted upload batches
+    // and waits for them, so its deletion queue entries outlive the copies.
+    Vulkan::UploadScheduler& uploads = Vulkan::UploadScheduler::GetInstance();
+    Vulkan::DeletionQueue& deletionQueue = Vulkan::DeletionQueue::GetInstance();
+    for (size_t i = 0; i < m_RetiredTextures.size();)
+    {
+        Texture& texture = m_RetiredTextures[i];
+        if (!uploads.IsReady(texture.lastUpload))
+        {
+            i++;
+            continue;
+        }
+
+        deletionQueue.DestroyImage(texture.image);
+        deletionQueue.FreeMemory(texture.memory);
+        texture = m_RetiredTextures.back();
+        m_RetiredTextures.pop_back();
+    }
+}
+
+void D3D8Bridge::DestroyTextures()
+{
+    // The device is idle.
+    std::lock_guard<std::mutex> lock(m_TextureMutex);
+
+    VkDevice device = Vulkan::Renderer::GetInstance().GetDevice();
+    Vulkan::MemoryAllocator& allocator = Vulkan::MemoryAllocator::GetInstance();
+    for (auto& entry : m_Textures)
+    {
+        if (!entry.second.image) continue;
+        vkDestroyImage(device, entry.second.image, nullptr);
+        allocator.Free(entry.second.memory);
+    }
+    for (Texture& texture : m_RetiredTextures)
+    {
+        vkDestroyImage(device, texture.image, nullptr);
+        allocator.Free(texture.memory);
+    }
+    m_Textures.clear();
+    m_RetiredTextures.clear();
+    m_NextTexture = 1;
+}
+
+void D3D8Bridge::WarmUpPipelines(const std::vector<PipelineKey>& keys)
+{
+    uint32_t built = 0;
+    for (const PipelineKey& key : keys)
+    {
+        if (m_PipelineCache.Lookup(key) != VK_NULL_HANDLE) continue;
+
+        VkPipeline pipeline = CreatePipeline(key);
+        if (pipeline == VK_NULL_HANDLE) continue;
+
+        m_PipelineCache.Insert(key, pipeline);
+        built++;
+    }
+
+    if (!keys.empty())
+    {
+        char msg[128];
+        sprintf_s(msg, "[D3D8Bridge] Warmed up %u of %zu pipelines\n", built, keys.size());
+        OutputDebugStringA(msg);
+    }
+}
+
+bool D3D8Bridge::SelectPipeline(VkPrimitiveTopology topology)
+{
+    PipelineKey& key = m_State.pipelineKey;
+    if (key.topology != (uint8_t)topology)
+    {
+        key.topology = (uint8_t)topology;
+        m_State.pipelineDirty = true;
+    }
+
+    if (!m_State.pipelineDirty) return m_State.graphicsPipeline != VK_NULL_HANDLE;
+
+    VkPipeline pipeline = m_PipelineCache.Lookup(key);
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        pipeline = CreatePipeline(key);
+        if (pipeline == VK_NULL_HANDLE) return false;
+        m_PipelineCache.Insert(key, pipeline);
+    }
+
+    m_State.graphicsPipeline = pipeline;
+    m_State.pipelineDirty = false;
+    return true;
+}
+
+VkPipeline D3D8Bridge::CreatePipeline(const PipelineKey& key)
+{
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+
+    // Vertex layout from the FVF, in D3D8 declaration order.
+    VkVertexInputAttributeDescription attributes[4 + 8 + 4] = {};
+    uint32_t attributeCount = 0;
+    uint32_t offset = 0;
+
+    auto addAttribute = [&](uint32_t location, VkFormat format, uint32_t size)
+    {
+        attributes[attributeCount].location = location;
+        attributes[attributeCount].binding = 0;
+        attributes[attributeCount].format = format;
+        attributes[attributeCount].offset = offset;
+        attributeCount++;
+        offset += size;
+    };
+
+    // The position type is a field, not a set of flags: XYZB1-5 share
+    // bits with both XYZ and XYZRHW.
+    uint32_t vertexFormat = 0;
+    uint32_t position = key.fvf & D3DFVF_POSITION_MASK;
+    if (position == D3DFVF_XYZRHW)
+    {
+        addAttribute(SCENE_LOCATION_POSITION, VK_FORMAT_R32G32B32A32_SFLOAT, 16);
+        vertexFormat |= SCENE_FORMAT_PRETRANSFORMED;
+    }
+    else if (position != 0)
+    {
+        addAttribute(SCENE_LOCATION_POSITION, VK_FORMAT_R32G32B32_SFLOAT, 12);
+        // Blend weights follow an XYZB1-5 position; nothing reads them.
+        if (position >= D3DFVF_XYZB1) offset += (position - D3DFVF_XYZRHW) / 2 * 4;
+    }
+    if (key.fvf & D3DFVF_NORMAL)
+    {
+        addAttribute(SCENE_LOCATION_NORMAL, VK_FORMAT_R32G32B32_SFLOAT, 12);
+        vertexFormat |= SCENE_FORMAT_NORMAL;
+    }
+    if (key.fvf & D3DFVF_DIFFUSE)
+    {
+        addAttribute(SCENE_LOCATION_DIFFUSE, VK_FORMAT_B8G8R8A8_UNORM, 4);
+        vertexFormat |= SCENE_FORMAT_DIFFUSE;
+    }
+    if (key.fvf & D3DFVF_SPECULAR) addAttribute(SCENE_LOCATION_SPECULAR, VK_FORMAT_B8G8R8A8_UNORM, 4);
+    uint32_t texCount = (key.fvf & D3DFVF_TEXCOUNT_MASK) >> D3DFVF_TEXCOUNT_SHIFT;
+    for (uint32_t i = 0; i < texCount && i < 8; i++) addAttribute(SCENE_LOCATION_TEXCOORD + i, VK_FORMAT_R32G32_SFLOAT, 8);
+
+    // Every input the vertex shader reads needs an attribute. Absent ones
+    // read the first float of the vertex, which the shader ignores.
+    auto addPlaceholder = [&](uint32_t location)
+    {
+        for (uint32_t i = 0; i < attributeCount; i++)
+        {
+            if (attributes[i].location == location) return;
+        }
+        attributes[attributeCount].location = location;
+        attributes[attributeCount].binding = 0;
+        attributes[attributeCount].format = VK_FORMAT_R32_SFLOAT;
+        attributes[attributeCount].offset = 0;
+        attributeCount++;
+    };
+    addPlaceholder(SCENE_LOCATION_POSITION);
+    addPlaceholder(SCENE_LOCATION_NORMAL);
+    addPlaceholder(SCENE_LOCATION_DIFFUSE);
+
+    VkVertexInputBindingDescription bindings[2] = {};
+    bindings[0].binding = 0;
+    bindings[0].stride = offset;
+    bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    // Instanced draws add the world matrix rows as per-instance attributes.
+    if (key.instanced)
+    {
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            attributes[attributeCount].location = SCENE_LOCATION_INSTANCE_WORLD + row;
+            attributes[attributeCount].binding = SCENE_INSTANCE_BINDING;
+            attributes[attributeCount].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributes[attributeCount].offset = row * 16;
+            attributeCount++;
+        }
+        bindings[1].binding = SCENE_INSTANCE_BINDING;
+        bindings[1].stride = sizeof(Math::Matrix4);
+        bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    }
+    else
+    {
+        for (uint32_t row = 0; row < 4; row++) addPlaceholder(SCENE_LOCATION_INSTANCE_WORLD + row);
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = key.instanced ? 2 : 1;
+    vertexInputInfo.pVertexBindingDescriptions = bindings;
+    vertexInputInfo.vertexAttributeDescriptionCount = attributeCount;
+    vertexInputInfo.pVertexAttributeDescriptions = attributes;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = (VkPrimitiveTopology)key.topology;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = key.cullMode;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = key.depthTestEnable;
+    depthStencil.depthWriteEnable = key.depthWriteEnable;
+    depthStencil.depthCompareOp = (VkCompareOp)key.depthCompareOp;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = key.blendEnable;
+    colorBlendAttachment.srcColorBlendFactor = (VkBlendFactor)key.srcBlend;
+    colorBlendAttachment.dstColorBlendFactor = (VkBlendFactor)key.dstBlend;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = (VkBlendFactor)key.srcBlend;
+    colorBlendAttachment.dstAlphaBlendFactor = (VkBlendFactor)key.dstBlend;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    // Alpha test has no fixed-function equivalent; the pixel shader
+    // discards based on this specialization constant.
+    uint32_t alphaCompareOp = key.alphaTestEnable ? key.alphaCompareOp : (uint32_t)VK_COMPARE_OP_ALWAYS;
+    VkSpecializationMapEntry specEntry = { SCENE_SPEC_ALPHA_COMPARE_OP, 0, sizeof(uint32_t) };
+    VkSpecializationInfo specInfo = {};
+    specInfo.mapEntryCount = 1;
+    specInfo.pMapEntries = &specEntry;
+    specInfo.dataSize = sizeof(uint32_t);
+    specInfo.pData = &alphaCompareOp;
+
+    // The vertex shader builds worldViewProjection from the instance's
+    // world matrix and the viewProjection block when instanced is set,
+    // and skips the FVF components the vertex does not have.
+    uint32_t vertexSpecData[2] = { key.instanced, vertexFormat };
+    VkSpecializationMapEntry vertexSpecEntries[2] = {
+        { SCENE_SPEC_INSTANCED, 0, sizeof(uint32_t) },
+        { SCENE_SPEC_VERTEX_FORMAT, sizeof(uint32_t), sizeof(uint32_t) },
+    };
+    VkSpecializationInfo vertexSpecInfo = {};
+    vertexSpecInfo.mapEntryCount = 2;
+    vertexSpecInfo.pMapEntries = vertexSpecEntries;
+    vertexSpecInfo.dataSize = sizeof(vertexSpecData);
+    vertexSpecInfo.pData = vertexSpecData;
+
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = m_VertexShaderModule;
+    stages[0].pName = "main";
+    stages[0].pSpecializationInfo = &vertexSpecInfo;
+
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = m_PixelShaderModule;
+    stages[1].pName = "main";
+    stages[1].pSpecializationInfo = &specInfo;
+
+    // Without a render pass the pipeline only needs the attachment format.
+    VkFormat colorFormat = renderer.GetColorFormat();
+    VkPipelineRenderingCreateInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = renderer.UsesDynamicRendering() ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_State.pipelineLayout;
+    pipelineInfo.renderPass = renderer.GetRenderPass();
+    pipelineInfo.subpass = 0;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (Vulkan::PipelineCache::GetInstance().CreateGraphicsPipelines(1, &pipelineInfo, &pipeline) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to create pipeline for render state\n");
+        return VK_NULL_HANDLE;
+    }
+
+    return pipeline;
+}
+
+void D3D8Bridge::LoadWarmUpList(std::vector<PipelineKey>& keys)
+{
+    const std::wstring& path = Config::ConfigManager::GetInstance().GetRenderer().pipelineWarmUpPath;
+    if (path.empty()) return;
+
+    std::ifstream file(std::filesystem::path(path), std::ios::binary);
+    if (!file) return;
+
+    uint32_t header[2] = {};
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        header[0] != WARM_UP_LIST_MAGIC || header[1] > WARM_UP_LIST_MAX_KEYS)
+    {
+        OutputDebugStringA("[D3D8Bridge] Ignoring invalid pipeline warm-up list\n");
+        return;
+    }
+
+    keys.resize(header[1]);
+    if (!file.read(reinterpret_cast<char*>(keys.data()), (std::streamsize)(keys.size() * sizeof(PipelineKey))))
+    {
+        OutputDebugStringA("[D3D8Bridge] Ignoring truncated pipeline warm-up list\n");
+        keys.clear();
+    }
+}
+
+void D3D8Bridge::SaveWarmUpList()
+{
+    const std::wstring& path = Config::ConfigManager::GetInstance().GetRenderer().pipelineWarmUpPath;
+    if (path.empty()) return;
+
+    std::vector<PipelineKey> keys;
+    m_PipelineCache.GetKeys(keys);
+    if (keys.empty()) return;
+
+    std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        OutputDebugStringA("[D3D8Bridge] Failed to write pipeline warm-up list\n");
+        return;
+    }
+
+    uint32_t header[2] = { WARM_UP_LIST_MAGIC, (uint32_t)keys.size() };
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(keys.data()), (std::streamsize)(keys.size() * sizeof(PipelineKey)));
+}
+
+} // namespace Bridge
@@ -0,0 +1,166 @@
+#include "../include/platform.h"
+#include "../include/d3d8_trace.h"
+#include <filesystem>
+
+namespace Bridge {
+
+bool TraceWriter::Start(const std::wstring& path, uint32_t width, uint32_t height)
+{
+    if (m_bRecording) return true;
+
+    m_File.open(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+    if (!m_File)
+    {
+        OutputDebugStringA("[TraceWriter] Failed to open trace file\n");
+        return false;
+    }
+
+    TraceFileHeader header = {};
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.width = width;
+    header.height = height;
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_Stats = TraceWriterStats();
+    m_Stats.bytesWritten = sizeof(header);
+
+    // Reserve enough that a chunk normally fills without reallocating.
+    m_Front.clear();
+    m_Back.clear();
+    m_Front.reserve(CHUNK_SIZE * 2);
+    m_Back.reserve(CHUNK_SIZE * 2);
+
+    m_bStopping = false;
+    m_Thread = std::thread(&TraceWriter::WriterThread, this);
+
+    m_bRecording = true;
+    OutputDebugStringA("[TraceWriter] Recording started\n");
+    return true;
+}
+
+void TraceWriter::Stop()
+{
+    if (!m_bRecording) return;
+
+    {
+        // Hand over whatever is left once the writer has drained its chunk.
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Condition.wait(lock, [this] { return m_Back.empty(); });
+        m_Front.swap(m_Back);
+        m_bStopping = true;
+    }
+    m_Condition.notify_all();
+    m_Thread.join();
+
+    m_File.close();
+    m_Front = std::vector<uint8_t>();
+    m_Back = std::vector<uint8_t>();
+    m_bRecording = false;
+
+    char msg[256];
+    sprintf_s(msg, "[TraceWriter] Recorded %llu calls, %llu KB in %u chunks (%u deferred swaps)\n",
+        (unsigned long long)m_Stats.recordCount, (unsigned long long)(m_Stats.bytesWritten / 1024),
+        m_Stats.chunkCount, m_Stats.deferredSwaps);
+    OutputDebugStringA(msg);
+}
+
+uint8_t* TraceWriter::BeginRecord(TraceOp op, uint32_t payloadSize)
+{
+    TraceRecordHeader header = {};
+    header.op = (uint16_t)op;
+    header.size = payloadSize;
+
+    size_t offset = m_Front.size();
+    m_Front.resize(offset + sizeof(header) + payloadSize);
+    memcpy(m_Front.data() + offset, &header, sizeof(header));
+
+    m_Stats.recordCount++;
+    return m_Front.data() + offset + sizeof(header);
+}
+
+void TraceWriter::EndRecord()
+{
+    if (m_Front.size() < CHUNK_SIZE) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Back.empty())
+        {
+            // The writer is still busy with the previous chunk; keep
+            // appending rather than stall the game thread.
+            m_Stats.deferredSwaps++;
+            return;
+        }
+
+        m_Front.swap(m_Back);
+        m_Stats.chunkCount++;
+    }
+    m_Condition.notify_all();
+}
+
+void TraceWriter::WriterThread()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    for (;;)
+    {
+        m_Condition.wait(lock, [this] { return !m_Back.empty() || m_bStopping; });
+        if (m_Back.empty()) break;
+
+        // m_Back is not touched by the game thread while it is non-empty.
+        lock.unlock();
+        m_File.write(reinterpret_cast<const char*>(m_Back.data()), (std::streamsize)m_Back.size());
+        lock.lock();
+
+        m_Stats.bytesWritten += m_Back.size();
+        m_Back.clear();
+        m_Condition.notify_all();
+    }
+}
+
+bool TraceReader::Open(const std::wstring& path)
+{
+    m_File.open(std::filesystem::path(path), std::ios::binary);
+    if (!m_File)
+    {
+        OutputDebugStringA("[TraceReader] Failed to open trace file\n");
+        return false;
+    }
+
+    if (!m_File.read(reinterpret_cast<char*>(&m_Header), sizeof(m_Header)) ||
+        m_Header.magic != TRACE_MAGIC || m_Header.version != TRACE_VERSION)
+    {
+        OutputDebugStringA("[TraceReader] Not a trace file or unsupported version\n");
+        m_File.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool TraceReader::Next(TraceOp& op, std::vector<uint8_t>& payload)
+{
+    TraceRecordHeader header;
+    if (!m_File.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        // A clean end of file leaves nothing of a header behind.
+        if (m_File.gcount() == 0) return false;
+
+        OutputDebugStringA("[TraceReader] Truncated record header\n");
+        m_bTruncated = true;
+        return false;
+    }
+
+    payload.resize(header.size);
+    if (header.size > 0 && !m_File.read(reinterpret_cast<char*>(payload.data()), header.size))
+    {
+        OutputDebugStringA("[TraceReader] Truncated record\n");
+        m_bTruncated = true;
+        return false;
+    }
+
+    op = (TraceOp)header.op;
+    return true;
+}
+
+} // namespace Bridge
@@ -0,0 +1,125 @@
+#include "../include/platform.h"
+#include "../include/deletion_queue.h"
+
+namespace Vulkan {
+
+DeletionQueue& DeletionQueue::GetInstance()
+{
+    static DeletionQueue instance;
+    return instance;
+}
+
+void DeletionQueue::Initialize(VkDevice device, uint32_t framesInFlight)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Device = device;
+    m_FramesInFlight = framesInFlight ? framesInFlight : 1;
+    m_Frame = 0;
+    m_ReleasedCount = 0;
+}
+
+void DeletionQueue::Shutdown()
+{
+    if (!m_Device) return;
+
+    Flush();
+
+    char msg[128];
+    sprintf_s(msg, "[DeletionQueue] %llu objects released\n", (unsigned long long)m_ReleasedCount);
+    OutputDebugStringA(msg);
+
+    m_Device = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::FreeMemory(Allocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    Entry entry;
+    entry.type = DELETION_MEMORY;
+    entry.allocation = allocation;
+    allocation = Allocation();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    entry.frame = m_Frame;
+    m_Entries.push_back(entry);
+}
+
+void DeletionQueue::Push(DeletionType type, uint64_t handle)
+{
+    if (handle == 0) return;
+
+    Entry entry;
+    entry.type = type;
+    entry.handle = handle;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    entry.frame = m_Frame;
+    m_Entries.push_back(entry);
+}
+
+void DeletionQueue::BeginFrame(uint64_t frame)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Frame = frame;
+
+    // Slots complete in submission order, so once this slot's fence has
+    // signalled every frame up to frame - framesInFlight has finished.
+    while (!m_Entries.empty() && m_Entries.front().frame + m_FramesInFlight <= frame)
+    {
+        Release(m_Entries.front());
+        m_Entries.pop_front();
+    }
+}
+
+void DeletionQueue::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (Entry& entry : m_Entries) Release(entry);
+    m_Entries.clear();
+}
+
+uint32_t DeletionQueue::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return (uint32_t)m_Entries.size();
+}
+
+void DeletionQueue::Release(Entry& entry)
+{
+    switch (entry.type)
+    {
+    case DELETION_IMAGE:
+        vkDestroyImage(m_Device, (VkImage)entry.handle, nullptr);
+        break;
+    case DELETION_IMAGE_VIEW:
+        vkDestroyImageView(m_Device, (VkImageView)entry.handle, nullptr);
+        break;
+    case DELETION_BUFFER:
+        vkDestroyBuffer(m_Device, (VkBuffer)entry.handle, nullptr);
+        break;
+    case DELETION_MEMORY:
+        MemoryAllocator::GetInstance().Free(entry.allocation);
+        break;
+    case DELETION_PIPELINE:
+        vkDestroyPipeline(m_Device, (VkPipeline)entry.handle, nullptr);
+        break;
+    case DELETION_FRAMEBUFFER:
+        vkDestroyFramebuffer(m_Device, (VkFramebuffer)entry.handle, nullptr);
+        break;
+    case DELETION_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(m_Device, (VkDescriptorPool)entry.handle, nullptr);
+        break;
+    case DELETION_SWAPCHAIN:
+        vkDestroySwapchainKHR(m_Device, (VkSwapchainKHR)entry.handle, nullptr);
+        break;
+    case DELETION_SEMAPHORE:
+        vkDestroySemaphore(m_Device, (VkSemaphore)entry.handle, nullptr);
+        break;
+    default:
+        break;
+    }
+    m_ReleasedCount++;
+}
+
+} // namespace Vulkan
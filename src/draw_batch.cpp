@@ -0,0 +1,136 @@
+#include "../include/draw_batch.h"
+#include <cstring>
+
+namespace {
+
+bool IsListTopology(VkPrimitiveTopology topology)
+{
+    return topology == VK_PRIMITIVE_TOPOLOGY_POINT_LIST ||
+           topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST ||
+           topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+}
+
+template <typename T>
+void RebaseIndices(const void* source, uint32_t count, uint32_t minVertexIndex, uint32_t base, uint8_t* destination)
+{
+    const T* in = static_cast<const T*>(source);
+    T* out = reinterpret_cast<T*>(destination);
+    for (uint32_t i = 0; i < count; i++) out[i] = (T)(in[i] - minVertexIndex + base);
+}
+
+template <typename T>
+bool SameRebasedIndices(const void* source, uint32_t count, uint32_t minVertexIndex, const uint8_t* rebased)
+{
+    const T* in = static_cast<const T*>(source);
+    const T* stored = reinterpret_cast<const T*>(rebased);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if ((T)(in[i] - minVertexIndex) != stored[i]) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace Bridge {
+
+bool DrawBatch::Add(const BatchDraw& draw)
+{
+    if (m_DrawCount == 0)
+    {
+        m_Topology = draw.topology;
+        m_IndexType = draw.indexType;
+        m_VertexStride = draw.vertexStride;
+        m_FirstMinVertexIndex = draw.minVertexIndex;
+        Append(draw);
+        m_Worlds.push_back(*draw.world);
+    }
+    else if (CanInstance(draw))
+    {
+        m_Worlds.push_back(*draw.world);
+        m_Stats.instancedDraws++;
+    }
+    else if (CanMerge(draw))
+    {
+        Append(draw);
+        m_Stats.mergedDraws++;
+    }
+    else
+    {
+        return false;
+    }
+
+    m_DrawCount++;
+    m_Stats.drawsIn++;
+    return true;
+}
+
+void DrawBatch::Clear()
+{
+    if (m_DrawCount > 0) m_Stats.drawsOut++;
+
+    m_VertexCount = 0;
+    m_IndexCount = 0;
+    m_DrawCount = 0;
+    m_Vertices.clear();
+    m_Indices.clear();
+    m_Worlds.clear();
+}
+
+bool DrawBatch::CanInstance(const BatchDraw& draw) const
+{
+    // Only a batch that is still one geometry can become instanced.
+    if (m_Worlds.size() != m_DrawCount || m_Worlds.size() >= MAX_INSTANCES) return false;
+
+    if (draw.topology != m_Topology || draw.indexType != m_IndexType || draw.vertexStride != m_VertexStride ||
+        draw.vertexCount != m_VertexCount || draw.indexCount != m_IndexCount ||
+        draw.minVertexIndex != m_FirstMinVertexIndex)
+    {
+        return false;
+    }
+
+    if (memcmp(draw.vertices, m_Vertices.data(), m_Vertices.size()) != 0) return false;
+
+    return m_IndexType == VK_INDEX_TYPE_UINT32
+        ? SameRebasedIndices<uint32_t>(draw.indices, draw.indexCount, draw.minVertexIndex, m_Indices.data())
+        : SameRebasedIndices<uint16_t>(draw.indices, draw.indexCount, draw.minVertexIndex, m_Indices.data());
+}
+
+bool DrawBatch::CanMerge(const BatchDraw& draw) const
+{
+    if (m_Worlds.size() != 1 || !IsListTopology(draw.topology)) return false;
+
+    if (draw.topology != m_Topology || draw.indexType != m_IndexType || draw.vertexStride != m_VertexStride)
+    {
+        return false;
+    }
+
+    // Rebased 16-bit indices must still fit.
+    if (m_IndexType == VK_INDEX_TYPE_UINT16 && m_VertexCount + draw.vertexCount > 65536) return false;
+    if (m_Vertices.size() + (size_t)draw.vertexCount * draw.vertexStride > MAX_VERTEX_BYTES) return false;
+
+    return memcmp(draw.world, &m_Worlds[0], sizeof(Math::Matrix4)) == 0;
+}
+
+void DrawBatch::Append(const BatchDraw& draw)
+{
+    const uint8_t* vertices = static_cast<const uint8_t*>(draw.vertices);
+    m_Vertices.insert(m_Vertices.end(), vertices, vertices + (size_t)draw.vertexCount * draw.vertexStride);
+
+    size_t indexSize = (m_IndexType == VK_INDEX_TYPE_UINT32) ? 4 : 2;
+    size_t offset = m_Indices.size();
+    m_Indices.resize(offset + (size_t)draw.indexCount * indexSize);
+    if (m_IndexType == VK_INDEX_TYPE_UINT32)
+    {
+        RebaseIndices<uint32_t>(draw.indices, draw.indexCount, draw.minVertexIndex, m_VertexCount, &m_Indices[offset]);
+    }
+    else
+    {
+        RebaseIndices<uint16_t>(draw.indices, draw.indexCount, draw.minVertexIndex, m_VertexCount, &m_Indices[offset]);
+    }
+
+    m_VertexCount += draw.vertexCount;
+    m_IndexCount += draw.indexCount;
+}
+
+} // namespace Bridge
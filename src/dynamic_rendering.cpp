@@ -0,0 +1,81 @@
+#include "../include/platform.h"
+#include "../include/dynamic_rendering.h"
+
+namespace Vulkan {
+
+DynamicRendering& DynamicRendering::GetInstance()
+{
+    static DynamicRendering instance;
+    return instance;
+}
+
+bool DynamicRendering::Initialize(VkDevice device, bool core)
+{
+    m_CmdBeginRendering = (PFN_vkCmdBeginRendering)vkGetDeviceProcAddr(device, core ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR");
+    m_CmdEndRendering = (PFN_vkCmdEndRendering)vkGetDeviceProcAddr(device, core ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR");
+
+    if (!m_CmdBeginRendering || !m_CmdEndRendering)
+    {
+        OutputDebugStringA("[DynamicRendering] Entry points not found; using render passes\n");
+        Shutdown();
+        return false;
+    }
+
+    OutputDebugStringA(core ? "[DynamicRendering] Using Vulkan 1.3 dynamic rendering\n"
+                            : "[DynamicRendering] Using VK_KHR_dynamic_rendering\n");
+    return true;
+}
+
+void DynamicRendering::Shutdown()
+{
+    m_CmdBeginRendering = nullptr;
+    m_CmdEndRendering = nullptr;
+}
+
+void DynamicRendering::Begin(VkCommandBuffer commandBuffer, VkImageView view, VkExtent2D extent,
+    const VkClearColorValue* clearColor, VkRenderingFlags flags) const
+{
+    VkRenderingAttachmentInfo colorAttachment = {};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = view;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = clearColor ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    if (clearColor) colorAttachment.clearValue.color = *clearColor;
+
+    VkRenderingInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.flags = flags;
+    renderingInfo.renderArea.extent = extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+
+    m_CmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void DynamicRendering::End(VkCommandBuffer commandBuffer) const
+{
+    m_CmdEndRendering(commandBuffer);
+}
+
+void DynamicRendering::Transition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+} // namespace Vulkan
@@ -0,0 +1,181 @@
+#include "../include/platform.h"
+#include "../include/frame_scheduler.h"
+
+namespace Vulkan {
+
+FrameScheduler& FrameScheduler::GetInstance()
+{
+    static FrameScheduler instance;
+    return instance;
+}
+
+bool FrameScheduler::Initialize(VkDevice device, bool core)
+{
+    if (m_bInitialized) return true;
+
+    // Timeline semaphores are core in every version the renderer asks for.
+    m_QueueSubmit2 = (PFN_vkQueueSubmit2)vkGetDeviceProcAddr(device, core ? "vkQueueSubmit2" : "vkQueueSubmit2KHR");
+    m_CmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2)vkGetDeviceProcAddr(device, core ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR");
+    m_WaitSemaphores = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(device, "vkWaitSemaphores");
+    m_GetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue");
+
+    if (!m_QueueSubmit2 || !m_CmdPipelineBarrier2 || !m_WaitSemaphores || !m_GetSemaphoreCounterValue)
+    {
+        OutputDebugStringA("[FrameScheduler] Entry points not found; using fences\n");
+        Shutdown();
+        return false;
+    }
+
+    m_Device = device;
+    m_bInitialized = true;
+    OutputDebugStringA(core ? "[FrameScheduler] Using timeline semaphores with Vulkan 1.3 synchronization2\n"
+                            : "[FrameScheduler] Using timeline semaphores with VK_KHR_synchronization2\n");
+    return true;
+}
+
+void FrameScheduler::Shutdown()
+{
+    // The device is idle.
+    for (uint32_t i = 0; i < m_QueueCount; i++)
+    {
+        vkDestroySemaphore(m_Device, m_Queues[i].semaphore, nullptr);
+        m_Queues[i] = QueueTimeline();
+    }
+
+    if (m_bInitialized)
+    {
+        char msg[128];
+        sprintf_s(msg, "[FrameScheduler] %llu submits\n", (unsigned long long)m_LastValue);
+        OutputDebugStringA(msg);
+    }
+
+    m_Device = VK_NULL_HANDLE;
+    m_QueueCount = 0;
+    m_LastValue = 0;
+    m_QueueSubmit2 = nullptr;
+    m_CmdPipelineBarrier2 = nullptr;
+    m_WaitSemaphores = nullptr;
+    m_GetSemaphoreCounterValue = nullptr;
+    m_bInitialized = false;
+}
+
+bool FrameScheduler::AddQueue(VkQueue queue)
+{
+    if (!m_bInitialized) return false;
+    if (FindQueue(queue)) return true;
+
+    if (m_QueueCount == MAX_QUEUES)
+    {
+        OutputDebugStringA("[FrameScheduler] Too many queues\n");
+        return false;
+    }
+
+    // Starts at 0, below every value the counter hands out.
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    QueueTimeline& timeline = m_Queues[m_QueueCount];
+    if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &timeline.semaphore) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[FrameScheduler] Failed to create timeline semaphore\n");
+        return false;
+    }
+
+    timeline.queue = queue;
+    m_QueueCount++;
+    return true;
+}
+
+uint64_t FrameScheduler::Submit(VkQueue queue, const VkSemaphoreSubmitInfo* waits, uint32_t waitCount,
+    VkCommandBuffer commandBuffer, VkSemaphore binarySignal)
+{
+    const QueueTimeline* timeline = FindQueue(queue);
+    if (!timeline) return 0;
+
+    VkCommandBufferSubmitInfo commandBufferInfo = {};
+    commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBufferInfo.commandBuffer = commandBuffer;
+
+    VkSemaphoreSubmitInfo signals[2] = {};
+    signals[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signals[0].semaphore = timeline->semaphore;
+    signals[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    signals[1] = signals[0];
+    signals[1].semaphore = binarySignal;
+
+    VkSubmitInfo2 submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submitInfo.waitSemaphoreInfoCount = waitCount;
+    submitInfo.pWaitSemaphoreInfos = waits;
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos = &commandBufferInfo;
+    submitInfo.signalSemaphoreInfoCount = binarySignal ? 2 : 1;
+    submitInfo.pSignalSemaphoreInfos = signals;
+
+    // Allocating under the lock keeps each queue's values increasing in
+    // submission order, as its timeline requires.
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    uint64_t value = m_LastValue + 1;
+    signals[0].value = value;
+
+    if (m_QueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[FrameScheduler] Submit failed\n");
+        return 0;
+    }
+
+    m_LastValue = value;
+    return value;
+}
+
+bool FrameScheduler::Wait(VkQueue queue, uint64_t value, uint64_t timeout) const
+{
+    const QueueTimeline* timeline = FindQueue(queue);
+    if (!timeline || value == 0) return true;
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline->semaphore;
+    waitInfo.pValues = &value;
+
+    return m_WaitSemaphores(m_Device, &waitInfo, timeout) == VK_SUCCESS;
+}
+
+bool FrameScheduler::IsComplete(VkQueue queue, uint64_t value) const
+{
+    const QueueTimeline* timeline = FindQueue(queue);
+    if (!timeline || value == 0) return true;
+
+    uint64_t completed = 0;
+    m_GetSemaphoreCounterValue(m_Device, timeline->semaphore, &completed);
+    return completed >= value;
+}
+
+VkSemaphore FrameScheduler::GetTimeline(VkQueue queue) const
+{
+    const QueueTimeline* timeline = FindQueue(queue);
+    return timeline ? timeline->semaphore : VK_NULL_HANDLE;
+}
+
+void FrameScheduler::Barrier(VkCommandBuffer commandBuffer, const VkDependencyInfo& dependency) const
+{
+    m_CmdPipelineBarrier2(commandBuffer, &dependency);
+}
+
+const FrameScheduler::QueueTimeline* FrameScheduler::FindQueue(VkQueue queue) const
+{
+    for (uint32_t i = 0; i < m_QueueCount; i++)
+    {
+        if (m_Queues[i].queue == queue) return &m_Queues[i];
+    }
+    return nullptr;
+}
+
+} // namespace Vulkan
@@ -0,0 +1,182 @@
+#include "../include/platform.h"
+#include "../include/frame_stats.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace Vulkan {
+
+namespace {
+
+// Entries this close to the write position may be overwritten while a
+// reader copies them, so snapshots leave them out.
+const uint32_t SNAPSHOT_MARGIN = 16;
+
+double ToMs(int64_t nanoseconds)
+{
+    return nanoseconds / 1000000.0;
+}
+
+} // namespace
+
+FrameStats& FrameStats::GetInstance()
+{
+    static FrameStats instance;
+    return instance;
+}
+
+void FrameStats::EndFrame()
+{
+    uint64_t head = m_Head.load(std::memory_order_relaxed);
+    m_Current.frameNumber = head;
+    m_Ring[head & (RING_SIZE - 1)] = m_Current;
+
+    if (m_Current.intervalNs > 0)
+    {
+        std::atomic<uint32_t>& bucket = m_Histogram[BucketIndex((uint64_t)m_Current.intervalNs / 1000)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    m_Head.store(head + 1, std::memory_order_release);
+    m_Current = FrameTiming();
+}
+
+uint32_t FrameStats::BucketIndex(uint64_t microseconds)
+{
+    // Log-linear: exact below 32 us, then HISTOGRAM_SUB_BUCKETS linear
+    // steps per power of two.
+    if (microseconds < 32) return (uint32_t)microseconds;
+
+    uint32_t msb = 5;
+    while ((microseconds >> (msb + 1)) != 0) msb++;
+
+    uint32_t top = (uint32_t)(microseconds >> (msb - 4));
+    uint32_t bucket = 32 + (msb - 5) * HISTOGRAM_SUB_BUCKETS + (top - HISTOGRAM_SUB_BUCKETS);
+    return std::min(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t FrameStats::BucketLowerBound(uint32_t bucket)
+{
+    if (bucket < 32) return bucket;
+
+    uint32_t index = bucket - 32;
+    uint32_t msb = 5 + index / HISTOGRAM_SUB_BUCKETS;
+    uint64_t top = HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS;
+    return top << (msb - 4);
+}
+
+uint32_t FrameStats::Snapshot(FrameTiming* out) const
+{
+    uint64_t head = m_Head.load(std::memory_order_acquire);
+    uint32_t count = (uint32_t)std::min<uint64_t>(head, RING_SIZE - SNAPSHOT_MARGIN);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        out[i] = m_Ring[(head - count + i) & (RING_SIZE - 1)];
+    }
+    return count;
+}
+
+FrameStatsSummary FrameStats::GetSummary() const
+{
+    FrameStatsSummary summary;
+
+    std::vector<FrameTiming> frames(RING_SIZE);
+    uint32_t count = Snapshot(frames.data());
+
+    std::vector<int64_t> intervals;
+    intervals.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (frames[i].intervalNs > 0) intervals.push_back(frames[i].intervalNs);
+        for (uint32_t phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+        {
+            summary.avgPhaseMs[phase] += ToMs(frames[i].phaseNs[phase]);
+        }
+    }
+
+    if (count > 0)
+    {
+        for (uint32_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) summary.avgPhaseMs[phase] /= count;
+    }
+
+    size_t n = intervals.size();
+    if (n == 0) return summary;
+
+    std::sort(intervals.begin(), intervals.end());
+
+    int64_t total = 0;
+    for (int64_t interval : intervals) total += interval;
+
+    // "x% low" is the frame rate averaged over the slowest x% of frames.
+    auto lowFps = [&](size_t divisor) {
+        size_t slowest = std::max<size_t>(1, n / divisor);
+        int64_t sum = 0;
+        for (size_t i = n - slowest; i < n; i++) sum += intervals[i];
+        return 1000.0 / ToMs(sum / (int64_t)slowest);
+    };
+
+    summary.frameCount = (uint32_t)n;
+    summary.avgMs = ToMs(total / (int64_t)n);
+    summary.p50Ms = ToMs(intervals[n / 2]);
+    summary.p99Ms = ToMs(intervals[std::min(n - 1, n * 99 / 100)]);
+    summary.p999Ms = ToMs(intervals[std::min(n - 1, n * 999 / 1000)]);
+    summary.maxMs = ToMs(intervals.back());
+    summary.avgFps = 1000.0 / summary.avgMs;
+    summary.onePercentLowFps = lowFps(100);
+    summary.pointOnePercentLowFps = lowFps(1000);
+    return summary;
+}
+
+bool FrameStats::DumpCsv(const std::wstring& path) const
+{
+    std::vector<FrameTiming> frames(RING_SIZE);
+    uint32_t count = Snapshot(frames.data());
+
+    std::filesystem::path framesPath(path);
+    std::ofstream file(framesPath, std::ios::trunc);
+    if (!file)
+    {
+        OutputDebugStringA("[FrameStats] Failed to write frame time CSV\n");
+        return false;
+    }
+
+    file << "frame,interval_ms,fence_wait_ms,acquire_wait_ms,record_ms,submit_ms,present_ms\n";
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const FrameTiming& frame = frames[i];
+        file << frame.frameNumber << ',' << ToMs(frame.intervalNs);
+        for (uint32_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) file << ',' << ToMs(frame.phaseNs[phase]);
+        file << '\n';
+    }
+
+    std::filesystem::path histogramPath = framesPath;
+    histogramPath.replace_filename(framesPath.stem().string() + "_histogram" + framesPath.extension().string());
+
+    std::ofstream histogram(histogramPath, std::ios::trunc);
+    if (!histogram)
+    {
+        OutputDebugStringA("[FrameStats] Failed to write histogram CSV\n");
+        return false;
+    }
+
+    histogram << "from_us,to_us,count\n";
+    for (uint32_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+    {
+        uint32_t value = m_Histogram[bucket].load(std::memory_order_relaxed);
+        if (value == 0) continue;
+        histogram << BucketLowerBound(bucket) << ',' << BucketLowerBound(bucket + 1) << ',' << value << '\n';
+    }
+
+    FrameStatsSummary summary = GetSummary();
+    char msg[256];
+    sprintf_s(msg, "[FrameStats] %u frames: avg %.2f ms (%.1f FPS), p99 %.2f ms, 1%% low %.1f FPS, 0.1%% low %.1f FPS\n",
+        summary.frameCount, summary.avgMs, summary.avgFps, summary.p99Ms,
+        summary.onePercentLowFps, summary.pointOnePercentLowFps);
+    OutputDebugStringA(msg);
+
+    return (bool)file && (bool)histogram;
+}
+
+} // namespace Vulkan
@@ -0,0 +1,189 @@
+#include "../include/platform.h"
+#include "../include/gpu_profiler.h"
+#include <algorithm>
+#include <vector>
+
+namespace Vulkan {
+
+GpuProfiler& GpuProfiler::GetInstance()
+{
+    static GpuProfiler instance;
+    return instance;
+}
+
+bool GpuProfiler::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t framesInFlight)
+{
+    if (m_bInitialized) return true;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = (queueFamily < queueFamilyCount) ? queueFamilies[queueFamily].timestampValidBits : 0;
+    if (validBits == 0)
+    {
+        OutputDebugStringA("[GpuProfiler] Queue family does not support timestamps, profiling disabled\n");
+        return false;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    m_Device = device;
+    m_FramesInFlight = framesInFlight;
+    m_TimestampPeriod = properties.limits.timestampPeriod;
+    m_TimestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = GPU_PASS_COUNT * 2;
+
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    {
+        if (vkCreateQueryPool(m_Device, &poolInfo, nullptr, &m_QueryPools[i]) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[GpuProfiler] Failed to create query pool\n");
+            m_bInitialized = true;
+            Shutdown();
+            return false;
+        }
+        m_WrittenPasses[i] = 0;
+    }
+
+    m_bInitialized = true;
+    return true;
+}
+
+void GpuProfiler::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    for (uint32_t pass = 0; pass < GPU_PASS_COUNT; pass++)
+    {
+        const GpuPassStats& stats = m_Stats[pass];
+        if (stats.sampleCount == 0) continue;
+
+        char msg[256];
+        sprintf_s(msg, "[GpuProfiler] %-14s min %.3f ms, avg %.3f ms, p99 %.3f ms\n",
+            GetPassName((GpuPass)pass), stats.minMs, stats.avgMs, stats.p99Ms);
+        OutputDebugStringA(msg);
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if (m_QueryPools[i]) vkDestroyQueryPool(m_Device, m_QueryPools[i], nullptr);
+        m_QueryPools[i] = VK_NULL_HANDLE;
+        m_WrittenPasses[i] = 0;
+    }
+
+    for (uint32_t pass = 0; pass < GPU_PASS_COUNT; pass++)
+    {
+        m_Stats[pass] = GpuPassStats();
+        m_HistoryHead[pass] = 0;
+    }
+
+    m_CommandBuffer = VK_NULL_HANDLE;
+    m_OpenPasses = 0;
+    m_bInitialized = false;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (!m_bInitialized) return;
+
+    CollectResults(frameIndex);
+
+    m_CommandBuffer = commandBuffer;
+    m_CurrentFrame = frameIndex;
+    m_WrittenPasses[frameIndex] = 0;
+    m_OpenPasses = 0;
+
+    vkCmdResetQueryPool(commandBuffer, m_QueryPools[frameIndex], 0, GPU_PASS_COUNT * 2);
+}
+
+void GpuProfiler::EndFrame()
+{
+    m_CommandBuffer = VK_NULL_HANDLE;
+}
+
+void GpuProfiler::BeginPass(GpuPass pass)
+{
+    uint32_t bit = 1u << pass;
+    if (!m_CommandBuffer || ((m_WrittenPasses[m_CurrentFrame] | m_OpenPasses) & bit)) return;
+
+    vkCmdWriteTimestamp(m_CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPools[m_CurrentFrame], pass * 2);
+    m_OpenPasses |= bit;
+}
+
+void GpuProfiler::EndPass(GpuPass pass)
+{
+    uint32_t bit = 1u << pass;
+    if (!m_CommandBuffer || !(m_OpenPasses & bit)) return;
+
+    vkCmdWriteTimestamp(m_CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPools[m_CurrentFrame], pass * 2 + 1);
+    m_OpenPasses &= ~bit;
+    m_WrittenPasses[m_CurrentFrame] |= bit;
+}
+
+const char* GpuProfiler::GetPassName(GpuPass pass)
+{
+    switch (pass)
+    {
+        case GPU_PASS_SCENE:         return "Scene";
+        case GPU_PASS_HARD_LIGHT:    return "HardLight";
+        case GPU_PASS_DESATURATION:  return "Desaturation";
+        case GPU_PASS_GLARE:         return "Glare";
+        case GPU_PASS_POST_FUSED:    return "PostFused";
+        case GPU_PASS_PRESENT_BLIT:  return "PresentBlit";
+        default:                     return "Unknown";
+    }
+}
+
+void GpuProfiler::CollectResults(uint32_t frameIndex)
+{
+    // The slot's fence has been waited on, so its queries are available;
+    // no WAIT flag, a pass that is somehow not ready is simply skipped.
+    uint32_t written = m_WrittenPasses[frameIndex];
+    for (uint32_t pass = 0; pass < GPU_PASS_COUNT; pass++)
+    {
+        if (!(written & (1u << pass))) continue;
+
+        uint64_t timestamps[2];
+        VkResult result = vkGetQueryPoolResults(m_Device, m_QueryPools[frameIndex], pass * 2, 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) continue;
+
+        uint64_t ticks = (timestamps[1] - timestamps[0]) & m_TimestampMask;
+        UpdateStats((GpuPass)pass, (float)(ticks * m_TimestampPeriod / 1000000.0));
+    }
+}
+
+void GpuProfiler::UpdateStats(GpuPass pass, float milliseconds)
+{
+    float* history = m_History[pass];
+    history[m_HistoryHead[pass]] = milliseconds;
+    m_HistoryHead[pass] = (m_HistoryHead[pass] + 1) % HISTORY_SIZE;
+
+    GpuPassStats& stats = m_Stats[pass];
+    if (stats.sampleCount < HISTORY_SIZE) stats.sampleCount++;
+    stats.lastMs = milliseconds;
+
+    float sorted[HISTORY_SIZE];
+    uint32_t count = stats.sampleCount;
+    std::copy(history, history + count, sorted);
+
+    // Samples fill from index 0, so the first sampleCount entries are valid.
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < count; i++) sum += sorted[i];
+
+    uint32_t p99Index = std::min(count - 1, (count * 99) / 100);
+    std::nth_element(sorted, sorted + p99Index, sorted + count);
+
+    stats.avgMs = sum / count;
+    stats.p99Ms = sorted[p99Index];
+    stats.minMs = *std::min_element(sorted, sorted + count);
+}
+
+} // namespace Vulkan
@@ -0,0 +1,209 @@
+#include "../include/matrix_math.h"
+
+#ifdef OFP_MATRIX_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace Math {
+
+namespace {
+
+const Matrix4 IDENTITY = {{
+    {1.0f, 0.0f, 0.0f, 0.0f},
+    {0.0f, 1.0f, 0.0f, 0.0f},
+    {0.0f, 0.0f, 1.0f, 0.0f},
+    {0.0f, 0.0f, 0.0f, 1.0f},
+}};
+
+#ifdef OFP_MATRIX_SIMD
+
+// (y, z, x, w)
+inline __m128 RotateLeft(__m128 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+// (z, x, y, w)
+inline __m128 RotateRight(__m128 v)
+{
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2));
+}
+
+inline __m128 Cross(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(RotateLeft(a), RotateRight(b)), _mm_mul_ps(RotateRight(a), RotateLeft(b)));
+}
+
+#endif // OFP_MATRIX_SIMD
+
+} // namespace
+
+void Identity(Matrix4& out)
+{
+    out = IDENTITY;
+}
+
+void MultiplyScalar(const Matrix4& a, const Matrix4& b, Matrix4& out)
+{
+    Matrix4 result;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            float sum = a.m[i][0] * b.m[0][j];
+            sum = sum + a.m[i][1] * b.m[1][j];
+            sum = sum + a.m[i][2] * b.m[2][j];
+            sum = sum + a.m[i][3] * b.m[3][j];
+            result.m[i][j] = sum;
+        }
+    }
+    out = result;
+}
+
+void TransposeScalar(const Matrix4& a, Matrix4& out)
+{
+    Matrix4 result;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++) result.m[i][j] = a.m[j][i];
+    }
+    out = result;
+}
+
+bool InverseTranspose3x3Scalar(const Matrix4& a, Matrix4& out)
+{
+    // The inverse-transpose is the cofactor matrix over the determinant,
+    // and row i of the cofactor matrix is the cross product of the other
+    // two rows.
+    const float (*r)[4] = a.m;
+    float c[3][3];
+    for (int i = 0; i < 3; i++)
+    {
+        const float* u = r[(i + 1) % 3];
+        const float* v = r[(i + 2) % 3];
+        c[i][0] = u[1] * v[2] - u[2] * v[1];
+        c[i][1] = u[2] * v[0] - u[0] * v[2];
+        c[i][2] = u[0] * v[1] - u[1] * v[0];
+    }
+
+    float det = r[0][0] * c[0][0];
+    det = det + r[0][1] * c[0][1];
+    det = det + r[0][2] * c[0][2];
+    if (det == 0.0f)
+    {
+        out = IDENTITY;
+        return false;
+    }
+
+    float invDet = 1.0f / det;
+    Matrix4 result = IDENTITY;
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++) result.m[i][j] = c[i][j] * invDet;
+    }
+    out = result;
+    return true;
+}
+
+#ifdef OFP_MATRIX_SIMD
+
+void Multiply(const Matrix4& a, const Matrix4& b, Matrix4& out)
+{
+    // Row i of the product is sum_k a[i][k] * row k of b. All of b is
+    // loaded first, so out may alias either input.
+    __m128 b0 = _mm_load_ps(b.m[0]);
+    __m128 b1 = _mm_load_ps(b.m[1]);
+    __m128 b2 = _mm_load_ps(b.m[2]);
+    __m128 b3 = _mm_load_ps(b.m[3]);
+
+    for (int i = 0; i < 4; i++)
+    {
+        __m128 row = _mm_load_ps(a.m[i]);
+        __m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+        _mm_store_ps(out.m[i], sum);
+    }
+}
+
+void Transpose(const Matrix4& a, Matrix4& out)
+{
+    __m128 r0 = _mm_load_ps(a.m[0]);
+    __m128 r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]);
+    __m128 r3 = _mm_load_ps(a.m[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(out.m[0], r0);
+    _mm_store_ps(out.m[1], r1);
+    _mm_store_ps(out.m[2], r2);
+    _mm_store_ps(out.m[3], r3);
+}
+
+bool InverseTranspose3x3(const Matrix4& a, Matrix4& out)
+{
+    __m128 r0 = _mm_load_ps(a.m[0]);
+    __m128 r1 = _mm_load_ps(a.m[1]);
+    __m128 r2 = _mm_load_ps(a.m[2]);
+
+    __m128 c0 = Cross(r1, r2);
+    __m128 c1 = Cross(r2, r0);
+    __m128 c2 = Cross(r0, r1);
+
+    // Summed in the scalar version's order
+    __m128 products = _mm_mul_ps(r0, c0);
+    float det = _mm_cvtss_f32(products);
+    det = det + _mm_cvtss_f32(_mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 1, 1, 1)));
+    det = det + _mm_cvtss_f32(_mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 2, 2, 2)));
+    if (det == 0.0f)
+    {
+        out = IDENTITY;
+        return false;
+    }
+
+    // Clear w, which the cross products leave as w * w - w * w
+    const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    __m128 invDet = _mm_set1_ps(1.0f / det);
+    _mm_store_ps(out.m[0], _mm_and_ps(_mm_mul_ps(c0, invDet), xyz));
+    _mm_store_ps(out.m[1], _mm_and_ps(_mm_mul_ps(c1, invDet), xyz));
+    _mm_store_ps(out.m[2], _mm_and_ps(_mm_mul_ps(c2, invDet), xyz));
+    _mm_store_ps(out.m[3], _mm_load_ps(IDENTITY.m[3]));
+    return true;
+}
+
+const char* GetMatrixImplementationName()
+{
+    return "SSE";
+}
+
+#else
+
+void Multiply(const Matrix4& a, const Matrix4& b, Matrix4& out)
+{
+    MultiplyScalar(a, b, out);
+}
+
+void Transpose(const Matrix4& a, Matrix4& out)
+{
+    TransposeScalar(a, out);
+}
+
+bool InverseTranspose3x3(const Matrix4& a, Matrix4& out)
+{
+    return InverseTranspose3x3Scalar(a, out);
+}
+
+const char* GetMatrixImplementationName()
+{
+    return "Scalar";
+}
+
+#endif // OFP_MATRIX_SIMD
+
+void ClipSpaceFixup(Matrix4& out)
+{
+    out = IDENTITY;
+    out.m[1][1] = -1.0f;
+}
+
+} // namespace Math
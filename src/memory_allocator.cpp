@@ -0,0 +1,410 @@
+#include "../include/platform.h"
+#include "../include/memory_allocator.h"
+
+namespace {
+
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+VkDeviceSize NextPowerOfTwo(VkDeviceSize value)
+{
+    VkDeviceSize result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+uint32_t Log2(VkDeviceSize value)
+{
+    uint32_t result = 0;
+    while (value > 1) { value >>= 1; result++; }
+    return result;
+}
+
+} // namespace
+
+namespace Vulkan {
+
+// ---------------------------------------------------------------------------
+// MemoryBlock
+// ---------------------------------------------------------------------------
+
+MemoryBlock::MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, bool linear, void* mapped)
+    : m_Memory(memory)
+    , m_Size(size)
+    , m_MemoryTypeIndex(memoryTypeIndex)
+    , m_Linear(linear)
+    , m_Mapped(static_cast<uint8_t*>(mapped))
+{
+    m_FreeLists.resize(Log2(m_Size / MIN_ALLOCATION) + 1);
+    m_FreeLists[0].insert(0);
+}
+
+bool MemoryBlock::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& level)
+{
+    // Buddy ranges are aligned to their own size, so rounding the request up
+    // to the alignment satisfies any power-of-two alignment.
+    VkDeviceSize needed = NextPowerOfTwo(size > alignment ? size : alignment);
+    if (needed < MIN_ALLOCATION) needed = MIN_ALLOCATION;
+    if (needed > m_Size) return false;
+
+    uint32_t target = Log2(m_Size / needed);
+
+    int found = -1;
+    for (int i = (int)target; i >= 0; i--)
+    {
+        if (!m_FreeLists[i].empty())
+        {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) return false;
+
+    auto it = m_FreeLists[found].begin();
+    offset = *it;
+    m_FreeLists[found].erase(it);
+
+    // Split down to the target level, keeping the lower half each time.
+    for (uint32_t i = (uint32_t)found; i < target; i++)
+    {
+        m_FreeLists[i + 1].insert(offset + LevelSize(i + 1));
+    }
+
+    level = target;
+    m_Used += LevelSize(target);
+    return true;
+}
+
+void MemoryBlock::Free(VkDeviceSize offset, uint32_t level)
+{
+    m_Used -= LevelSize(level);
+
+    while (level > 0)
+    {
+        VkDeviceSize buddy = offset ^ LevelSize(level);
+        auto it = m_FreeLists[level].find(buddy);
+        if (it == m_FreeLists[level].end()) break;
+
+        m_FreeLists[level].erase(it);
+        if (buddy < offset) offset = buddy;
+        level--;
+    }
+
+    m_FreeLists[level].insert(offset);
+}
+
+VkDeviceSize MemoryBlock::LargestFreeRange() const
+{
+    for (uint32_t i = 0; i < m_FreeLists.size(); i++)
+    {
+        if (!m_FreeLists[i].empty()) return LevelSize(i);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// MemoryAllocator
+// ---------------------------------------------------------------------------
+
+MemoryAllocator& MemoryAllocator::GetInstance()
+{
+    static MemoryAllocator instance;
+    return instance;
+}
+
+bool MemoryAllocator::Initialize(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &m_MemoryProperties);
+
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        m_DedicatedCount[i] = 0;
+        m_DedicatedBytes[i] = 0;
+    }
+
+    m_bInitialized = true;
+    return true;
+}
+
+void MemoryAllocator::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    LogSummary();
+
+    for (auto& block : m_Blocks)
+    {
+        if (!block->IsEmpty())
+        {
+            OutputDebugStringA("[MemoryAllocator] Releasing block with live allocations\n");
+        }
+        if (block->GetMapped()) vkUnmapMemory(m_Device, block->GetMemory());
+        vkFreeMemory(m_Device, block->GetMemory(), nullptr);
+    }
+    m_Blocks.clear();
+
+    m_bInitialized = false;
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const
+{
+    if (preferred)
+    {
+        for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+        {
+            VkMemoryPropertyFlags flags = m_MemoryProperties.memoryTypes[i].propertyFlags;
+            if ((typeFilter & (1u << i)) && (flags & (required | preferred)) == (required | preferred))
+            {
+                return i;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1u << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & required) == required)
+        {
+            return i;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+bool MemoryAllocator::AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, uint32_t flags, Allocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_Device, image, &requirements);
+
+    if (!Allocate(requirements, properties, 0, flags, false, allocation)) return false;
+
+    if (vkBindImageMemory(m_Device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[MemoryAllocator] Failed to bind image memory\n");
+        Free(allocation);
+        return false;
+    }
+
+    return true;
+}
+
+bool MemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, uint32_t flags, Allocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_Device, buffer, &requirements);
+
+    if (!Allocate(requirements, properties, 0, flags, true, allocation)) return false;
+
+    if (vkBindBufferMemory(m_Device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[MemoryAllocator] Failed to bind buffer memory\n");
+        Free(allocation);
+        return false;
+    }
+
+    return true;
+}
+
+bool MemoryAllocator::AllocateImageMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, uint32_t flags, Allocation& allocation)
+{
+    return Allocate(requirements, required, preferred, flags, false, allocation);
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE) return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (allocation.block)
+    {
+        allocation.block->Free(allocation.offset, allocation.level);
+    }
+    else
+    {
+        if (allocation.mapped) vkUnmapMemory(m_Device, allocation.memory);
+        vkFreeMemory(m_Device, allocation.memory, nullptr);
+        m_DedicatedCount[allocation.memoryTypeIndex]--;
+        m_DedicatedBytes[allocation.memoryTypeIndex] -= allocation.size;
+    }
+
+    allocation = Allocation();
+}
+
+bool MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, uint32_t flags, bool linear, Allocation& allocation)
+{
+    uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+    if (memoryTypeIndex == UINT32_MAX)
+    {
+        OutputDebugStringA("[MemoryAllocator] No suitable memory type\n");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    VkDeviceSize blockSize = GetBlockSize(memoryTypeIndex);
+    if ((flags & ALLOCATION_DEDICATED) || requirements.size > blockSize / 2)
+    {
+        return AllocateDedicated(requirements, memoryTypeIndex, flags, allocation);
+    }
+
+    for (auto& block : m_Blocks)
+    {
+        if (block->GetMemoryTypeIndex() != memoryTypeIndex || block->IsLinear() != linear) continue;
+
+        VkDeviceSize offset;
+        uint32_t level;
+        if (block->Allocate(requirements.size, requirements.alignment, offset, level))
+        {
+            allocation.memory = block->GetMemory();
+            allocation.offset = offset;
+            allocation.size = requirements.size;
+            allocation.mapped = block->GetMapped() ? block->GetMapped() + offset : nullptr;
+            allocation.memoryTypeIndex = memoryTypeIndex;
+            allocation.block = block.get();
+            allocation.level = level;
+            return true;
+        }
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = blockSize;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[MemoryAllocator] Failed to allocate memory block\n");
+        return false;
+    }
+
+    // Host-visible blocks are mapped once for their whole lifetime.
+    void* mapped = nullptr;
+    if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    }
+
+    m_Blocks.push_back(std::make_unique<MemoryBlock>(memory, blockSize, memoryTypeIndex, linear, mapped));
+    MemoryBlock* block = m_Blocks.back().get();
+
+    VkDeviceSize offset;
+    uint32_t level;
+    block->Allocate(requirements.size, requirements.alignment, offset, level);
+
+    allocation.memory = memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mapped = mapped ? block->GetMapped() + offset : nullptr;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = block;
+    allocation.level = level;
+    return true;
+}
+
+bool MemoryAllocator::AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, uint32_t flags, Allocation& allocation)
+{
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[MemoryAllocator] Failed to allocate dedicated memory\n");
+        return false;
+    }
+
+    void* mapped = nullptr;
+    if (flags & ALLOCATION_MAPPED)
+    {
+        vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    }
+
+    allocation.memory = memory;
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.mapped = mapped;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.block = nullptr;
+    allocation.level = 0;
+
+    m_DedicatedCount[memoryTypeIndex]++;
+    m_DedicatedBytes[memoryTypeIndex] += requirements.size;
+    return true;
+}
+
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const
+{
+    // Small heaps (e.g. the 256 MB BAR window) get proportionally smaller blocks.
+    uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[heapIndex].size;
+
+    VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+    while (blockSize > MemoryBlock::MIN_ALLOCATION * 64 && blockSize > heapSize / 8) blockSize >>= 1;
+    return blockSize;
+}
+
+void MemoryAllocator::GetHeapSummaries(std::vector<MemoryHeapSummary>& summaries)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    summaries.assign(m_MemoryProperties.memoryHeapCount, MemoryHeapSummary());
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+    {
+        summaries[i].budget = m_MemoryProperties.memoryHeaps[i].size;
+    }
+
+    for (const auto& block : m_Blocks)
+    {
+        MemoryHeapSummary& summary = summaries[m_MemoryProperties.memoryTypes[block->GetMemoryTypeIndex()].heapIndex];
+        summary.reserved += block->GetSize();
+        summary.used += block->GetUsed();
+        summary.blockCount++;
+
+        VkDeviceSize largest = block->LargestFreeRange();
+        if (largest > summary.largestFreeRange) summary.largestFreeRange = largest;
+    }
+
+    for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+    {
+        MemoryHeapSummary& summary = summaries[m_MemoryProperties.memoryTypes[i].heapIndex];
+        summary.reserved += m_DedicatedBytes[i];
+        summary.used += m_DedicatedBytes[i];
+        summary.dedicatedCount += m_DedicatedCount[i];
+    }
+
+    for (MemoryHeapSummary& summary : summaries)
+    {
+        summary.allocationCount = summary.blockCount + summary.dedicatedCount;
+    }
+}
+
+void MemoryAllocator::LogSummary()
+{
+    std::vector<MemoryHeapSummary> summaries;
+    GetHeapSummaries(summaries);
+
+    for (size_t i = 0; i < summaries.size(); i++)
+    {
+        const MemoryHeapSummary& summary = summaries[i];
+        if (summary.allocationCount == 0) continue;
+
+        char msg[256];
+        sprintf_s(msg, "[MemoryAllocator] Heap %zu: %llu/%llu MB used/reserved of %llu MB, %u blocks, %u dedicated, fragmentation %.0f%%\n",
+            i,
+            (unsigned long long)(summary.used >> 20),
+            (unsigned long long)(summary.reserved >> 20),
+            (unsigned long long)(summary.budget >> 20),
+            summary.blockCount, summary.dedicatedCount,
+            summary.Fragmentation() * 100.0f);
+        OutputDebugStringA(msg);
+    }
+}
+
+} // namespace Vulkan
@@ -0,0 +1,219 @@
+#include "../include/platform.h"
+#include "../include/pipeline_cache.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+const uint32_t PIPELINE_CACHE_MAGIC = 0x4350464F; // "OFPC"
+const uint32_t PIPELINE_CACHE_VERSION = 1;
+const uint64_t PIPELINE_CACHE_MAX_SIZE = 256ull * 1024 * 1024;
+
+uint32_t Checksum(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+Vulkan::PipelineCache& Vulkan::PipelineCache::GetInstance()
+{
+    static PipelineCache instance;
+    return instance;
+}
+
+bool Vulkan::PipelineCache::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::wstring& filename)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    m_Filename = filename;
+    m_PipelineCount = 0;
+    m_CreateMilliseconds = 0.0;
+    vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_Properties);
+
+    std::string blob;
+    m_bWarm = LoadFromDisk(blob);
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = m_bWarm ? blob.size() : 0;
+    createInfo.pInitialData = m_bWarm ? blob.data() : nullptr;
+
+    if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_Cache) != VK_SUCCESS)
+    {
+        // The driver may still reject data that passed our header checks.
+        m_bWarm = false;
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_Cache) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[PipelineCache] Failed to create pipeline cache\n");
+            return false;
+        }
+    }
+
+    char msg[256];
+    sprintf_s(msg, "[PipelineCache] %s cache (%zu bytes)\n", m_bWarm ? "Loaded warm" : "Starting cold", m_bWarm ? blob.size() : (size_t)0);
+    OutputDebugStringA(msg);
+
+    m_bInitialized = true;
+    return true;
+}
+
+void Vulkan::PipelineCache::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    char msg[256];
+    sprintf_s(msg, "[PipelineCache] %u pipelines created in %.2f ms (%s cache)\n",
+        m_PipelineCount, m_CreateMilliseconds, m_bWarm ? "warm" : "cold");
+    OutputDebugStringA(msg);
+
+    Save();
+
+    vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+    m_Cache = VK_NULL_HANDLE;
+
+    m_bInitialized = false;
+}
+
+bool Vulkan::PipelineCache::Save()
+{
+    if (m_Cache == VK_NULL_HANDLE || m_Filename.empty()) return false;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    {
+        return false;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_Device, m_Cache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[PipelineCache] Failed to read pipeline cache data\n");
+        return false;
+    }
+
+    PipelineCacheFileHeader header;
+    FillHeader(header);
+    header.dataSize = dataSize;
+    header.dataChecksum = Checksum(data.data(), dataSize);
+
+    std::filesystem::path path(m_Filename);
+    std::filesystem::path tempPath = path;
+    tempPath += L".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            OutputDebugStringA("[PipelineCache] Failed to open pipeline cache for writing\n");
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), (std::streamsize)dataSize);
+        file.flush();
+        if (!file)
+        {
+            OutputDebugStringA("[PipelineCache] Failed to write pipeline cache\n");
+            file.close();
+            std::error_code ignored;
+            std::filesystem::remove(tempPath, ignored);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        OutputDebugStringA("[PipelineCache] Failed to replace pipeline cache file\n");
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+VkResult Vulkan::PipelineCache::CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines)
+{
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = vkCreateGraphicsPipelines(m_Device, m_Cache, count, createInfos, nullptr, pipelines);
+    m_CreateMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (result == VK_SUCCESS) m_PipelineCount += count;
+    return result;
+}
+
+VkResult Vulkan::PipelineCache::CreateComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* createInfos, VkPipeline* pipelines)
+{
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = vkCreateComputePipelines(m_Device, m_Cache, count, createInfos, nullptr, pipelines);
+    m_CreateMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (result == VK_SUCCESS) m_PipelineCount += count;
+    return result;
+}
+
+bool Vulkan::PipelineCache::LoadFromDisk(std::string& blob)
+{
+    std::ifstream file(std::filesystem::path(m_Filename), std::ios::binary);
+    if (!file) return false;
+
+    PipelineCacheFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        OutputDebugStringA("[PipelineCache] Ignoring truncated pipeline cache\n");
+        return false;
+    }
+
+    PipelineCacheFileHeader expected;
+    FillHeader(expected);
+
+    if (header.magic != expected.magic ||
+        header.version != expected.version ||
+        header.vendorID != expected.vendorID ||
+        header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) != 0 ||
+        header.dataSize > PIPELINE_CACHE_MAX_SIZE)
+    {
+        OutputDebugStringA("[PipelineCache] Ignoring pipeline cache from a different device or driver\n");
+        return false;
+    }
+
+    blob.resize((size_t)header.dataSize);
+    if (!file.read(&blob[0], (std::streamsize)header.dataSize) ||
+        Checksum(blob.data(), blob.size()) != header.dataChecksum)
+    {
+        OutputDebugStringA("[PipelineCache] Ignoring corrupt pipeline cache\n");
+        blob.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void Vulkan::PipelineCache::FillHeader(PipelineCacheFileHeader& header) const
+{
+    memset(&header, 0, sizeof(header));
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendorID = m_Properties.vendorID;
+    header.deviceID = m_Properties.deviceID;
+    header.driverVersion = m_Properties.driverVersion;
+    memcpy(header.uuid, m_Properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
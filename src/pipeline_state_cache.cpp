@@ -0,0 +1,67 @@
+#include "../include/pipeline_state_cache.h"
+
+namespace Bridge {
+
+void PipelineStateCache::Insert(const PipelineKey& key, VkPipeline pipeline)
+{
+    if ((m_Stats.pipelineCount + 1) * 2 > m_Stats.capacity)
+    {
+        Grow();
+    }
+
+    uint32_t index = (uint32_t)key.Hash() & m_Mask;
+    while (m_Entries[index].pipeline != VK_NULL_HANDLE)
+    {
+        if (m_Entries[index].key == key)
+        {
+            m_Entries[index].pipeline = pipeline;
+            return;
+        }
+        index = (index + 1) & m_Mask;
+    }
+
+    m_Entries[index].key = key;
+    m_Entries[index].pipeline = pipeline;
+    m_Stats.pipelineCount++;
+}
+
+void PipelineStateCache::Clear(std::vector<VkPipeline>& pipelines)
+{
+    for (const Entry& entry : m_Entries)
+    {
+        if (entry.pipeline != VK_NULL_HANDLE) pipelines.push_back(entry.pipeline);
+    }
+
+    Reset(m_Stats.capacity);
+}
+
+void PipelineStateCache::GetKeys(std::vector<PipelineKey>& keys) const
+{
+    for (const Entry& entry : m_Entries)
+    {
+        if (entry.pipeline != VK_NULL_HANDLE) keys.push_back(entry.key);
+    }
+}
+
+void PipelineStateCache::Reset(uint32_t capacity)
+{
+    m_Entries.assign(capacity, Entry());
+    m_Mask = capacity - 1;
+    m_Stats.pipelineCount = 0;
+    m_Stats.capacity = capacity;
+}
+
+void PipelineStateCache::Grow()
+{
+    std::vector<Entry> old;
+    old.swap(m_Entries);
+
+    Reset(m_Stats.capacity * 2);
+
+    for (const Entry& entry : old)
+    {
+        if (entry.pipeline != VK_NULL_HANDLE) Insert(entry.key, entry.pipeline);
+    }
+}
+
+} // namespace Bridge
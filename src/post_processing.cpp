@@ -1,9 +1,42 @@
 #include "post_processing.h"
-#include <iostream>
-#include <stdexcept>
+#include "gpu_profiler.h"
+#include "deletion_queue.h"
+#include "dynamic_rendering.h"
+#include "frame_scheduler.h"
+#include "pipeline_cache.h"
+#include "config.h"
+#include "embedded_shaders.h"
+#include <cstring>
 
 namespace PostProcessing {
 
+namespace {
+
+const VkFormat TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+const uint32_t ORDER_EMPTY = 0xFFF;
+
+} // namespace
+
+bool LoadShaderModule(VkDevice device, const char* name, VkShaderModule& module)
+{
+    for (const Shaders::EmbeddedShader& shader : Shaders::EMBEDDED_SHADERS)
+    {
+        if (strcmp(shader.name, name) != 0) continue;
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = shader.size;
+        createInfo.pCode = shader.code;
+
+        return vkCreateShaderModule(device, &createInfo, nullptr, &module) == VK_SUCCESS;
+    }
+
+    char msg[256];
+    sprintf_s(msg, "[PostProcessing] Shader %s is not embedded\n", name);
+    OutputDebugStringA(msg);
+    return false;
+}
+
 PostProcessor& PostProcessor::GetInstance()
 {
     static PostProcessor instance;
@@ -21,15 +54,43 @@ bool PostProcessor::Initialize(VkDevice device, VkPhysicalDevice physicalDevice,
 
     OutputDebugStringA("[PostProcessing] Initializing...\n");
 
+    const Config::EffectSettings& effects = Config::ConfigManager::GetInstance().GetEffects();
+    m_HardLight.enabled = effects.enablePostProcessing && effects.enableHardLight;
+    m_Desaturate.enabled = effects.enablePostProcessing && effects.enableDesaturate;
+    m_Glare.enabled = effects.enablePostProcessing && effects.enableGlare;
+    m_bFused = effects.fusedPostProcessing;
+    m_bDynamicRendering = Vulkan::DynamicRendering::GetInstance().IsEnabled();
+    m_bSynchronization2 = Vulkan::FrameScheduler::GetInstance().IsEnabled();
+
+    if (!CreateSamplers())
+    {
+        OutputDebugStringA("[PostProcessing] Failed to create samplers\n");
+        return false;
+    }
+
+    m_Targets.Initialize(m_Device);
+
+    if (!m_Bloom.Initialize(m_Device, m_Sampler))
+    {
+        OutputDebugStringA("[PostProcessing] Failed to create bloom pipelines\n");
+        return false;
+    }
+
+    if (!CreateRenderPass() || !CreateDescriptors())
+    {
+        OutputDebugStringA("[PostProcessing] Failed to create render pass\n");
+        return false;
+    }
+
     if (!CreateRenderTargets(width, height))
     {
         OutputDebugStringA("[PostProcessing] Failed to create render targets\n");
         return false;
     }
 
-    if (!CreateSamplers())
+    if (!CreateShaders() || !CreatePipelineLayout())
     {
-        OutputDebugStringA("[PostProcessing] Failed to create samplers\n");
+        OutputDebugStringA("[PostProcessing] Failed to create pipeline resources\n");
         return false;
     }
 
@@ -40,31 +101,36 @@ bool PostProcessor::Initialize(VkDevice device, VkPhysicalDevice physicalDevice,
 
 void PostProcessor::Shutdown()
 {
-    if (!m_Initialized) return;
+    if (!m_Device) return;
 
     vkDeviceWaitIdle(m_Device);
 
-    if (m_CopyPipeline) vkDestroyPipeline(m_Device, m_CopyPipeline, nullptr);
-    if (m_GlarePipeline) vkDestroyPipeline(m_Device, m_GlarePipeline, nullptr);
-    if (m_DesaturatePipeline) vkDestroyPipeline(m_Device, m_DesaturatePipeline, nullptr);
-    if (m_HardLightPipeline) vkDestroyPipeline(m_Device, m_HardLightPipeline, nullptr);
+    for (uint32_t i = 0; i < m_PermutationCount; i++)
+    {
+        vkDestroyPipeline(m_Device, m_Permutations[i].pipeline, nullptr);
+        m_Permutations[i] = Permutation();
+    }
+    m_PermutationCount = 0;
+
     if (m_PipelineLayout) vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+    if (m_UberShader) vkDestroyShaderModule(m_Device, m_UberShader, nullptr);
+    if (m_FullscreenShader) vkDestroyShaderModule(m_Device, m_FullscreenShader, nullptr);
+    m_PipelineLayout = VK_NULL_HANDLE;
+    m_UberShader = VK_NULL_HANDLE;
+    m_FullscreenShader = VK_NULL_HANDLE;
 
-    if (m_CopyShader) vkDestroyShaderModule(m_Device, m_CopyShader, nullptr);
-    if (m_GlareShader) vkDestroyShaderModule(m_Device, m_GlareShader, nullptr);
-    if (m_DesaturateShader) vkDestroyShaderModule(m_Device, m_DesaturateShader, nullptr);
-    if (m_HardLightShader) vkDestroyShaderModule(m_Device, m_HardLightShader, nullptr);
+    CleanupRenderTargets();
+    m_Bloom.Shutdown();
+    Vulkan::DeletionQueue::GetInstance().Flush();
 
+    if (m_DescriptorSetLayout) vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
+    if (m_RenderPass) vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
     if (m_Sampler) vkDestroySampler(m_Device, m_Sampler, nullptr);
+    m_DescriptorSetLayout = VK_NULL_HANDLE;
+    m_RenderPass = VK_NULL_HANDLE;
+    m_Sampler = VK_NULL_HANDLE;
 
-    if (m_OutputImageView) vkDestroyImageView(m_Device, m_OutputImageView, nullptr);
-    if (m_OutputImageMemory) vkFreeMemory(m_Device, m_OutputImageMemory, nullptr);
-    if (m_OutputImage) vkDestroyImage(m_Device, m_OutputImage, nullptr);
-
-    if (m_IntermediateImageView) vkDestroyImageView(m_Device, m_IntermediateImageView, nullptr);
-    if (m_IntermediateImageMemory) vkFreeMemory(m_Device, m_IntermediateImageMemory, nullptr);
-    if (m_IntermediateImage) vkDestroyImage(m_Device, m_IntermediateImage, nullptr);
-
+    m_Device = VK_NULL_HANDLE;
     m_Initialized = false;
     OutputDebugStringA("[PostProcessing] Shutdown complete\n");
 }
@@ -76,17 +142,55 @@ void PostProcessor::Resize(UINT width, UINT height)
     m_Width = width;
     m_Height = height;
 
-    vkDeviceWaitIdle(m_Device);
-
+    // Frames in flight keep sampling the old targets; CleanupRenderTargets()
+    // hands them to the deletion queue instead of waiting for the device.
+    // Viewport and scissor are dynamic, so the cached pipelines stay valid.
     CreateRenderTargets(width, height);
 }
 
-void PostProcessor::BeginPostProcessing()
+void PostProcessor::SetFused(bool fused)
+{
+    if (fused == m_bFused) return;
+    m_bFused = fused;
+
+    if (m_Initialized) CreateRenderTargets(m_Width, m_Height);
+}
+
+void PostProcessor::BeginPostProcessing(VkCommandBuffer commandBuffer)
 {
+    if (!m_Initialized) return;
+
+    m_CommandBuffer = commandBuffer;
+    m_FrameMask = 0;
+    m_FrameOrder = ORDER_EMPTY;
+    m_FrameEffectCount = 0;
+    m_CurrentTarget = 0;
 }
 
 void PostProcessor::EndPostProcessing()
 {
+    if (!m_Initialized || !m_CommandBuffer) return;
+
+    if (m_bFused)
+    {
+        // The whole chain: one read of the scene, one write of the output.
+        if (m_FrameMask & (1u << EFFECT_GLARE))
+        {
+            Vulkan::GpuScope scope(Vulkan::GPU_PASS_GLARE);
+            m_Bloom.Record(m_CommandBuffer, m_CurrentTarget, (uint32_t)m_PushConstants.glareSize);
+        }
+
+        Vulkan::GpuScope scope(Vulkan::GPU_PASS_POST_FUSED);
+        RenderQuad(GetPermutation(m_FrameMask, m_FrameOrder));
+    }
+    else if (m_CurrentTarget != 1)
+    {
+        // Final copy of the processed image into the output target.
+        Vulkan::GpuScope scope(Vulkan::GPU_PASS_PRESENT_BLIT);
+        RenderQuad(GetPermutation(0, ORDER_EMPTY));
+    }
+
+    m_CommandBuffer = VK_NULL_HANDLE;
 }
 
 void PostProcessor::ApplyHardLight(float strengthR, float strengthG, float strengthB)
@@ -97,7 +201,11 @@ void PostProcessor::ApplyHardLight(float strengthR, float strengthG, float stren
     m_HardLight.param0 = strengthG;
     m_HardLight.param1 = strengthB;
 
-    RenderQuad();
+    m_PushConstants.hardLight[0] = strengthR;
+    m_PushConstants.hardLight[1] = strengthG;
+    m_PushConstants.hardLight[2] = strengthB;
+
+    RunEffect(EFFECT_HARD_LIGHT);
 }
 
 void PostProcessor::ApplyDesaturation(float strength)
@@ -105,7 +213,9 @@ void PostProcessor::ApplyDesaturation(float strength)
     if (!m_Initialized || !m_Desaturate.enabled) return;
 
     m_Desaturate.strength = strength;
-    RenderQuad();
+    m_PushConstants.desaturation = strength;
+
+    RunEffect(EFFECT_DESATURATE);
 }
 
 void PostProcessor::ApplyGlare(float strength, int size, bool darkenSky)
@@ -116,122 +226,501 @@ void PostProcessor::ApplyGlare(float strength, int size, bool darkenSky)
     m_Glare.param0 = static_cast<float>(size);
     m_Glare.param1 = darkenSky ? 1.0f : 0.0f;
 
-    RenderQuad();
+    m_PushConstants.glareStrength = strength;
+    m_PushConstants.glareSize = (float)m_Bloom.ClampLevels(size);
+    m_PushConstants.glareDarkenSky = m_Glare.param1;
+
+    RunEffect(EFFECT_GLARE);
 }
 
-bool PostProcessor::CreateRenderTargets(UINT width, UINT height)
+void PostProcessor::RunEffect(EffectId effect)
 {
-    CleanupRenderTargets();
+    if (!m_CommandBuffer) return;
 
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-    imageInfo.extent = {width, height, 1};
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-    VkMemoryRequirements memReq{};
-    if (m_IntermediateImage != VK_NULL_HANDLE)
+    uint32_t bit = 1u << effect;
+
+    if (m_bFused)
     {
-        vkGetImageMemoryRequirements(m_Device, m_IntermediateImage, &memReq);
+        // Only record the effect; EndPostProcessing() draws the chain.
+        if ((m_FrameMask & bit) || m_FrameEffectCount >= EFFECT_COUNT) return;
+
+        uint32_t shift = 4 * m_FrameEffectCount++;
+        m_FrameMask |= bit;
+        m_FrameOrder = (m_FrameOrder & ~(0xFu << shift)) | (effect << shift);
+        return;
     }
 
-    VkMemoryAllocateInfo memInfo{};
-    memInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memInfo.allocationSize = memReq.size;
+    // GpuPass lists the effects in EffectId order.
+    Vulkan::GpuScope scope(static_cast<Vulkan::GpuPass>(Vulkan::GPU_PASS_HARD_LIGHT + effect));
+    if (effect == EFFECT_GLARE)
+    {
+        m_Bloom.Record(m_CommandBuffer, m_CurrentTarget, (uint32_t)m_PushConstants.glareSize);
+    }
+    RenderQuad(GetPermutation(bit, (ORDER_EMPTY & ~0xFu) | effect));
+}
 
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
-    memInfo.memoryTypeIndex = FindMemoryType(memProperties, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+VkPipeline PostProcessor::GetPermutation(uint32_t mask, uint32_t order)
+{
+    uint32_t key = mask | (order << 8);
+    for (uint32_t i = 0; i < m_PermutationCount; i++)
+    {
+        if (m_Permutations[i].key == key) return m_Permutations[i].pipeline;
+    }
+
+    // Masks and orders are canonical (only enabled effects, in call
+    // order), so there are at most MAX_PERMUTATIONS distinct keys.
+    if (m_PermutationCount >= MAX_PERMUTATIONS) return VK_NULL_HANDLE;
+
+    VkPipeline pipeline = CreatePermutation(mask, order);
+    if (pipeline == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+
+    m_Permutations[m_PermutationCount].key = key;
+    m_Permutations[m_PermutationCount].pipeline = pipeline;
+    m_PermutationCount++;
+
+    char msg[128];
+    sprintf_s(msg, "[PostProcessing] Built permutation mask 0x%X order 0x%03X (%u cached)\n", mask, order, m_PermutationCount);
+    OutputDebugStringA(msg);
+
+    return pipeline;
+}
 
-    if (vkCreateImage(m_Device, &imageInfo, nullptr, &m_IntermediateImage) != VK_SUCCESS)
+VkPipeline PostProcessor::CreatePermutation(uint32_t mask, uint32_t order)
+{
+    const uint32_t constants[2] = {mask, order};
+    VkSpecializationMapEntry entries[2] = {};
+    entries[0] = {0, 0, sizeof(uint32_t)};
+    entries[1] = {1, sizeof(uint32_t), sizeof(uint32_t)};
+
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = 2;
+    specialization.pMapEntries = entries;
+    specialization.dataSize = sizeof(constants);
+    specialization.pData = constants;
+
+    VkPipelineShaderStageCreateInfo stages[2] = {};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = m_FullscreenShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = m_UberShader;
+    stages[1].pName = "main";
+    stages[1].pSpecializationInfo = &specialization;
+
+    // Positions come from gl_VertexIndex; there is no vertex input.
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                     VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &blendAttachment;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_PipelineLayout;
+    pipelineInfo.renderPass = m_RenderPass;
+    pipelineInfo.subpass = 0;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &TARGET_FORMAT;
+    if (m_bDynamicRendering) pipelineInfo.pNext = &renderingInfo;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (Vulkan::PipelineCache::GetInstance().CreateGraphicsPipelines(1, &pipelineInfo, &pipeline) != VK_SUCCESS)
     {
-        OutputDebugStringA("[PostProcessing] Failed to create intermediate image\n");
-        return false;
+        OutputDebugStringA("[PostProcessing] Failed to create effect pipeline\n");
+        return VK_NULL_HANDLE;
     }
 
-    if (vkAllocateMemory(m_Device, &memInfo, nullptr, &m_IntermediateImageMemory) != VK_SUCCESS)
+    return pipeline;
+}
+
+void PostProcessor::RenderQuad(VkPipeline pipeline)
+{
+    if (!m_CommandBuffer || pipeline == VK_NULL_HANDLE) return;
+
+    uint32_t source = m_CurrentTarget;
+    uint32_t target = 1 - source;
+    VkImage targetImage = target ? m_OutputImage : m_IntermediateImage;
+    VkImageView targetView = target ? m_OutputImageView : m_IntermediateImageView;
+
+    VkViewport viewport = {0.0f, 0.0f, (float)m_Width, (float)m_Height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, {m_Width, m_Height}};
+
+    if (m_bDynamicRendering && m_bSynchronization2)
     {
-        OutputDebugStringA("[PostProcessing] Failed to allocate intermediate image memory\n");
-        return false;
+        // As below, but each barrier waits only for its own hazard: this
+        // pass's fragment shaders wait for the source's writes, and its
+        // color writes for the earlier reads and writes of the target.
+        VkMemoryBarrier2 sourceBarrier{};
+        sourceBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        sourceBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        sourceBarrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        sourceBarrier.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        sourceBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+
+        VkImageMemoryBarrier2 targetBarrier{};
+        targetBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        targetBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                     VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        targetBarrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        targetBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        targetBarrier.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+        targetBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        targetBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        targetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        targetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        targetBarrier.image = targetImage;
+        targetBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        VkDependencyInfo dependency{};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.memoryBarrierCount = 1;
+        dependency.pMemoryBarriers = &sourceBarrier;
+        dependency.imageMemoryBarrierCount = 1;
+        dependency.pImageMemoryBarriers = &targetBarrier;
+        Vulkan::FrameScheduler::GetInstance().Barrier(m_CommandBuffer, dependency);
+
+        Vulkan::DynamicRendering::GetInstance().Begin(m_CommandBuffer, targetView, {m_Width, m_Height}, nullptr, 0);
+    }
+    else if (m_bDynamicRendering)
+    {
+        // What the render pass's incoming dependency and initial layout
+        // did: the source's writes become visible to this pass, and the
+        // target is discarded once earlier passes are done with it.
+        VkMemoryBarrier sourceBarrier{};
+        sourceBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        sourceBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        sourceBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        VkImageMemoryBarrier targetBarrier{};
+        targetBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        targetBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        targetBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        targetBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        targetBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        targetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        targetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        targetBarrier.image = targetImage;
+        targetBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        vkCmdPipelineBarrier(m_CommandBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            0, 1, &sourceBarrier, 0, nullptr, 1, &targetBarrier);
+
+        Vulkan::DynamicRendering::GetInstance().Begin(m_CommandBuffer, targetView, {m_Width, m_Height}, nullptr, 0);
     }
+    else
+    {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_RenderPass;
+        renderPassInfo.framebuffer = m_Framebuffers[target];
+        renderPassInfo.renderArea.extent = {m_Width, m_Height};
+        vkCmdBeginRenderPass(m_CommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1,
+        &m_DescriptorSets[source], 0, nullptr);
+    vkCmdPushConstants(m_CommandBuffer, m_PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+        sizeof(UberPushConstants), &m_PushConstants);
+    vkCmdDraw(m_CommandBuffer, 3, 1, 0, 0);
+
+    if (m_bDynamicRendering)
+    {
+        // The outgoing dependency and final layout.
+        Vulkan::DynamicRendering::GetInstance().End(m_CommandBuffer);
+        Vulkan::DynamicRendering::Transition(m_CommandBuffer, targetImage,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+    }
+    else
+    {
+        vkCmdEndRenderPass(m_CommandBuffer);
+    }
+
+    m_CurrentTarget = target;
+}
+
+bool PostProcessor::CreateRenderTargets(UINT width, UINT height)
+{
+    CleanupRenderTargets();
 
-    vkBindImageMemory(m_Device, m_IntermediateImage, m_IntermediateImageMemory, 0);
+    Vulkan::TransientImageDesc desc;
+    desc.format = TARGET_FORMAT;
+    desc.width = width;
+    desc.height = height;
+    desc.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    Vulkan::TransientImage input = m_Targets.DeclareImage("PostInput", desc);
 
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = m_IntermediateImage;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.layerCount = 1;
+    desc.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    Vulkan::TransientImage output = m_Targets.DeclareImage("PostOutput", desc);
 
-    if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_IntermediateImageView) != VK_SUCCESS)
+    Vulkan::TransientImage bloomLevel0 = Vulkan::TRANSIENT_IMAGE_NONE;
+    Vulkan::TransientImage bloomChain = Vulkan::TRANSIENT_IMAGE_NONE;
+    if (m_Glare.enabled)
     {
-        OutputDebugStringA("[PostProcessing] Failed to create intermediate image view\n");
-        return false;
+        m_Bloom.DeclareTargets(m_Targets, width, height);
+        bloomLevel0 = m_Bloom.GetLevel0();
+        bloomChain = m_Bloom.GetChain();
     }
 
-    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    // The frame as seen by post-processing. The scene is copied into the
+    // input before BeginPostProcessing() and the output is read afterwards.
+    m_Targets.DeclarePass("Scene", {}, {input});
+    if (m_bFused)
+    {
+        if (m_Glare.enabled) m_Targets.DeclarePass("Bloom", {input}, {bloomLevel0, bloomChain});
+        m_Targets.DeclarePass("PostFused", {input, bloomLevel0}, {output});
+    }
+    else
+    {
+        // Effects ping-pong in call order, so everything stays live.
+        m_Targets.DeclarePass("PostEffects", {input, output, bloomLevel0, bloomChain}, {input, output});
+    }
+    m_Targets.DeclarePass("Present", {output}, {});
 
-    if (vkCreateImage(m_Device, &imageInfo, nullptr, &m_OutputImage) != VK_SUCCESS)
+    if (!m_Targets.Compile())
     {
-        OutputDebugStringA("[PostProcessing] Failed to create output image\n");
+        OutputDebugStringA("[PostProcessing] Failed to create render targets\n");
         return false;
     }
 
-    vkGetImageMemoryRequirements(m_Device, m_OutputImage, &memReq);
-    memInfo.allocationSize = memReq.size;
-    memInfo.memoryTypeIndex = FindMemoryType(memProperties, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_IntermediateImage = m_Targets.GetImage(input);
+    m_IntermediateImageView = m_Targets.GetView(input);
+    m_OutputImage = m_Targets.GetImage(output);
+    m_OutputImageView = m_Targets.GetView(output);
 
-    if (vkAllocateMemory(m_Device, &memInfo, nullptr, &m_OutputImageMemory) != VK_SUCCESS)
+    VkImageView views[2] = {m_IntermediateImageView, m_OutputImageView};
+    if (!AllocateDescriptorSets())
     {
-        OutputDebugStringA("[PostProcessing] Failed to allocate output image memory\n");
+        OutputDebugStringA("[PostProcessing] Failed to allocate descriptor sets\n");
         return false;
     }
 
-    vkBindImageMemory(m_Device, m_OutputImage, m_OutputImageMemory, 0);
-
-    viewInfo.image = m_OutputImage;
-    if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_OutputImageView) != VK_SUCCESS)
+    if (m_Glare.enabled && !m_Bloom.CreateTargets(m_Targets, views))
     {
-        OutputDebugStringA("[PostProcessing] Failed to create output image view\n");
+        OutputDebugStringA("[PostProcessing] Failed to create bloom targets\n");
         return false;
     }
 
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        // Dynamic rendering begins on the views directly.
+        if (!m_bDynamicRendering)
+        {
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = m_RenderPass;
+            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.pAttachments = &views[i];
+            framebufferInfo.width = width;
+            framebufferInfo.height = height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(m_Device, &framebufferInfo, nullptr, &m_Framebuffers[i]) != VK_SUCCESS)
+            {
+                OutputDebugStringA("[PostProcessing] Failed to create framebuffer\n");
+                return false;
+            }
+        }
+
+        VkDescriptorImageInfo imageDescriptors[2] = {};
+        imageDescriptors[0].sampler = m_Sampler;
+        imageDescriptors[0].imageView = views[i];
+        imageDescriptors[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // Without glare the bloom binding is never read; point it at the
+        // target itself to keep the set valid.
+        imageDescriptors[1].sampler = m_Sampler;
+        imageDescriptors[1].imageView = m_Glare.enabled ? m_Bloom.GetOutputView() : views[i];
+        imageDescriptors[1].imageLayout = m_Glare.enabled ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_DescriptorSets[i];
+        write.dstBinding = 0;
+        write.descriptorCount = 2;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = imageDescriptors;
+        vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+    }
+
     return true;
 }
 
 void PostProcessor::CleanupRenderTargets()
 {
-    if (m_OutputImageView) { vkDestroyImageView(m_Device, m_OutputImageView, nullptr); m_OutputImageView = VK_NULL_HANDLE; }
-    if (m_OutputImageMemory) { vkFreeMemory(m_Device, m_OutputImageMemory, nullptr); m_OutputImageMemory = VK_NULL_HANDLE; }
-    if (m_OutputImage) { vkDestroyImage(m_Device, m_OutputImage, nullptr); m_OutputImage = VK_NULL_HANDLE; }
+    Vulkan::DeletionQueue& deletionQueue = Vulkan::DeletionQueue::GetInstance();
+    for (VkFramebuffer& framebuffer : m_Framebuffers) deletionQueue.DestroyFramebuffer(framebuffer);
+    deletionQueue.DestroyDescriptorPool(m_DescriptorPool);
+    m_DescriptorSets[0] = m_DescriptorSets[1] = VK_NULL_HANDLE;
+
+    m_Bloom.CleanupTargets();
+    m_Targets.Reset();
+
+    m_IntermediateImage = VK_NULL_HANDLE;
+    m_IntermediateImageView = VK_NULL_HANDLE;
+    m_OutputImage = VK_NULL_HANDLE;
+    m_OutputImageView = VK_NULL_HANDLE;
+}
 
-    if (m_IntermediateImageView) { vkDestroyImageView(m_Device, m_IntermediateImageView, nullptr); m_IntermediateImageView = VK_NULL_HANDLE; }
-    if (m_IntermediateImageMemory) { vkFreeMemory(m_Device, m_IntermediateImageMemory, nullptr); m_IntermediateImageMemory = VK_NULL_HANDLE; }
-    if (m_IntermediateImage) { vkDestroyImage(m_Device, m_IntermediateImage, nullptr); m_IntermediateImage = VK_NULL_HANDLE; }
+bool PostProcessor::CreateRenderPass()
+{
+    if (m_bDynamicRendering) return true;
+
+    // Every pass overwrites its whole target and leaves it ready to be
+    // sampled by the next one.
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = TARGET_FORMAT;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference colorReference{};
+    colorReference.attachment = 0;
+    colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+
+    // In: the previous pass's output is read here, and this target may
+    // still be sampled by it. Out: the result is sampled or copied next.
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+
+    return vkCreateRenderPass(m_Device, &renderPassInfo, nullptr, &m_RenderPass) == VK_SUCCESS;
 }
 
-UINT PostProcessor::FindMemoryType(VkPhysicalDeviceMemoryProperties properties, UINT typeFilter, VkMemoryPropertyFlags propertiesFlags)
+bool PostProcessor::CreateDescriptors()
 {
-    for (UINT i = 0; i < properties.memoryTypeCount; i++)
+    // Binding 0: the previous pass's result, binding 1: the bloom chain
+    VkDescriptorSetLayoutBinding bindings[2] = {};
+    for (uint32_t i = 0; i < 2; i++)
     {
-        if ((typeFilter & (1 << i)) && (properties.memoryTypes[i].propertyFlags & propertiesFlags) == propertiesFlags)
-        {
-            return i;
-        }
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     }
-    return 0;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    return vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout) == VK_SUCCESS;
+}
+
+bool PostProcessor::AllocateDescriptorSets()
+{
+    // A fresh pool per set of targets: the sets of the previous targets may
+    // still be bound in frames in flight, so they are neither updated nor
+    // reset but retired along with their pool.
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = 4;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkDescriptorSetLayout layouts[2] = {m_DescriptorSetLayout, m_DescriptorSetLayout};
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = layouts;
+
+    return vkAllocateDescriptorSets(m_Device, &allocInfo, m_DescriptorSets) == VK_SUCCESS;
 }
 
 bool PostProcessor::CreateShaders()
 {
-    return true;
+    return LoadShaderModule(m_Device, "fullscreen_triangle.vert", m_FullscreenShader) &&
+           LoadShaderModule(m_Device, "post_uber.frag", m_UberShader);
 }
 
 bool PostProcessor::CreateSamplers()
@@ -253,8 +742,21 @@ bool PostProcessor::CreateSamplers()
     return true;
 }
 
-void PostProcessor::RenderQuad()
+bool PostProcessor::CreatePipelineLayout()
 {
+    VkPushConstantRange pushConstants{};
+    pushConstants.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstants.offset = 0;
+    pushConstants.size = sizeof(UberPushConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstants;
+
+    return vkCreatePipelineLayout(m_Device, &layoutInfo, nullptr, &m_PipelineLayout) == VK_SUCCESS;
 }
 
 } // namespace PostProcessing
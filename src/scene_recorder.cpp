@@ -0,0 +1,315 @@
+#include "../include/platform.h"
+#include "../include/scene_recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace Vulkan {
+
+SceneRecorder& SceneRecorder::GetInstance()
+{
+    static SceneRecorder instance;
+    return instance;
+}
+
+bool SceneRecorder::Initialize(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t workerCount)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_FramesInFlight = framesInFlight;
+    m_WorkerCount = std::min(workerCount, MAX_WORKERS);
+    m_bInitialized = true;
+
+    // Inline recording needs no pools of its own.
+    uint32_t contextCount = (m_WorkerCount > 0) ? m_WorkerCount + 1 : 0;
+    for (uint32_t c = 0; c < contextCount; c++)
+    {
+        for (uint32_t f = 0; f < m_FramesInFlight; f++)
+        {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamily;
+
+            if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_Contexts[c].pools[f]) != VK_SUCCESS)
+            {
+                OutputDebugStringA("[SceneRecorder] Failed to create recording command pool\n");
+                Shutdown();
+                return false;
+            }
+
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = m_Contexts[c].pools[f];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 2;
+
+            if (vkAllocateCommandBuffers(m_Device, &allocInfo, m_Contexts[c].buffers[f]) != VK_SUCCESS)
+            {
+                OutputDebugStringA("[SceneRecorder] Failed to allocate secondary command buffers\n");
+                Shutdown();
+                return false;
+            }
+        }
+    }
+
+    m_bStopping = false;
+    for (uint32_t c = 1; c < contextCount; c++) m_Threads.emplace_back(&SceneRecorder::WorkerThread, this, c);
+
+    char msg[128];
+    if (m_WorkerCount > 0)
+    {
+        sprintf_s(msg, "[SceneRecorder] Recording on %u worker threads into secondary command buffers\n", m_WorkerCount);
+    }
+    else
+    {
+        sprintf_s(msg, "[SceneRecorder] Recording inline on the calling thread\n");
+    }
+    OutputDebugStringA(msg);
+    return true;
+}
+
+void SceneRecorder::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStopping = true;
+    }
+    m_WorkCondition.notify_all();
+    for (std::thread& thread : m_Threads) thread.join();
+    m_Threads.clear();
+
+    if (m_Stats.frameCount > 0)
+    {
+        char msg[256];
+        sprintf_s(msg, "[SceneRecorder] %llu frames, %.1f draws and %.2f secondary buffers per frame, %.3f ms recording per frame\n",
+            (unsigned long long)m_Stats.frameCount,
+            (double)m_Stats.packetCount / (double)m_Stats.frameCount,
+            (double)m_Stats.chunkCount / (double)m_Stats.frameCount,
+            m_Stats.recordMilliseconds / (double)m_Stats.frameCount);
+        OutputDebugStringA(msg);
+    }
+
+    // Destroying a pool frees its command buffers.
+    for (Context& context : m_Contexts)
+    {
+        for (uint32_t f = 0; f < MAX_FRAMES_IN_FLIGHT; f++)
+        {
+            if (context.pools[f]) vkDestroyCommandPool(m_Device, context.pools[f], nullptr);
+        }
+        context = Context();
+    }
+
+    m_Packets.clear();
+    m_Packets.shrink_to_fit();
+    m_Generation = 0;
+    m_Pending = 0;
+    m_WorkerCount = 0;
+    m_Stats = SceneRecorderStats();
+    m_Device = VK_NULL_HANDLE;
+    m_bInitialized = false;
+}
+
+void SceneRecorder::BeginFrame(uint32_t frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkFormat colorFormat)
+{
+    if (!m_bInitialized) return;
+
+    // No worker is recording between Record() calls, so the pools are free.
+    if (m_WorkerCount > 0)
+    {
+        for (uint32_t c = 0; c <= m_WorkerCount; c++) vkResetCommandPool(m_Device, m_Contexts[c].pools[frameIndex], 0);
+    }
+
+    m_Frame = Job();
+    m_Frame.frameIndex = frameIndex;
+    m_Frame.renderPass = renderPass;
+    m_Frame.framebuffer = framebuffer;
+    m_Frame.colorFormat = colorFormat;
+    m_Packets.clear();
+}
+
+void SceneRecorder::Record(VkCommandBuffer primary)
+{
+    if (!m_bInitialized) return;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t packetCount = m_Packets.size();
+    m_Stats.frameCount++;
+    m_Stats.packetCount += packetCount;
+
+    if (m_WorkerCount == 0)
+    {
+        RecordPackets(primary, 0, packetCount);
+    }
+    else if (packetCount > 0)
+    {
+        // Contiguous chunks of at least MIN_PACKETS_PER_CHUNK, one per thread.
+        uint32_t chunkCount = (uint32_t)std::min<size_t>(m_WorkerCount + 1,
+            (packetCount + MIN_PACKETS_PER_CHUNK - 1) / MIN_PACKETS_PER_CHUNK);
+        size_t first = 0;
+        for (uint32_t c = 0; c < chunkCount; c++)
+        {
+            size_t count = packetCount / chunkCount + (c < packetCount % chunkCount ? 1 : 0);
+            m_Frame.first[c] = first;
+            m_Frame.count[c] = count;
+            first += count;
+        }
+
+        if (chunkCount > 1)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Job = m_Frame;
+                m_Pending = chunkCount - 1;
+                m_Generation++;
+            }
+            m_WorkCondition.notify_all();
+            m_Stats.parallelFrames++;
+        }
+
+        RecordChunk(0, m_Frame);
+
+        if (chunkCount > 1)
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_DoneCondition.wait(lock, [this] { return m_Pending == 0; });
+        }
+
+        VkCommandBuffer buffers[CONTEXT_COUNT];
+        for (uint32_t c = 0; c < chunkCount; c++) buffers[c] = m_Contexts[c].buffers[m_Frame.frameIndex][SCENE_BUFFER];
+        vkCmdExecuteCommands(primary, chunkCount, buffers);
+        m_Stats.chunkCount += chunkCount;
+
+        memset(m_Frame.count, 0, sizeof(m_Frame.count));
+    }
+
+    m_Stats.recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+VkCommandBuffer SceneRecorder::BeginOverlay(VkCommandBuffer primary)
+{
+    if (m_WorkerCount == 0) return primary;
+
+    VkCommandBuffer buffer = m_Contexts[0].buffers[m_Frame.frameIndex][OVERLAY_BUFFER];
+    return BeginSecondary(buffer, m_Frame) ? buffer : VK_NULL_HANDLE;
+}
+
+void SceneRecorder::EndOverlay(VkCommandBuffer primary)
+{
+    if (m_WorkerCount == 0) return;
+
+    VkCommandBuffer buffer = m_Contexts[0].buffers[m_Frame.frameIndex][OVERLAY_BUFFER];
+    if (vkEndCommandBuffer(buffer) == VK_SUCCESS) vkCmdExecuteCommands(primary, 1, &buffer);
+}
+
+void SceneRecorder::WorkerThread(uint32_t context)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkCondition.wait(lock, [&] { return m_bStopping || m_Generation != seen; });
+            if (m_bStopping) return;
+            seen = m_Generation;
+            job = m_Job;
+        }
+
+        // Threads beyond this frame's chunk count were not waited for.
+        if (job.count[context] == 0) continue;
+
+        RecordChunk(context, job);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_Pending == 0) m_DoneCondition.notify_one();
+    }
+}
+
+void SceneRecorder::RecordChunk(uint32_t context, const Job& job)
+{
+    VkCommandBuffer buffer = m_Contexts[context].buffers[job.frameIndex][SCENE_BUFFER];
+    if (!BeginSecondary(buffer, job)) return;
+
+    RecordPackets(buffer, job.first[context], job.count[context]);
+
+    if (vkEndCommandBuffer(buffer) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[SceneRecorder] Failed to record secondary command buffer\n");
+    }
+}
+
+bool SceneRecorder::BeginSecondary(VkCommandBuffer buffer, const Job& job)
+{
+    VkCommandBufferInheritanceRenderingInfo renderingInheritance = {};
+    renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInheritance.colorAttachmentCount = 1;
+    renderingInheritance.pColorAttachmentFormats = &job.colorFormat;
+    renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance = {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.pNext = job.renderPass ? nullptr : &renderingInheritance;
+    inheritance.renderPass = job.renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = job.framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(buffer, &beginInfo) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[SceneRecorder] Failed to begin secondary command buffer\n");
+        return false;
+    }
+    return true;
+}
+
+void SceneRecorder::RecordPackets(VkCommandBuffer cmd, size_t first, size_t count) const
+{
+    // Nothing is inherited by a secondary buffer, so each chunk starts
+    // with everything unbound and only binds what differs from the
+    // previous packet.
+    const DrawPacket* previous = nullptr;
+    for (size_t i = first; i < first + count; i++)
+    {
+        const DrawPacket& packet = m_Packets[i];
+
+        if (!previous || packet.pipeline != previous->pipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+        }
+
+        if (!previous || packet.descriptorSet != previous->descriptorSet ||
+            packet.dynamicOffsetCount != previous->dynamicOffsetCount ||
+            memcmp(packet.dynamicOffsets, previous->dynamicOffsets, packet.dynamicOffsetCount * sizeof(uint32_t)) != 0)
+        {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipelineLayout, 0, 1,
+                &packet.descriptorSet, packet.dynamicOffsetCount, packet.dynamicOffsets);
+        }
+
+        if (!previous || memcmp(&packet.viewport, &previous->viewport, sizeof(VkViewport)) != 0)
+        {
+            vkCmdSetViewport(cmd, 0, 1, &packet.viewport);
+        }
+
+        if (!previous || memcmp(&packet.scissor, &previous->scissor, sizeof(VkRect2D)) != 0)
+        {
+            vkCmdSetScissor(cmd, 0, 1, &packet.scissor);
+        }
+
+        VkBuffer vertexBuffers[2] = { packet.vertexBuffer, packet.vertexBuffer };
+        vkCmdBindVertexBuffers(cmd, 0, packet.vertexBindingCount, vertexBuffers, packet.vertexOffsets);
+        vkCmdBindIndexBuffer(cmd, packet.indexBuffer, packet.indexOffset, packet.indexType);
+        vkCmdDrawIndexed(cmd, packet.indexCount, packet.instanceCount, 0, 0, 0);
+
+        previous = &packet;
+    }
+}
+
+} // namespace Vulkan
@@ -0,0 +1,281 @@
+#include "../include/texture_convert.h"
+
+#if defined(OFP_TEXTURE_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Bridge {
+
+namespace {
+
+// D3DFORMAT values, so this file needs no D3D headers
+const uint32_t D3DFMT_A8R8G8B8_VALUE = 21;
+const uint32_t D3DFMT_X8R8G8B8_VALUE = 22;
+const uint32_t D3DFMT_R5G6B5_VALUE = 23;
+const uint32_t D3DFMT_X1R5G5B5_VALUE = 24;
+const uint32_t D3DFMT_A1R5G5B5_VALUE = 25;
+const uint32_t D3DFMT_A4R4G4B4_VALUE = 26;
+const uint32_t D3DFMT_X4R4G4B4_VALUE = 30;
+const uint32_t D3DFMT_P8_VALUE = 41;
+
+constexpr uint32_t FourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+inline uint32_t Pack(uint32_t r, uint32_t g, uint32_t b, uint32_t a, TexelOrder order)
+{
+    return order == TEXEL_ORDER_BGRA ? (b | (g << 8) | (r << 16) | (a << 24))
+                                     : (r | (g << 8) | (b << 16) | (a << 24));
+}
+
+inline uint32_t Widen5(uint32_t x) { return (x << 3) | (x >> 2); }
+inline uint32_t Widen6(uint32_t x) { return (x << 2) | (x >> 4); }
+inline uint32_t Widen4(uint32_t x) { return (x << 4) | x; }
+
+// The reference every SIMD kernel must match bit for bit.
+template <TextureFormat F, TexelOrder O>
+uint32_t ConvertScalar(const void* source, uint32_t* destination, uint32_t count, const uint32_t* palette)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t r, g, b, a;
+        if (F == TEXTURE_FORMAT_P8)
+        {
+            destination[i] = palette[static_cast<const uint8_t*>(source)[i]];
+            continue;
+        }
+        else if (F == TEXTURE_FORMAT_X8R8G8B8 || F == TEXTURE_FORMAT_A8R8G8B8)
+        {
+            uint32_t p = static_cast<const uint32_t*>(source)[i];
+            r = (p >> 16) & 0xFF;
+            g = (p >> 8) & 0xFF;
+            b = p & 0xFF;
+            a = (F == TEXTURE_FORMAT_X8R8G8B8) ? 0xFF : p >> 24;
+        }
+        else
+        {
+            uint32_t p = static_cast<const uint16_t*>(source)[i];
+            if (F == TEXTURE_FORMAT_R5G6B5)
+            {
+                r = Widen5(p >> 11);
+                g = Widen6((p >> 5) & 0x3F);
+                b = Widen5(p & 0x1F);
+                a = 0xFF;
+            }
+            else if (F == TEXTURE_FORMAT_X1R5G5B5 || F == TEXTURE_FORMAT_A1R5G5B5)
+            {
+                r = Widen5((p >> 10) & 0x1F);
+                g = Widen5((p >> 5) & 0x1F);
+                b = Widen5(p & 0x1F);
+                a = (F == TEXTURE_FORMAT_X1R5G5B5 || (p & 0x8000)) ? 0xFF : 0;
+            }
+            else
+            {
+                r = Widen4((p >> 8) & 0xF);
+                g = Widen4((p >> 4) & 0xF);
+                b = Widen4(p & 0xF);
+                a = (F == TEXTURE_FORMAT_A4R4G4B4) ? Widen4(p >> 12) : 0xFF;
+            }
+        }
+        destination[i] = Pack(r, g, b, a, O);
+    }
+    return count;
+}
+
+template <TextureFormat F>
+void FillScalar(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+    kernels[F][TEXEL_ORDER_BGRA] = ConvertScalar<F, TEXEL_ORDER_BGRA>;
+    kernels[F][TEXEL_ORDER_RGBA] = ConvertScalar<F, TEXEL_ORDER_RGBA>;
+}
+
+struct KernelTables {
+    TexelKernel kernels[SIMD_LEVEL_COUNT][TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT] = {};
+    SimdLevel level = SIMD_SCALAR;
+
+    KernelTables()
+    {
+        TexelKernel (*scalar)[TEXEL_ORDER_COUNT] = kernels[SIMD_SCALAR];
+        FillScalar<TEXTURE_FORMAT_R5G6B5>(scalar);
+        FillScalar<TEXTURE_FORMAT_X1R5G5B5>(scalar);
+        FillScalar<TEXTURE_FORMAT_A1R5G5B5>(scalar);
+        FillScalar<TEXTURE_FORMAT_A4R4G4B4>(scalar);
+        FillScalar<TEXTURE_FORMAT_X4R4G4B4>(scalar);
+        FillScalar<TEXTURE_FORMAT_X8R8G8B8>(scalar);
+        FillScalar<TEXTURE_FORMAT_A8R8G8B8>(scalar);
+        FillScalar<TEXTURE_FORMAT_P8>(scalar);
+
+        GetSse2Kernels(kernels[SIMD_SSE2]);
+        GetAvx2Kernels(kernels[SIMD_AVX2]);
+        level = DetectLevel();
+    }
+
+    static SimdLevel DetectLevel()
+    {
+#if defined(OFP_TEXTURE_SIMD) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool avx2 = false;
+        // AVX2 also needs the OS to save the YMM registers.
+        if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? SIMD_AVX2 : sse2 ? SIMD_SSE2 : SIMD_SCALAR;
+#elif defined(OFP_TEXTURE_SIMD)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : __builtin_cpu_supports("sse2") ? SIMD_SSE2 : SIMD_SCALAR;
+#else
+        return SIMD_SCALAR;
+#endif
+    }
+};
+
+const KernelTables& GetTables()
+{
+    static const KernelTables tables;
+    return tables;
+}
+
+} // namespace
+
+bool GetTextureConversion(uint32_t d3dFormat, TexelOrder order, TextureConversion& conversion)
+{
+    conversion = TextureConversion();
+    conversion.format = order == TEXEL_ORDER_BGRA ? VK_FORMAT_B8G8R8A8_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+
+    switch (d3dFormat)
+    {
+    case D3DFMT_A8R8G8B8_VALUE:
+        conversion.source = order == TEXEL_ORDER_BGRA ? TEXTURE_FORMAT_RAW : TEXTURE_FORMAT_A8R8G8B8;
+        return true;
+    case D3DFMT_X8R8G8B8_VALUE: conversion.source = TEXTURE_FORMAT_X8R8G8B8; return true;
+    case D3DFMT_R5G6B5_VALUE: conversion.source = TEXTURE_FORMAT_R5G6B5; return true;
+    case D3DFMT_X1R5G5B5_VALUE: conversion.source = TEXTURE_FORMAT_X1R5G5B5; return true;
+    case D3DFMT_A1R5G5B5_VALUE: conversion.source = TEXTURE_FORMAT_A1R5G5B5; return true;
+    case D3DFMT_A4R4G4B4_VALUE: conversion.source = TEXTURE_FORMAT_A4R4G4B4; return true;
+    case D3DFMT_X4R4G4B4_VALUE: conversion.source = TEXTURE_FORMAT_X4R4G4B4; return true;
+    case D3DFMT_P8_VALUE: conversion.source = TEXTURE_FORMAT_P8; return true;
+    default:
+        break;
+    }
+
+    // DXT2 and DXT4 only differ from DXT3 and DXT5 in premultiplied alpha,
+    // which the blend state handles.
+    conversion.source = TEXTURE_FORMAT_RAW;
+    conversion.blockSize = 4;
+    switch (d3dFormat)
+    {
+    case FourCC('D', 'X', 'T', '1'):
+        conversion.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        conversion.bytesPerBlock = 8;
+        return true;
+    case FourCC('D', 'X', 'T', '2'):
+    case FourCC('D', 'X', 'T', '3'):
+        conversion.format = VK_FORMAT_BC2_UNORM_BLOCK;
+        conversion.bytesPerBlock = 16;
+        return true;
+    case FourCC('D', 'X', 'T', '4'):
+    case FourCC('D', 'X', 'T', '5'):
+        conversion.format = VK_FORMAT_BC3_UNORM_BLOCK;
+        conversion.bytesPerBlock = 16;
+        return true;
+    default:
+        conversion = TextureConversion();
+        return false;
+    }
+}
+
+void ConvertPalette(const uint8_t entries[256 * 4], TexelOrder order, uint32_t palette[256])
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        const uint8_t* entry = entries + i * 4;
+        palette[i] = Pack(entry[0], entry[1], entry[2], entry[3], order);
+    }
+}
+
+void ConvertTexels(TextureFormat format, TexelOrder order, SimdLevel level,
+                   const void* source, uint32_t* destination, uint32_t count, const uint32_t* palette)
+{
+    if (format == TEXTURE_FORMAT_RAW || format >= TEXTURE_FORMAT_COUNT) return;
+
+    const KernelTables& tables = GetTables();
+    uint32_t done = 0;
+    for (uint32_t i = level; i > SIMD_SCALAR; i--)
+    {
+        TexelKernel kernel = tables.kernels[i][format][order];
+        if (kernel)
+        {
+            done = kernel(source, destination, count, palette);
+            break;
+        }
+    }
+
+    if (done < count)
+    {
+        const uint8_t* rest = static_cast<const uint8_t*>(source) + (size_t)done * GetSourceTexelSize(format);
+        tables.kernels[SIMD_SCALAR][format][order](rest, destination + done, count - done, palette);
+    }
+}
+
+void ConvertTexture(TextureFormat format, TexelOrder order, const void* source, uint32_t sourcePitch,
+                    uint32_t* destination, uint32_t width, uint32_t height, const uint32_t* palette)
+{
+    SimdLevel level = GetSimdLevel();
+    if (sourcePitch == 0) sourcePitch = width * GetSourceTexelSize(format);
+
+    const uint8_t* row = static_cast<const uint8_t*>(source);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        ConvertTexels(format, order, level, row, destination, width, palette);
+        row += sourcePitch;
+        destination += width;
+    }
+}
+
+SimdLevel GetSimdLevel()
+{
+    return GetTables().level;
+}
+
+uint32_t GetSourceTexelSize(TextureFormat format)
+{
+    switch (format)
+    {
+    case TEXTURE_FORMAT_P8:
+        return 1;
+    case TEXTURE_FORMAT_R5G6B5:
+    case TEXTURE_FORMAT_X1R5G5B5:
+    case TEXTURE_FORMAT_A1R5G5B5:
+    case TEXTURE_FORMAT_A4R4G4B4:
+    case TEXTURE_FORMAT_X4R4G4B4:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+const char* GetTextureFormatName(TextureFormat format)
+{
+    static const char* const names[TEXTURE_FORMAT_COUNT] = {
+        "Raw", "R5G6B5", "X1R5G5B5", "A1R5G5B5", "A4R4G4B4", "X4R4G4B4", "X8R8G8B8", "A8R8G8B8", "P8"
+    };
+    return format < TEXTURE_FORMAT_COUNT ? names[format] : "Unknown";
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+    static const char* const names[SIMD_LEVEL_COUNT] = {"Scalar", "SSE2", "AVX2"};
+    return level < SIMD_LEVEL_COUNT ? names[level] : "Unknown";
+}
+
+} // namespace Bridge
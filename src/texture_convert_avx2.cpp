@@ -0,0 +1,78 @@
+#include "../include/texture_convert.h"
+
+#ifdef OFP_TEXTURE_SIMD
+
+#include "../include/texture_kernels.h"
+#include <immintrin.h>
+
+namespace Bridge {
+
+namespace {
+
+struct Avx2 {
+    typedef __m256i V;
+    static const uint32_t LANES16 = 16;
+    static const uint32_t LANES32 = 8;
+
+    static V Load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+    static V Set16(uint16_t x) { return _mm256_set1_epi16((short)x); }
+    static V Set32(uint32_t x) { return _mm256_set1_epi32((int)x); }
+    static V And(V a, V b) { return _mm256_and_si256(a, b); }
+    static V Or(V a, V b) { return _mm256_or_si256(a, b); }
+    template <int N> static V Srli16(V v) { return _mm256_srli_epi16(v, N); }
+    template <int N> static V Slli16(V v) { return _mm256_slli_epi16(v, N); }
+    template <int N> static V Srai16(V v) { return _mm256_srai_epi16(v, N); }
+    template <int N> static V Srli32(V v) { return _mm256_srli_epi32(v, N); }
+    template <int N> static V Slli32(V v) { return _mm256_slli_epi32(v, N); }
+
+    static void Store(uint32_t* p, V v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+    static void StoreInterleave(uint32_t* p, V lo, V hi)
+    {
+        // Unpacks work within 128-bit halves: a holds texels 0-3 and 8-11,
+        // b texels 4-7 and 12-15.
+        V a = _mm256_unpacklo_epi16(lo, hi);
+        V b = _mm256_unpackhi_epi16(lo, hi);
+        Store(p, _mm256_permute2x128_si256(a, b, 0x20));
+        Store(p + 8, _mm256_permute2x128_si256(a, b, 0x31));
+    }
+};
+
+uint32_t ConvertP8(const void* source, uint32_t* destination, uint32_t count, const uint32_t* palette)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(source);
+    const uint32_t n = count & ~7u;
+    const int* table = reinterpret_cast<const int*>(palette);
+
+    for (uint32_t i = 0; i < n; i += 8)
+    {
+        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+        Avx2::Store(destination + i, _mm256_i32gather_epi32(table, indices, 4));
+    }
+    return n;
+}
+
+} // namespace
+
+void GetAvx2Kernels(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+    Kernels::FillKernels<Avx2>(kernels);
+
+    // The palette is already in output order.
+    kernels[TEXTURE_FORMAT_P8][TEXEL_ORDER_BGRA] = ConvertP8;
+    kernels[TEXTURE_FORMAT_P8][TEXEL_ORDER_RGBA] = ConvertP8;
+}
+
+} // namespace Bridge
+
+#else
+
+namespace Bridge {
+
+void GetAvx2Kernels(TexelKernel[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+}
+
+} // namespace Bridge
+
+#endif // OFP_TEXTURE_SIMD
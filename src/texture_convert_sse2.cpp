@@ -0,0 +1,57 @@
+#include "../include/texture_convert.h"
+
+#ifdef OFP_TEXTURE_SIMD
+
+#include "../include/texture_kernels.h"
+#include <emmintrin.h>
+
+namespace Bridge {
+
+namespace {
+
+struct Sse2 {
+    typedef __m128i V;
+    static const uint32_t LANES16 = 8;
+    static const uint32_t LANES32 = 4;
+
+    static V Load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+    static V Set16(uint16_t x) { return _mm_set1_epi16((short)x); }
+    static V Set32(uint32_t x) { return _mm_set1_epi32((int)x); }
+    static V And(V a, V b) { return _mm_and_si128(a, b); }
+    static V Or(V a, V b) { return _mm_or_si128(a, b); }
+    template <int N> static V Srli16(V v) { return _mm_srli_epi16(v, N); }
+    template <int N> static V Slli16(V v) { return _mm_slli_epi16(v, N); }
+    template <int N> static V Srai16(V v) { return _mm_srai_epi16(v, N); }
+    template <int N> static V Srli32(V v) { return _mm_srli_epi32(v, N); }
+    template <int N> static V Slli32(V v) { return _mm_slli_epi32(v, N); }
+
+    static void Store(uint32_t* p, V v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+
+    static void StoreInterleave(uint32_t* p, V lo, V hi)
+    {
+        Store(p, _mm_unpacklo_epi16(lo, hi));
+        Store(p + 4, _mm_unpackhi_epi16(lo, hi));
+    }
+};
+
+} // namespace
+
+void GetSse2Kernels(TexelKernel kernels[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+    // P8 has no gather before AVX2; the scalar lookup is as fast.
+    Kernels::FillKernels<Sse2>(kernels);
+}
+
+} // namespace Bridge
+
+#else
+
+namespace Bridge {
+
+void GetSse2Kernels(TexelKernel[TEXTURE_FORMAT_COUNT][TEXEL_ORDER_COUNT])
+{
+}
+
+} // namespace Bridge
+
+#endif // OFP_TEXTURE_SIMD
@@ -0,0 +1,227 @@
+#include "../include/platform.h"
+#include "../include/transient_pool.h"
+#include "../include/deletion_queue.h"
+#include <algorithm>
+
+namespace {
+
+const VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                           VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                           VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+bool IsDepthFormat(VkFormat format)
+{
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT ||
+           format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+} // namespace
+
+namespace Vulkan {
+
+TransientImage TransientPool::DeclareImage(const char* name, const TransientImageDesc& desc)
+{
+    ImageEntry entry;
+    entry.name = name;
+    entry.desc = desc;
+    m_Images.push_back(entry);
+    return (TransientImage)(m_Images.size() - 1);
+}
+
+void TransientPool::DeclarePass(const char* name, std::initializer_list<TransientImage> reads, std::initializer_list<TransientImage> writes)
+{
+    uint32_t pass = (uint32_t)m_Passes.size();
+    m_Passes.push_back(name);
+
+    for (std::initializer_list<TransientImage> list : {reads, writes})
+    {
+        for (TransientImage image : list)
+        {
+            if (image >= m_Images.size()) continue;
+            ImageEntry& entry = m_Images[image];
+            entry.firstPass = std::min(entry.firstPass, pass);
+            entry.lastPass = std::max(entry.lastPass, pass);
+        }
+    }
+}
+
+bool TransientPool::Overlaps(const MemorySlot& slot, const ImageEntry& image) const
+{
+    for (uint32_t other : slot.images)
+    {
+        const ImageEntry& entry = m_Images[other];
+        if (image.firstPass <= entry.lastPass && entry.firstPass <= image.lastPass) return true;
+    }
+    return false;
+}
+
+bool TransientPool::Compile()
+{
+    if (m_bCompiled) return true;
+
+    m_Stats = TransientPoolStats();
+    m_Stats.imageCount = (uint32_t)m_Images.size();
+
+    for (ImageEntry& entry : m_Images)
+    {
+        // Images no pass mentions are assumed to live for the whole frame.
+        if (entry.firstPass == UINT32_MAX)
+        {
+            entry.firstPass = 0;
+            entry.lastPass = m_Passes.empty() ? 0 : (uint32_t)m_Passes.size() - 1;
+        }
+
+        // Only pure attachments may be transient; anything sampled, stored
+        // or copied needs real memory.
+        entry.lazy = (entry.desc.usage & ~ATTACHMENT_USAGE) == 0;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = entry.desc.format;
+        imageInfo.extent = {entry.desc.width, entry.desc.height, 1};
+        imageInfo.mipLevels = entry.desc.mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = entry.desc.usage | (entry.lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(m_Device, &imageInfo, nullptr, &entry.image) != VK_SUCCESS)
+        {
+            char msg[256];
+            sprintf_s(msg, "[TransientPool] Failed to create image %s\n", entry.name.c_str());
+            OutputDebugStringA(msg);
+            return false;
+        }
+
+        vkGetImageMemoryRequirements(m_Device, entry.image, &entry.requirements);
+        m_Stats.naiveBytes += entry.requirements.size;
+    }
+
+    // Largest first, each into the first slot with a compatible memory type
+    // whose images are all dead by the time this one is needed.
+    std::vector<uint32_t> order(m_Images.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_Images[a].requirements.size > m_Images[b].requirements.size;
+    });
+
+    for (uint32_t index : order)
+    {
+        ImageEntry& entry = m_Images[index];
+
+        uint32_t slot = 0;
+        for (; slot < m_Slots.size(); slot++)
+        {
+            const MemorySlot& candidate = m_Slots[slot];
+            if (candidate.lazy || entry.lazy) continue;
+            if (!(candidate.requirements.memoryTypeBits & entry.requirements.memoryTypeBits)) continue;
+            if (!Overlaps(candidate, entry)) break;
+        }
+
+        if (slot == m_Slots.size())
+        {
+            MemorySlot created;
+            created.requirements = entry.requirements;
+            created.lazy = entry.lazy;
+            m_Slots.push_back(created);
+        }
+
+        MemorySlot& target = m_Slots[slot];
+        target.requirements.size = std::max(target.requirements.size, entry.requirements.size);
+        target.requirements.alignment = std::max(target.requirements.alignment, entry.requirements.alignment);
+        target.requirements.memoryTypeBits &= entry.requirements.memoryTypeBits;
+        target.images.push_back(index);
+        entry.slot = slot;
+    }
+
+    MemoryAllocator& allocator = MemoryAllocator::GetInstance();
+    for (MemorySlot& slot : m_Slots)
+    {
+        VkMemoryPropertyFlags preferred = slot.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
+        if (!allocator.AllocateImageMemory(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferred, ALLOCATION_DEDICATED, slot.allocation))
+        {
+            OutputDebugStringA("[TransientPool] Failed to allocate memory slot\n");
+            return false;
+        }
+
+        m_Stats.allocatedBytes += slot.allocation.size;
+        if (allocator.GetMemoryTypeFlags(slot.allocation.memoryTypeIndex) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+        {
+            m_Stats.lazyBytes += slot.allocation.size;
+        }
+    }
+    m_Stats.slotCount = (uint32_t)m_Slots.size();
+
+    for (ImageEntry& entry : m_Images)
+    {
+        const Allocation& allocation = m_Slots[entry.slot].allocation;
+        if (vkBindImageMemory(m_Device, entry.image, allocation.memory, allocation.offset) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[TransientPool] Failed to bind image memory\n");
+            return false;
+        }
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = entry.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = entry.desc.format;
+        viewInfo.subresourceRange.aspectMask = IsDepthFormat(entry.desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = entry.desc.mipLevels;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_Device, &viewInfo, nullptr, &entry.view) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[TransientPool] Failed to create image view\n");
+            return false;
+        }
+    }
+
+    m_bCompiled = true;
+    LogSummary();
+    return true;
+}
+
+void TransientPool::Reset()
+{
+    // Frames in flight may still use the images, so they and their memory
+    // go through the deletion queue.
+    DeletionQueue& deletionQueue = DeletionQueue::GetInstance();
+    for (ImageEntry& entry : m_Images)
+    {
+        deletionQueue.DestroyImageView(entry.view);
+        deletionQueue.DestroyImage(entry.image);
+    }
+
+    for (MemorySlot& slot : m_Slots)
+    {
+        deletionQueue.FreeMemory(slot.allocation);
+    }
+
+    m_Images.clear();
+    m_Passes.clear();
+    m_Slots.clear();
+    m_Stats = TransientPoolStats();
+    m_bCompiled = false;
+}
+
+void TransientPool::LogSummary() const
+{
+    char msg[256];
+    sprintf_s(msg, "[TransientPool] %u images in %u slots over %u passes: %.1f MB (naive %.1f MB, saved %.1f MB, lazy %.1f MB)\n",
+        m_Stats.imageCount, m_Stats.slotCount, (uint32_t)m_Passes.size(),
+        m_Stats.allocatedBytes / (1024.0 * 1024.0), m_Stats.naiveBytes / (1024.0 * 1024.0),
+        m_Stats.SavedBytes() / (1024.0 * 1024.0), m_Stats.lazyBytes / (1024.0 * 1024.0));
+    OutputDebugStringA(msg);
+
+    for (const ImageEntry& entry : m_Images)
+    {
+        sprintf_s(msg, "[TransientPool]   %-12s %ux%u passes %u-%u slot %u\n", entry.name.c_str(),
+            entry.desc.width, entry.desc.height, entry.firstPass, entry.lastPass, entry.slot);
+        OutputDebugStringA(msg);
+    }
+}
+
+} // namespace Vulkan
@@ -0,0 +1,374 @@
+#include <windows.h>
+#include "../include/uniform_state.h"
+#include <cstring>
+
+namespace {
+
+const VkDeviceSize UNIFORM_RING_SIZE = 256 * 1024;
+
+const VkDeviceSize BLOCK_SIZES[Bridge::UNIFORM_BLOCK_COUNT] = {
+    sizeof(Bridge::TransformConstants),
+    sizeof(Bridge::ObjectConstants),
+    sizeof(Bridge::LightingConstants),
+};
+
+} // namespace
+
+namespace Bridge {
+
+bool UniformState::Initialize(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_bInitialized = true;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_Alignment = properties.limits.minUniformBufferOffsetAlignment;
+    if (m_Alignment < 16) m_Alignment = 16;
+
+    VkDescriptorSetLayoutBinding bindings[UNIFORM_BLOCK_COUNT] = {};
+    for (uint32_t i = 0; i < UNIFORM_BLOCK_COUNT; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = UNIFORM_BLOCK_COUNT;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &m_DescriptorSetLayout) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UniformState] Failed to create descriptor set layout\n");
+        Shutdown();
+        return false;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+
+    if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UniformState] Failed to create pipeline layout\n");
+        Shutdown();
+        return false;
+    }
+
+    // A set is only needed per ring buffer used in a frame, normally one.
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = DESCRIPTOR_SETS_PER_FRAME * UNIFORM_BLOCK_COUNT;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = DESCRIPTOR_SETS_PER_FRAME;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    for (uint32_t i = 0; i < Vulkan::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPools[i]) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[UniformState] Failed to create descriptor pool\n");
+            Shutdown();
+            return false;
+        }
+    }
+
+    if (!m_Ring.Initialize(device, physicalDevice, UNIFORM_RING_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT))
+    {
+        OutputDebugStringA("[UniformState] Failed to create uniform ring\n");
+        Shutdown();
+        return false;
+    }
+
+    Math::Identity(m_Projection);
+    Math::Identity(m_Transform.view);
+    Math::ClipSpaceFixup(m_Transform.projection);
+    Math::Identity(m_Object.world);
+    m_Material = MaterialConstants();
+    memset(m_Transform.screenToClip, 0, sizeof(m_Transform.screenToClip));
+    memset(m_Ambient, 0, sizeof(m_Ambient));
+    m_AlphaReference = 0.0f;
+    m_EnabledLights = 0;
+    m_Dirty = DIRTY_ALL;
+    m_Stale = STALE_VIEW_PROJECTION | STALE_WORLD_VIEW_PROJECTION | STALE_NORMAL;
+    m_Stats = UniformStats();
+
+    return true;
+}
+
+void UniformState::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    if (m_Stats.drawCount > 0)
+    {
+        char msg[256];
+        sprintf_s(msg, "[UniformState] %llu draws, %llu clean, %llu transform, %llu object and %llu lighting writes, %llu matrix multiplies, %llu KB written\n",
+            (unsigned long long)m_Stats.drawCount, (unsigned long long)m_Stats.cleanDrawCount,
+            (unsigned long long)m_Stats.blockWrites[UNIFORM_BLOCK_TRANSFORM],
+            (unsigned long long)m_Stats.blockWrites[UNIFORM_BLOCK_OBJECT],
+            (unsigned long long)m_Stats.blockWrites[UNIFORM_BLOCK_LIGHTING],
+            (unsigned long long)m_Stats.matrixMultiplies, (unsigned long long)(m_Stats.bytesWritten / 1024));
+        OutputDebugStringA(msg);
+    }
+
+    m_Ring.Shutdown();
+
+    for (uint32_t i = 0; i < Vulkan::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        if (m_DescriptorPools[i]) vkDestroyDescriptorPool(m_Device, m_DescriptorPools[i], nullptr);
+        m_DescriptorPools[i] = VK_NULL_HANDLE;
+    }
+    if (m_PipelineLayout) vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+    if (m_DescriptorSetLayout) vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
+    m_PipelineLayout = VK_NULL_HANDLE;
+    m_DescriptorSetLayout = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+    m_Buffer = VK_NULL_HANDLE;
+
+    m_bInitialized = false;
+}
+
+void UniformState::SetWorld(const Math::Matrix4& matrix)
+{
+    if (!Update(&m_Object.world, &matrix, sizeof(matrix))) return;
+
+    m_Dirty |= 1u << UNIFORM_BLOCK_OBJECT;
+    m_Stale |= STALE_WORLD_VIEW_PROJECTION | STALE_NORMAL;
+}
+
+void UniformState::SetView(const Math::Matrix4& matrix)
+{
+    if (!Update(&m_Transform.view, &matrix, sizeof(matrix))) return;
+
+    m_Dirty |= (1u << UNIFORM_BLOCK_TRANSFORM) | (1u << UNIFORM_BLOCK_OBJECT);
+    m_Stale |= STALE_VIEW_PROJECTION | STALE_WORLD_VIEW_PROJECTION;
+}
+
+void UniformState::SetProjection(const Math::Matrix4& matrix)
+{
+    if (!Update(&m_Projection, &matrix, sizeof(matrix))) return;
+
+    // The fixup is folded in here, once per projection change.
+    Math::Matrix4 fixup;
+    Math::ClipSpaceFixup(fixup);
+    Math::Multiply(m_Projection, fixup, m_Transform.projection);
+    m_Stats.matrixMultiplies++;
+
+    m_Dirty |= (1u << UNIFORM_BLOCK_TRANSFORM) | (1u << UNIFORM_BLOCK_OBJECT);
+    m_Stale |= STALE_VIEW_PROJECTION | STALE_WORLD_VIEW_PROJECTION;
+}
+
+void UniformState::SetMaterial(const MaterialConstants& material)
+{
+    if (Update(&m_Material, &material, sizeof(m_Material))) m_Dirty |= 1u << UNIFORM_BLOCK_LIGHTING;
+}
+
+void UniformState::SetAmbient(const float color[4])
+{
+    if (Update(m_Ambient, color, sizeof(m_Ambient))) m_Dirty |= 1u << UNIFORM_BLOCK_LIGHTING;
+}
+
+void UniformState::SetAlphaReference(float reference)
+{
+    if (Update(&m_AlphaReference, &reference, sizeof(reference))) m_Dirty |= 1u << UNIFORM_BLOCK_LIGHTING;
+}
+
+void UniformState::SetTargetSize(uint32_t width, uint32_t height)
+{
+    if (width == 0 || height == 0) return;
+
+    float screenToClip[4] = { 2.0f / width, 2.0f / height, 0.0f, 0.0f };
+    if (Update(m_Transform.screenToClip, screenToClip, sizeof(screenToClip))) m_Dirty |= 1u << UNIFORM_BLOCK_TRANSFORM;
+}
+
+bool UniformState::SetLight(uint32_t index, const LightConstants& light)
+{
+    if (index >= MAX_ACTIVE_LIGHTS) return false;
+
+    // A disabled light is not in the block, so changing it costs nothing yet.
+    if (Update(&m_Lights[index], &light, sizeof(light)) && (m_EnabledLights & (1u << index)))
+    {
+        m_Dirty |= 1u << UNIFORM_BLOCK_LIGHTING;
+    }
+    return true;
+}
+
+bool UniformState::EnableLight(uint32_t index, bool enable)
+{
+    if (index >= MAX_ACTIVE_LIGHTS) return false;
+
+    uint32_t enabled = enable ? (m_EnabledLights | (1u << index)) : (m_EnabledLights & ~(1u << index));
+    if (enabled != m_EnabledLights)
+    {
+        if (m_ChangeCallback) m_ChangeCallback(m_ChangeContext);
+        m_EnabledLights = enabled;
+        m_Dirty |= 1u << UNIFORM_BLOCK_LIGHTING;
+    }
+    return true;
+}
+
+void UniformState::BeginFrame(uint32_t frameIndex)
+{
+    if (!m_bInitialized) return;
+
+    m_CurrentFrame = frameIndex;
+    m_Ring.BeginFrame(frameIndex);
+    vkResetDescriptorPool(m_Device, m_DescriptorPools[m_CurrentFrame], 0);
+
+    m_Buffer = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+    m_Dirty = DIRTY_ALL;
+}
+
+bool UniformState::Flush(VkDescriptorSet& descriptorSet, uint32_t offsets[UNIFORM_BLOCK_COUNT])
+{
+    m_Stats.drawCount++;
+    if (m_Dirty == 0)
+    {
+        m_Stats.cleanDrawCount++;
+    }
+    else
+    {
+        if (m_Stale) UpdateMatrices();
+        if (!WriteBlocks(m_Dirty)) return false;
+
+        m_Stats.descriptorBinds++;
+        m_Dirty = 0;
+    }
+
+    descriptorSet = m_DescriptorSet;
+    memcpy(offsets, m_Offsets, sizeof(m_Offsets));
+    return true;
+}
+
+// Copies value into state and reports whether it differed.
+bool UniformState::Update(void* state, const void* value, size_t size)
+{
+    if (memcmp(state, value, size) == 0) return false;
+    if (m_ChangeCallback) m_ChangeCallback(m_ChangeContext);
+    memcpy(state, value, size);
+    return true;
+}
+
+void UniformState::UpdateMatrices()
+{
+    if (m_Stale & STALE_VIEW_PROJECTION)
+    {
+        Math::Multiply(m_Transform.view, m_Transform.projection, m_Transform.viewProjection);
+        m_Stats.matrixMultiplies++;
+    }
+    if (m_Stale & STALE_WORLD_VIEW_PROJECTION)
+    {
+        Math::Multiply(m_Object.world, m_Transform.viewProjection, m_Object.worldViewProjection);
+        m_Stats.matrixMultiplies++;
+    }
+    if (m_Stale & STALE_NORMAL)
+    {
+        // A singular world matrix (a flattened object) keeps identity normals.
+        Math::InverseTranspose3x3(m_Object.world, m_Object.normal);
+    }
+    m_Stale = 0;
+}
+
+bool UniformState::WriteBlocks(uint32_t blocks)
+{
+    uint32_t pending = blocks;
+    while (pending)
+    {
+        uint32_t block = 0;
+        while (!(pending & (1u << block))) block++;
+
+        UploadAllocation allocation;
+        if (!m_Ring.Allocate(BLOCK_SIZES[block], m_Alignment, allocation)) return false;
+
+        // The ring chained a new buffer: the descriptor set can only point
+        // at one, so the clean blocks are written again next to this one.
+        if (allocation.buffer != m_Buffer)
+        {
+            if (!AllocateDescriptorSet(allocation.buffer)) return false;
+            pending = DIRTY_ALL;
+        }
+        pending &= ~(1u << block);
+
+        if (block == UNIFORM_BLOCK_TRANSFORM)
+        {
+            memcpy(allocation.data, &m_Transform, sizeof(m_Transform));
+        }
+        else if (block == UNIFORM_BLOCK_OBJECT)
+        {
+            memcpy(allocation.data, &m_Object, sizeof(m_Object));
+        }
+        else
+        {
+            FillLighting(*static_cast<LightingConstants*>(allocation.data));
+        }
+
+        m_Offsets[block] = (uint32_t)allocation.offset;
+        m_Stats.blockWrites[block]++;
+        m_Stats.bytesWritten += BLOCK_SIZES[block];
+    }
+    return true;
+}
+
+bool UniformState::AllocateDescriptorSet(VkBuffer buffer)
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPools[m_CurrentFrame];
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    if (vkAllocateDescriptorSets(m_Device, &allocInfo, &set) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UniformState] Out of uniform descriptor sets for this frame\n");
+        return false;
+    }
+
+    VkDescriptorBufferInfo bufferInfos[UNIFORM_BLOCK_COUNT] = {};
+    VkWriteDescriptorSet writes[UNIFORM_BLOCK_COUNT] = {};
+    for (uint32_t i = 0; i < UNIFORM_BLOCK_COUNT; i++)
+    {
+        bufferInfos[i].buffer = buffer;
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = BLOCK_SIZES[i];
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(m_Device, UNIFORM_BLOCK_COUNT, writes, 0, nullptr);
+
+    m_Buffer = buffer;
+    m_DescriptorSet = set;
+    return true;
+}
+
+void UniformState::FillLighting(LightingConstants& lighting) const
+{
+    lighting.material = m_Material;
+    memcpy(lighting.ambient, m_Ambient, sizeof(m_Ambient));
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < MAX_ACTIVE_LIGHTS; i++)
+    {
+        if (m_EnabledLights & (1u << i)) lighting.lights[count++] = m_Lights[i];
+    }
+    lighting.lightCount = count;
+    lighting.alphaReference = m_AlphaReference;
+}
+
+} // namespace Bridge
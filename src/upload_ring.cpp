@@ -0,0 +1,169 @@
+#include "../include/platform.h"
+#include "../include/upload_ring.h"
+
+namespace Bridge {
+
+bool UploadRing::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize sizePerFrame, VkBufferUsageFlags usage)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    m_Usage = usage;
+    m_Stats = UploadRingStats();
+    m_Stats.capacity = sizePerFrame;
+
+    for (uint32_t i = 0; i < Vulkan::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        Chunk chunk;
+        if (!CreateChunk(sizePerFrame, chunk))
+        {
+            OutputDebugStringA("[UploadRing] Failed to create frame buffer\n");
+            m_bInitialized = true;
+            Shutdown();
+            return false;
+        }
+        m_Frames[i].chunks.push_back(chunk);
+    }
+
+    m_CurrentFrame = 0;
+    m_bInitialized = true;
+    return true;
+}
+
+void UploadRing::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    for (uint32_t i = 0; i < Vulkan::MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        for (Chunk& chunk : m_Frames[i].chunks) DestroyChunk(chunk);
+        m_Frames[i] = FrameRegion();
+    }
+
+    char msg[256];
+    sprintf_s(msg, "[UploadRing] Capacity %llu KB, high-water mark %llu KB, %u overflows, %llu allocations\n",
+        (unsigned long long)(m_Stats.capacity / 1024), (unsigned long long)(m_Stats.highWaterMark / 1024),
+        m_Stats.growCount, (unsigned long long)m_Stats.allocationCount);
+    OutputDebugStringA(msg);
+
+    m_bInitialized = false;
+}
+
+void UploadRing::BeginFrame(uint32_t frameIndex)
+{
+    m_Stats.lastFrameBytes = m_Frames[m_CurrentFrame].used;
+
+    m_CurrentFrame = frameIndex;
+    FrameRegion& region = m_Frames[m_CurrentFrame];
+
+    // The slot's fence has signalled, so every chunk it owns is idle. If the
+    // last use overflowed, fold the chunks into one buffer sized for the peak.
+    if (region.chunks.size() > 1 || region.chunks.back().size < m_Stats.capacity)
+    {
+        Chunk grown;
+        if (CreateChunk(m_Stats.capacity, grown))
+        {
+            for (Chunk& chunk : region.chunks) DestroyChunk(chunk);
+            region.chunks.clear();
+            region.chunks.push_back(grown);
+        }
+        else
+        {
+            // Keep using the old chunks; Allocate() will chain again if needed.
+            while (region.chunks.size() > 1)
+            {
+                DestroyChunk(region.chunks.back());
+                region.chunks.pop_back();
+            }
+        }
+    }
+
+    region.head = 0;
+    region.used = 0;
+}
+
+bool UploadRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, UploadAllocation& allocation)
+{
+    FrameRegion& region = m_Frames[m_CurrentFrame];
+
+    VkDeviceSize offset = (region.head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > region.chunks.back().size)
+    {
+        // Overflow: chain a chunk for the rest of this frame and raise the
+        // target capacity so the slot is rebuilt larger next time around.
+        VkDeviceSize newCapacity = m_Stats.capacity;
+        while (newCapacity < region.used + size) newCapacity *= 2;
+        newCapacity *= 2;
+
+        Chunk chunk;
+        if (!CreateChunk(newCapacity - region.used, chunk))
+        {
+            OutputDebugStringA("[UploadRing] Failed to grow upload ring\n");
+            return false;
+        }
+
+        region.chunks.push_back(chunk);
+        m_Stats.capacity = newCapacity;
+        m_Stats.growCount++;
+
+        char msg[128];
+        sprintf_s(msg, "[UploadRing] Frame overflowed, growing to %llu KB\n", (unsigned long long)(newCapacity / 1024));
+        OutputDebugStringA(msg);
+
+        // The new chunk starts empty; no alignment padding to count.
+        offset = 0;
+        region.used += size;
+    }
+    else
+    {
+        region.used += (offset - region.head) + size;
+    }
+
+    Chunk& chunk = region.chunks.back();
+    allocation.buffer = chunk.buffer;
+    allocation.offset = offset;
+    allocation.data = chunk.mapped + offset;
+
+    region.head = offset + size;
+
+    if (region.used > m_Stats.highWaterMark) m_Stats.highWaterMark = region.used;
+    m_Stats.allocationCount++;
+
+    return true;
+}
+
+bool UploadRing::CreateChunk(VkDeviceSize size, Chunk& chunk)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = m_Usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &chunk.buffer) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    Vulkan::MemoryAllocator& allocator = Vulkan::MemoryAllocator::GetInstance();
+    if (!allocator.AllocateForBuffer(chunk.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        Vulkan::ALLOCATION_MAPPED, chunk.memory) || !chunk.memory.mapped)
+    {
+        DestroyChunk(chunk);
+        return false;
+    }
+
+    chunk.mapped = static_cast<uint8_t*>(chunk.memory.mapped);
+    chunk.size = size;
+    return true;
+}
+
+void UploadRing::DestroyChunk(Chunk& chunk)
+{
+    if (chunk.buffer) vkDestroyBuffer(m_Device, chunk.buffer, nullptr);
+    Vulkan::MemoryAllocator::GetInstance().Free(chunk.memory);
+    chunk = Chunk();
+}
+
+} // namespace Bridge
@@ -0,0 +1,430 @@
+#include "../include/platform.h"
+#include "../include/upload_scheduler.h"
+#include "../include/deletion_queue.h"
+#include "../include/frame_scheduler.h"
+#include <cstring>
+
+namespace {
+
+// Multiple of every uncompressed texel size used and of the 8/16-byte
+// block-compressed formats, as vkCmdCopyBufferToImage requires.
+const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+} // namespace
+
+namespace Vulkan {
+
+UploadScheduler& UploadScheduler::GetInstance()
+{
+    static UploadScheduler instance;
+    return instance;
+}
+
+bool UploadScheduler::Initialize(VkDevice device, VkQueue queue, uint32_t queueFamily, uint32_t graphicsFamily)
+{
+    if (m_bInitialized) return true;
+
+    m_Device = device;
+    m_Queue = queue;
+    m_QueueFamily = queueFamily;
+    m_GraphicsFamily = graphicsFamily;
+    m_bTimeline = FrameScheduler::GetInstance().IsEnabled();
+    m_bInitialized = true;
+
+    for (Batch& batch : m_Batches)
+    {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = m_QueueFamily;
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = BATCH_STAGING_SIZE;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &batch.commandPool) != VK_SUCCESS ||
+            (!m_bTimeline && vkCreateFence(m_Device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) ||
+            vkCreateBuffer(m_Device, &bufferInfo, nullptr, &batch.stagingBuffer) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[UploadScheduler] Failed to create batch\n");
+            Shutdown();
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = batch.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_Device, &allocInfo, &batch.commandBuffer) != VK_SUCCESS ||
+            !MemoryAllocator::GetInstance().AllocateForBuffer(batch.stagingBuffer,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, ALLOCATION_MAPPED, batch.stagingMemory))
+        {
+            OutputDebugStringA("[UploadScheduler] Failed to create batch\n");
+            Shutdown();
+            return false;
+        }
+    }
+
+    char msg[160];
+    sprintf_s(msg, "[UploadScheduler] %u batches of %llu MB on queue family %u%s\n", BATCH_COUNT,
+        (unsigned long long)(BATCH_STAGING_SIZE / (1024 * 1024)), m_QueueFamily,
+        IsOwnershipTransfer() ? " (dedicated transfer)" : " (graphics)");
+    OutputDebugStringA(msg);
+    return true;
+}
+
+void UploadScheduler::Shutdown()
+{
+    if (!m_bInitialized) return;
+
+    // The device is idle; unconsumed semaphores were never waited on.
+    for (Batch& batch : m_Batches)
+    {
+        if (batch.commandPool) vkDestroyCommandPool(m_Device, batch.commandPool, nullptr);
+        if (batch.fence) vkDestroyFence(m_Device, batch.fence, nullptr);
+        if (batch.stagingBuffer) vkDestroyBuffer(m_Device, batch.stagingBuffer, nullptr);
+        MemoryAllocator::GetInstance().Free(batch.stagingMemory);
+        batch = Batch();
+    }
+
+    for (VkSemaphore semaphore : m_PendingSemaphores) vkDestroySemaphore(m_Device, semaphore, nullptr);
+    for (VkSemaphore semaphore : m_FrameSemaphores) vkDestroySemaphore(m_Device, semaphore, nullptr);
+    m_PendingSemaphores.clear();
+    m_FrameSemaphores.clear();
+    m_PendingAcquires.clear();
+    m_PendingValue = 0;
+    m_FrameValue = 0;
+
+    char msg[160];
+    sprintf_s(msg, "[UploadScheduler] %llu uploads, %.1f MB in %u batches, %u stalls\n",
+        (unsigned long long)m_Stats.uploadCount, m_Stats.uploadBytes / (1024.0 * 1024.0),
+        m_Stats.batchCount, m_Stats.stallCount);
+    OutputDebugStringA(msg);
+
+    m_Device = VK_NULL_HANDLE;
+    m_Queue = VK_NULL_HANDLE;
+    m_CurrentBatch = 0;
+    m_bBatchOpen = false;
+    m_NextTicket = 1;
+    m_ReadyTicket = 0;
+    m_Stats = UploadSchedulerStats();
+    m_bTimeline = false;
+    m_bInitialized = false;
+}
+
+UploadTicket UploadScheduler::UploadImage(const ImageUpload& upload)
+{
+    if (!m_bInitialized || !upload.image || !upload.data) return 0;
+
+    const bool convert = upload.sourceFormat != Bridge::TEXTURE_FORMAT_RAW;
+    if (convert && upload.sourceFormat == Bridge::TEXTURE_FORMAT_P8 && !upload.palette) return 0;
+    const VkDeviceSize size = convert ? (VkDeviceSize)upload.width * upload.height * sizeof(uint32_t) : upload.size;
+
+    if (size > BATCH_STAGING_SIZE)
+    {
+        OutputDebugStringA("[UploadScheduler] Upload larger than a staging batch\n");
+        return 0;
+    }
+
+    // Locked rectangles can have padded rows; raw ones are packed row by
+    // row, so staging and the copy region stay tight.
+    const uint32_t rowCount = upload.blockSize ? (upload.height + upload.blockSize - 1) / upload.blockSize : 0;
+    const VkDeviceSize rowBytes = rowCount ? size / rowCount : 0;
+    if (!convert && upload.sourcePitch != 0 &&
+        (rowCount == 0 || rowBytes * rowCount != size || upload.sourcePitch < rowBytes))
+    {
+        OutputDebugStringA("[UploadScheduler] Source pitch does not match the upload size\n");
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    VkDeviceSize offset = 0;
+    if (m_bBatchOpen)
+    {
+        Batch& current = m_Batches[m_CurrentBatch];
+        offset = (current.used + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        if (offset + size > BATCH_STAGING_SIZE)
+        {
+            SubmitBatch();
+            offset = 0;
+        }
+    }
+    if (!m_bBatchOpen && !OpenBatch()) return 0;
+
+    Batch& batch = m_Batches[m_CurrentBatch];
+    uint8_t* staging = static_cast<uint8_t*>(batch.stagingMemory.mapped) + offset;
+    if (convert)
+    {
+        Bridge::ConvertTexture(upload.sourceFormat, upload.texelOrder, upload.data, upload.sourcePitch,
+                       reinterpret_cast<uint32_t*>(staging), upload.width, upload.height, upload.palette);
+    }
+    else if (upload.sourcePitch == 0 || upload.sourcePitch == rowBytes)
+    {
+        memcpy(staging, upload.data, (size_t)size);
+    }
+    else
+    {
+        const uint8_t* row = static_cast<const uint8_t*>(upload.data);
+        for (uint32_t y = 0; y < rowCount; y++)
+        {
+            memcpy(staging + y * rowBytes, row, (size_t)rowBytes);
+            row += upload.sourcePitch;
+        }
+    }
+    batch.used = offset + size;
+    batch.uploadCount++;
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = upload.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = upload.mipLevel;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    // Whole mip levels only, which is valid for any image transfer
+    // granularity a transfer-only family may report.
+    VkBufferImageCopy region = {};
+    region.bufferOffset = offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = upload.mipLevel;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {upload.width, upload.height, 1};
+
+    vkCmdCopyBufferToImage(batch.commandBuffer, batch.stagingBuffer, upload.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // Release to the graphics family. The same barrier, recorded on the
+    // graphics queue, is the acquire.
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    if (IsOwnershipTransfer())
+    {
+        barrier.srcQueueFamilyIndex = m_QueueFamily;
+        barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+    }
+
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    if (IsOwnershipTransfer())
+    {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        m_PendingAcquires.push_back(barrier);
+    }
+
+    m_Stats.uploadCount++;
+    m_Stats.uploadBytes += size;
+    return m_NextTicket++;
+}
+
+void UploadScheduler::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_bBatchOpen) SubmitBatch();
+}
+
+bool UploadScheduler::IsReady(UploadTicket ticket)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return ticket != 0 && ticket <= m_ReadyTicket;
+}
+
+void UploadScheduler::BeginFrame(VkCommandBuffer commandBuffer)
+{
+    if (!m_bInitialized) return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_bBatchOpen) SubmitBatch();
+
+    // Source and destination are the stage the frame's semaphore wait
+    // blocks, which chains the acquire to the transfer queue's signal.
+    if (!m_PendingAcquires.empty() && m_bTimeline)
+    {
+        std::vector<VkImageMemoryBarrier2> acquires(m_PendingAcquires.size());
+        for (size_t i = 0; i < acquires.size(); i++)
+        {
+            const VkImageMemoryBarrier& pending = m_PendingAcquires[i];
+            VkImageMemoryBarrier2& acquire = acquires[i];
+            acquire.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            acquire.srcStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+            acquire.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+            acquire.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+            acquire.oldLayout = pending.oldLayout;
+            acquire.newLayout = pending.newLayout;
+            acquire.srcQueueFamilyIndex = pending.srcQueueFamilyIndex;
+            acquire.dstQueueFamilyIndex = pending.dstQueueFamilyIndex;
+            acquire.image = pending.image;
+            acquire.subresourceRange = pending.subresourceRange;
+        }
+
+        VkDependencyInfo dependency = {};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.imageMemoryBarrierCount = (uint32_t)acquires.size();
+        dependency.pImageMemoryBarriers = acquires.data();
+        FrameScheduler::GetInstance().Barrier(commandBuffer, dependency);
+        m_PendingAcquires.clear();
+    }
+    else if (!m_PendingAcquires.empty())
+    {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, (uint32_t)m_PendingAcquires.size(), m_PendingAcquires.data());
+        m_PendingAcquires.clear();
+    }
+
+    m_FrameSemaphores.insert(m_FrameSemaphores.end(), m_PendingSemaphores.begin(), m_PendingSemaphores.end());
+    m_PendingSemaphores.clear();
+    if (m_PendingValue != 0)
+    {
+        m_FrameValue = m_PendingValue;
+        m_PendingValue = 0;
+    }
+    m_ReadyTicket = m_NextTicket - 1;
+}
+
+void UploadScheduler::TakeWaitSemaphores(std::vector<VkSemaphore>& semaphores)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    DeletionQueue& deletionQueue = DeletionQueue::GetInstance();
+    for (VkSemaphore& semaphore : m_FrameSemaphores)
+    {
+        semaphores.push_back(semaphore);
+        deletionQueue.DestroySemaphore(semaphore);
+    }
+    m_FrameSemaphores.clear();
+}
+
+uint64_t UploadScheduler::TakeWaitValue()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    uint64_t value = m_FrameValue;
+    m_FrameValue = 0;
+    return value;
+}
+
+bool UploadScheduler::OpenBatch()
+{
+    uint32_t index = (m_CurrentBatch + 1) % BATCH_COUNT;
+    Batch& batch = m_Batches[index];
+
+    if (batch.submitted && m_bTimeline)
+    {
+        FrameScheduler& scheduler = FrameScheduler::GetInstance();
+        if (!scheduler.IsComplete(m_Queue, batch.timelineValue))
+        {
+            m_Stats.stallCount++;
+            scheduler.Wait(m_Queue, batch.timelineValue);
+        }
+        batch.submitted = false;
+    }
+    else if (batch.submitted)
+    {
+        if (vkGetFenceStatus(m_Device, batch.fence) != VK_SUCCESS)
+        {
+            m_Stats.stallCount++;
+            vkWaitForFences(m_Device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+        }
+        vkResetFences(m_Device, 1, &batch.fence);
+        batch.submitted = false;
+    }
+
+    vkResetCommandPool(m_Device, batch.commandPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UploadScheduler] Failed to begin batch\n");
+        return false;
+    }
+
+    batch.used = 0;
+    batch.uploadCount = 0;
+    m_CurrentBatch = index;
+    m_bBatchOpen = true;
+    return true;
+}
+
+void UploadScheduler::SubmitBatch()
+{
+    Batch& batch = m_Batches[m_CurrentBatch];
+    m_bBatchOpen = false;
+
+    if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UploadScheduler] Failed to record batch\n");
+        return;
+    }
+
+    if (m_bTimeline)
+    {
+        uint64_t value = FrameScheduler::GetInstance().Submit(m_Queue, nullptr, 0, batch.commandBuffer, VK_NULL_HANDLE);
+        if (value == 0)
+        {
+            OutputDebugStringA("[UploadScheduler] Failed to submit batch\n");
+            return;
+        }
+
+        batch.timelineValue = value;
+        batch.submitted = true;
+        m_PendingValue = value;
+        m_Stats.batchCount++;
+        return;
+    }
+
+    // A fresh binary semaphore per batch: the frame that waits on it may
+    // still be in flight when this batch slot is reused.
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UploadScheduler] Failed to create semaphore\n");
+        return;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &semaphore;
+
+    if (vkQueueSubmit(m_Queue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[UploadScheduler] Failed to submit batch\n");
+        vkDestroySemaphore(m_Device, semaphore, nullptr);
+        return;
+    }
+
+    batch.submitted = true;
+    m_PendingSemaphores.push_back(semaphore);
+    m_Stats.batchCount++;
+}
+
+} // namespace Vulkan
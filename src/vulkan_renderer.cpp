@@ -1,7 +1,19 @@
-#include <windows.h>
+#include "../include/platform.h"
 #include "../include/vulkan_renderer.h"
+#include "../include/pipeline_cache.h"
+#include "../include/gpu_profiler.h"
+#include "../include/frame_stats.h"
+#include "../include/memory_allocator.h"
+#include "../include/deletion_queue.h"
+#include "../include/dynamic_rendering.h"
+#include "../include/frame_scheduler.h"
+#include "../include/upload_scheduler.h"
+#include "../include/scene_recorder.h"
+#include "../include/post_processing.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
 #include <set>
 #include <vector>
 
@@ -13,12 +25,45 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+Vulkan::Renderer& Vulkan::Renderer::GetInstance()
+{
+    static Renderer instance;
+    return instance;
+}
+
+bool Vulkan::Renderer::InitializeHeadless(uint32_t width, uint32_t height, bool enableReadback)
+{
+    if (m_bInitialized) return true;
+
+    m_bHeadless = true;
+    m_bReadback = enableReadback;
+    return Initialize(nullptr, width, height);
+}
+
 bool Vulkan::Renderer::Initialize(HWND hwnd, uint32_t width, uint32_t height)
 {
     if (m_bInitialized) return true;
 
+    if (hwnd == nullptr && !m_bHeadless)
+    {
+        OutputDebugStringA("[VulkanRenderer] No window given; use InitializeHeadless for offscreen rendering\n");
+        return false;
+    }
+
+    Config::ConfigManager::GetInstance().EnsureLoaded();
+    m_Config = Config::ConfigManager::GetInstance().GetRenderer();
+    m_bVSyncEnabled = m_Config.enableVSync;
+    const Config::PerformanceSettings& performance = Config::ConfigManager::GetInstance().GetPerformance();
+    m_bShowGpuProfiler = performance.showGpuProfiler;
+    m_FrameStatsPath = performance.frameStatsPath;
+    m_FrameStatsHotkey = performance.frameStatsHotkey;
+
     m_Width = width;
     m_Height = height;
+    m_FramesInFlight = m_Config.framesInFlight;
+    if (m_FramesInFlight < 1) m_FramesInFlight = 1;
+    if (m_FramesInFlight > MAX_FRAMES_IN_FLIGHT) m_FramesInFlight = MAX_FRAMES_IN_FLIGHT;
+    m_CurrentFrame = 0;
 
     OutputDebugStringA("[VulkanRenderer] Initializing...\n");
 
@@ -28,13 +73,47 @@ bool Vulkan::Renderer::Initialize(HWND hwnd, uint32_t width, uint32_t height)
         return false;
     }
 
+    if (!m_bHeadless && !CreateSurface(hwnd))
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create surface\n");
+        return false;
+    }
+
     if (!CreateDevice(hwnd))
     {
         OutputDebugStringA("[VulkanRenderer] Failed to create device\n");
         return false;
     }
 
-    if (!CreateSwapChain(width, height))
+    if (!MemoryAllocator::GetInstance().Initialize(m_VkDevice, m_VkPhysicalDevice))
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create memory allocator\n");
+        return false;
+    }
+
+    DeletionQueue::GetInstance().Initialize(m_VkDevice, m_FramesInFlight);
+
+    if (!UploadScheduler::GetInstance().Initialize(m_VkDevice, m_VkTransferQueue, m_TransferQueueFamily, m_GraphicsQueueFamily))
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create upload scheduler\n");
+        return false;
+    }
+
+    if (!PipelineCache::GetInstance().Initialize(m_VkDevice, m_VkPhysicalDevice, m_Config.pipelineCachePath))
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create pipeline cache\n");
+        return false;
+    }
+
+    if (m_bHeadless)
+    {
+        if (!CreateOffscreenTargets(width, height))
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create offscreen targets\n");
+            return false;
+        }
+    }
+    else if (!CreateSwapChain(width, height))
     {
         OutputDebugStringA("[VulkanRenderer] Failed to create swap chain\n");
         return false;
@@ -70,6 +149,15 @@ bool Vulkan::Renderer::Initialize(HWND hwnd, uint32_t width, uint32_t height)
         return false;
     }
 
+    if (!SceneRecorder::GetInstance().Initialize(m_VkDevice, m_GraphicsQueueFamily, m_FramesInFlight, performance.recordingThreads))
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create scene recorder\n");
+        return false;
+    }
+
+    // Timing is optional; the renderer works without timestamp support.
+    GpuProfiler::GetInstance().Initialize(m_VkDevice, m_VkPhysicalDevice, m_GraphicsQueueFamily, m_FramesInFlight);
+
     if (!CreateShaders())
     {
         OutputDebugStringA("[VulkanRenderer] Failed to create shaders\n");
@@ -93,26 +181,78 @@ void Vulkan::Renderer::Shutdown()
 
     vkDeviceWaitIdle(m_VkDevice);
 
-    if (m_VkInFlightFence) vkDestroyFence(m_VkDevice, m_VkInFlightFence, nullptr);
-    if (m_VkRenderFinishedSemaphore) vkDestroySemaphore(m_VkDevice, m_VkRenderFinishedSemaphore, nullptr);
-    if (m_VkImageAvailableSemaphore) vkDestroySemaphore(m_VkDevice, m_VkImageAvailableSemaphore, nullptr);
+    if (!m_FrameStatsPath.empty()) FrameStats::GetInstance().DumpCsv(m_FrameStatsPath);
+
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    {
+        FrameData& frame = m_Frames[i];
+        if (frame.inFlightFence) vkDestroyFence(m_VkDevice, frame.inFlightFence, nullptr);
+        if (frame.renderFinishedSemaphore) vkDestroySemaphore(m_VkDevice, frame.renderFinishedSemaphore, nullptr);
+        if (frame.imageAvailableSemaphore) vkDestroySemaphore(m_VkDevice, frame.imageAvailableSemaphore, nullptr);
+    }
+
+    DeletionQueue::GetInstance().Flush();
+    CleanupSwapChain();
 
-    for (auto framebuffer : m_Framebuffers) vkDestroyFramebuffer(m_VkDevice, framebuffer, nullptr);
     if (m_VkPipeline) vkDestroyPipeline(m_VkDevice, m_VkPipeline, nullptr);
     if (m_VkPipelineLayout) vkDestroyPipelineLayout(m_VkDevice, m_VkPipelineLayout, nullptr);
     if (m_VkRenderPass) vkDestroyRenderPass(m_VkDevice, m_VkRenderPass, nullptr);
     if (m_VkFragmentShader) vkDestroyShaderModule(m_VkDevice, m_VkFragmentShader, nullptr);
     if (m_VkVertexShader) vkDestroyShaderModule(m_VkDevice, m_VkVertexShader, nullptr);
 
-    vkFreeCommandBuffers(m_VkDevice, m_VkCommandPool, 1, &m_VkCommandBuffer);
-    vkDestroyCommandPool(m_VkDevice, m_VkCommandPool, nullptr);
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    {
+        FrameData& frame = m_Frames[i];
+        if (frame.commandBuffer) vkFreeCommandBuffers(m_VkDevice, frame.commandPool, 1, &frame.commandBuffer);
+        if (frame.commandPool) vkDestroyCommandPool(m_VkDevice, frame.commandPool, nullptr);
+        frame = FrameData();
+    }
+
+    if (m_bHeadless)
+    {
+        for (size_t i = 0; i < m_SwapChainImages.size(); i++)
+        {
+            vkDestroyImage(m_VkDevice, m_SwapChainImages[i], nullptr);
+            MemoryAllocator::GetInstance().Free(m_OffscreenMemory[i]);
+        }
+        m_OffscreenMemory.clear();
 
-    for (auto imageView : m_SwapChainImageViews) vkDestroyImageView(m_VkDevice, imageView, nullptr);
-    if (m_VkSwapChain) vkDestroySwapchainKHR(m_VkDevice, m_VkSwapChain, nullptr);
+        for (uint32_t i = 0; i < m_FramesInFlight; i++)
+        {
+            if (m_ReadbackBuffers[i]) vkDestroyBuffer(m_VkDevice, m_ReadbackBuffers[i], nullptr);
+            m_ReadbackBuffers[i] = VK_NULL_HANDLE;
+            MemoryAllocator::GetInstance().Free(m_ReadbackMemory[i]);
+        }
+    }
+    m_SwapChainImages.clear();
+
+    SceneRecorder::GetInstance().Shutdown();
+    DynamicRendering::GetInstance().Shutdown();
+    FrameScheduler::GetInstance().Shutdown();
+    GpuProfiler::GetInstance().Shutdown();
+    PipelineCache::GetInstance().Shutdown();
+    UploadScheduler::GetInstance().Shutdown();
+    DeletionQueue::GetInstance().Shutdown();
+    MemoryAllocator::GetInstance().Shutdown();
 
     vkDestroyDevice(m_VkDevice, nullptr);
+    if (m_VkSurface) vkDestroySurfaceKHR(m_VkInstance, m_VkSurface, nullptr);
     vkDestroyInstance(m_VkInstance, nullptr);
 
+    m_VkDevice = VK_NULL_HANDLE;
+    m_VkSurface = VK_NULL_HANDLE;
+    m_VkInstance = VK_NULL_HANDLE;
+    m_VkSwapChain = VK_NULL_HANDLE;
+    m_VkPhysicalDevice = VK_NULL_HANDLE;
+    m_VkGraphicsQueue = VK_NULL_HANDLE;
+    m_VkTransferQueue = VK_NULL_HANDLE;
+    m_LastSubmittedFrame = UINT32_MAX;
+    m_SubmittedFrames = 0;
+    m_bSwapChainDirty = false;
+    m_bDynamicRendering = false;
+    m_bTimelineScheduler = false;
+    m_bHeadless = false;
+    m_bReadback = false;
     m_bInitialized = false;
     OutputDebugStringA("[VulkanRenderer] Shutdown complete\n");
 }
@@ -125,7 +265,20 @@ bool Vulkan::Renderer::CreateInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "OFPEngine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    // Dynamic rendering and timeline semaphores need Vulkan 1.2 or later,
+    // so ask the loader for up to 1.3. Otherwise everything runs on 1.0
+    // with render passes and fences.
+    m_InstanceVersion = VK_API_VERSION_1_0;
+    if (m_Config.dynamicRendering || m_Config.timelineSemaphores)
+    {
+        PFN_vkEnumerateInstanceVersion enumerateInstanceVersion =
+            (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        if (enumerateInstanceVersion) enumerateInstanceVersion(&loaderVersion);
+        if (loaderVersion >= VK_API_VERSION_1_2) m_InstanceVersion = std::min(loaderVersion, (uint32_t)VK_API_VERSION_1_3);
+    }
+    appInfo.apiVersion = m_InstanceVersion;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -137,8 +290,13 @@ bool Vulkan::Renderer::CreateInstance()
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
     std::vector<const char*> requiredExtensions;
-    requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
-    requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+    if (!m_bHeadless)
+    {
+        requiredExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+        requiredExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+    }
 
     createInfo.enabledExtensionCount = (uint32_t)requiredExtensions.size();
     createInfo.ppEnabledExtensionNames = requiredExtensions.data();
@@ -162,8 +320,33 @@ bool Vulkan::Renderer::CreateInstance()
     return true;
 }
 
+bool Vulkan::Renderer::CreateSurface(HWND hwnd)
+{
+#ifdef VK_USE_PLATFORM_WIN32_KHR
+    VkWin32SurfaceCreateInfoKHR createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+    createInfo.hinstance = GetModuleHandle(nullptr);
+    createInfo.hwnd = hwnd;
+
+    if (vkCreateWin32SurfaceKHR(m_VkInstance, &createInfo, nullptr, &m_VkSurface) != VK_SUCCESS)
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to create Win32 surface\n");
+        return false;
+    }
+
+    return true;
+#else
+    (void)hwnd;
+    OutputDebugStringA("[VulkanRenderer] Window surfaces are only supported on Windows\n");
+    return false;
+#endif
+}
+
 bool Vulkan::Renderer::CreateDevice(HWND hwnd)
 {
+    // Presentation support is queried through m_VkSurface instead.
+    (void)hwnd;
+
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(m_VkInstance, &deviceCount, nullptr);
     if (deviceCount == 0)
@@ -207,18 +390,21 @@ bool Vulkan::Renderer::CreateDevice(HWND hwnd)
     int graphicsFamily = -1;
     int presentFamily = -1;
 
-    for (int i = 0; i < queueFamilyCount; i++)
+    for (int i = 0; i < (int)queueFamilyCount; i++)
     {
         if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
         {
             graphicsFamily = i;
         }
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(m_VkPhysicalDevice, i, m_VkSurface, &presentSupport);
-        if (presentSupport)
+        if (m_VkSurface != VK_NULL_HANDLE)
         {
-            presentFamily = i;
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(m_VkPhysicalDevice, i, m_VkSurface, &presentSupport);
+            if (presentSupport)
+            {
+                presentFamily = i;
+            }
         }
     }
 
@@ -228,8 +414,28 @@ bool Vulkan::Renderer::CreateDevice(HWND hwnd)
         return false;
     }
 
+    // A transfer family without graphics runs on the copy engines. Prefer
+    // one without compute too; an async compute family is the fallback.
+    int transferFamily = -1;
+    if (m_Config.asyncTransfer)
+    {
+        for (int i = 0; i < (int)queueFamilyCount; i++)
+        {
+            VkQueueFlags flags = queueFamilies[i].queueFlags;
+            if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+            if (!(flags & VK_QUEUE_COMPUTE_BIT))
+            {
+                transferFamily = i;
+                break;
+            }
+            if (transferFamily == -1) transferFamily = i;
+        }
+    }
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<int> uniqueQueueFamilies = {graphicsFamily, presentFamily};
+    std::set<int> uniqueQueueFamilies = {graphicsFamily};
+    if (presentFamily != -1) uniqueQueueFamilies.insert(presentFamily);
+    if (transferFamily != -1) uniqueQueueFamilies.insert(transferFamily);
 
     float queuePriority = 1.0f;
     for (int queueFamily : uniqueQueueFamilies)
@@ -242,16 +448,94 @@ bool Vulkan::Renderer::CreateDevice(HWND hwnd)
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures = {};
+    vkGetPhysicalDeviceFeatures(m_VkPhysicalDevice, &supportedFeatures);
+    m_bTextureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = m_Config.enableAnisotropy ? VK_TRUE : VK_FALSE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+    std::vector<const char*> extensions;
+    if (!m_bHeadless) extensions = deviceExtensions;
+
+    // Dynamic rendering and synchronization2 are core in 1.3. On 1.2 they
+    // are extensions whose dependencies are all core already, as are
+    // timeline semaphores.
+    uint32_t apiVersion = std::min(properties.apiVersion, m_InstanceVersion);
+    bool core13 = apiVersion >= VK_API_VERSION_1_3;
+    bool dynamicRenderingExtension = false;
+    bool synchronization2Extension = false;
+    if (apiVersion >= VK_API_VERSION_1_2 && !core13)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(m_VkPhysicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> available(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_VkPhysicalDevice, nullptr, &extensionCount, available.data());
+
+        for (const VkExtensionProperties& extension : available)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0) dynamicRenderingExtension = true;
+            if (strcmp(extension.extensionName, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0) synchronization2Extension = true;
+        }
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures = {};
+    timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceSynchronization2Features synchronization2Features = {};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+
+    // Query only the features of supported versions and extensions, then
+    // chain only the ones that will be used into the device.
+    void* featureChain = nullptr;
+    if (m_Config.dynamicRendering && (core13 || dynamicRenderingExtension))
+    {
+        dynamicRenderingFeatures.pNext = featureChain;
+        featureChain = &dynamicRenderingFeatures;
+    }
+    if (m_Config.timelineSemaphores && (core13 || synchronization2Extension))
+    {
+        timelineSemaphoreFeatures.pNext = featureChain;
+        synchronization2Features.pNext = &timelineSemaphoreFeatures;
+        featureChain = &synchronization2Features;
+    }
+    if (featureChain)
+    {
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = featureChain;
+        vkGetPhysicalDeviceFeatures2(m_VkPhysicalDevice, &features2);
+    }
+
+    bool dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    bool timelineScheduler = timelineSemaphoreFeatures.timelineSemaphore == VK_TRUE &&
+                             synchronization2Features.synchronization2 == VK_TRUE;
+
+    featureChain = nullptr;
+    if (dynamicRendering)
+    {
+        dynamicRenderingFeatures.pNext = featureChain;
+        featureChain = &dynamicRenderingFeatures;
+        if (dynamicRenderingExtension) extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+    if (timelineScheduler)
+    {
+        timelineSemaphoreFeatures.pNext = featureChain;
+        synchronization2Features.pNext = &timelineSemaphoreFeatures;
+        featureChain = &synchronization2Features;
+        if (synchronization2Extension) extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = featureChain;
     createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = (uint32_t)deviceExtensions.size();
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = (uint32_t)extensions.size();
+    createInfo.ppEnabledExtensionNames = extensions.empty() ? nullptr : extensions.data();
 
     if (m_Config.enableValidation)
     {
@@ -270,13 +554,34 @@ bool Vulkan::Renderer::CreateDevice(HWND hwnd)
     }
 
     vkGetDeviceQueue(m_VkDevice, graphicsFamily, 0, &m_VkGraphicsQueue);
+    m_GraphicsQueueFamily = (uint32_t)graphicsFamily;
+
+    m_bDynamicRendering = dynamicRendering && DynamicRendering::GetInstance().Initialize(m_VkDevice, core13);
+
+    // Without a transfer family, uploads share the graphics queue.
+    if (transferFamily != -1)
+    {
+        vkGetDeviceQueue(m_VkDevice, transferFamily, 0, &m_VkTransferQueue);
+        m_TransferQueueFamily = (uint32_t)transferFamily;
+    }
+    else
+    {
+        m_VkTransferQueue = m_VkGraphicsQueue;
+        m_TransferQueueFamily = m_GraphicsQueueFamily;
+    }
+
+    // Both queues draw their values from the scheduler's one counter.
+    FrameScheduler& scheduler = FrameScheduler::GetInstance();
+    m_bTimelineScheduler = timelineScheduler && scheduler.Initialize(m_VkDevice, core13) &&
+                           scheduler.AddQueue(m_VkGraphicsQueue) && scheduler.AddQueue(m_VkTransferQueue);
+    if (timelineScheduler && !m_bTimelineScheduler) scheduler.Shutdown();
 
     return true;
 }
 
 bool Vulkan::Renderer::CreateSwapChain(UINT width, UINT height)
 {
-    VkSurfaceCapabilities capabilities;
+    VkSurfaceCapabilitiesKHR capabilities;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_VkPhysicalDevice, m_VkSurface, &capabilities);
 
     uint32_t formatCount = 0;
@@ -294,9 +599,18 @@ bool Vulkan::Renderer::CreateSwapChain(UINT width, UINT height)
         }
     }
 
-    VkExtent2D extent = {};
-    extent.width = width;
-    extent.height = height;
+    // Most platforms dictate the extent; the requested size only matters
+    // where the surface leaves it to the swap chain.
+    VkExtent2D extent = capabilities.currentExtent;
+    if (extent.width == UINT32_MAX)
+    {
+        extent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, (uint32_t)width));
+        extent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, (uint32_t)height));
+    }
+    if (extent.width == 0 || extent.height == 0)
+    {
+        return false;
+    }
 
     uint32_t imageCount = capabilities.minImageCount + 1;
     if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
@@ -318,13 +632,21 @@ bool Vulkan::Renderer::CreateSwapChain(UINT width, UINT height)
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = m_bVSyncEnabled ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR;
     createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = m_VkSwapChain;
 
-    if (vkCreateSwapchainKHR(m_VkDevice, &createInfo, nullptr, &m_VkSwapChain) != VK_SUCCESS)
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    if (vkCreateSwapchainKHR(m_VkDevice, &createInfo, nullptr, &swapChain) != VK_SUCCESS)
     {
         OutputDebugStringA("[VulkanRenderer] Failed to create swap chain\n");
         return false;
     }
 
+    m_VkSwapChain = swapChain;
+    m_SurfaceFormat = surfaceFormat;
+    m_SwapChainExtent = extent;
+    m_Width = extent.width;
+    m_Height = extent.height;
+
     vkGetSwapchainImagesKHR(m_VkDevice, m_VkSwapChain, &imageCount, nullptr);
     m_SwapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(m_VkDevice, m_VkSwapChain, &imageCount, m_SwapChainImages.data());
@@ -357,17 +679,143 @@ bool Vulkan::Renderer::CreateSwapChain(UINT width, UINT height)
     return true;
 }
 
+bool Vulkan::Renderer::CreateOffscreenTargets(uint32_t width, uint32_t height)
+{
+    // One target per frame slot stands in for the swap chain images, so
+    // frame N always renders into image N and never waits on another slot.
+    m_SurfaceFormat.format = VK_FORMAT_B8G8R8A8_SRGB;
+    m_SurfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    m_SwapChainExtent.width = width;
+    m_SwapChainExtent.height = height;
+
+    MemoryAllocator& allocator = MemoryAllocator::GetInstance();
+
+    m_SwapChainImages.assign(m_FramesInFlight, VK_NULL_HANDLE);
+    m_SwapChainImageViews.assign(m_FramesInFlight, VK_NULL_HANDLE);
+    m_OffscreenMemory.assign(m_FramesInFlight, Allocation());
+
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_SurfaceFormat.format;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (vkCreateImage(m_VkDevice, &imageInfo, nullptr, &m_SwapChainImages[i]) != VK_SUCCESS ||
+            !allocator.AllocateForImage(m_SwapChainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ALLOCATION_DEDICATED, m_OffscreenMemory[i]))
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create offscreen image\n");
+            return false;
+        }
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_SwapChainImages[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_SurfaceFormat.format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(m_VkDevice, &viewInfo, nullptr, &m_SwapChainImageViews[i]) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create offscreen image view\n");
+            return false;
+        }
+
+        if (!m_bReadback) continue;
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = (VkDeviceSize)width * height * 4;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(m_VkDevice, &bufferInfo, nullptr, &m_ReadbackBuffers[i]) != VK_SUCCESS ||
+            !allocator.AllocateForBuffer(m_ReadbackBuffers[i], VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                ALLOCATION_DEDICATED | ALLOCATION_MAPPED, m_ReadbackMemory[i]))
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create readback buffer\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Vulkan::Renderer::ReadbackFrame(std::vector<uint8_t>& pixels)
+{
+    if (!m_bReadback || m_LastSubmittedFrame == UINT32_MAX) return false;
+
+    WaitForFrameSlot(m_LastSubmittedFrame);
+
+    const Allocation& memory = m_ReadbackMemory[m_LastSubmittedFrame];
+    size_t size = (size_t)m_Width * m_Height * 4;
+    pixels.resize(size);
+    memcpy(pixels.data(), memory.mapped, size);
+    return true;
+}
+
+void Vulkan::Renderer::WaitForFrameSlot(uint32_t slot)
+{
+    const FrameData& frame = m_Frames[slot];
+    if (m_bTimelineScheduler)
+    {
+        FrameScheduler::GetInstance().Wait(m_VkGraphicsQueue, frame.timelineValue);
+    }
+    else
+    {
+        vkWaitForFences(m_VkDevice, 1, &frame.inFlightFence, VK_TRUE, UINT64_MAX);
+    }
+}
+
+void Vulkan::Renderer::RecordReadback(VkCommandBuffer commandBuffer)
+{
+    // The scene pass leaves the image in TRANSFER_SRC_OPTIMAL; make the
+    // color writes visible to the copy and the copy visible to the host.
+    VkMemoryBarrier toTransfer = {};
+    toTransfer.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &toTransfer, 0, nullptr, 0, nullptr);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {m_Width, m_Height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, m_SwapChainImages[m_ImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        m_ReadbackBuffers[m_CurrentFrame], 1, &region);
+
+    VkMemoryBarrier toHost = {};
+    toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &toHost, 0, nullptr, 0, nullptr);
+}
+
 bool Vulkan::Renderer::CreateRenderPass()
 {
+    if (m_bDynamicRendering) return true;
+
     VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = VK_FORMAT_B8G8R8A8_SRGB;
+    colorAttachment.format = m_SurfaceFormat.format;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = m_bHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
@@ -406,6 +854,8 @@ bool Vulkan::Renderer::CreateRenderPass()
 
 bool Vulkan::Renderer::CreateFramebuffers()
 {
+    if (m_bDynamicRendering) return true;
+
     m_Framebuffers.resize(m_SwapChainImageViews.size());
 
     for (size_t i = 0; i < m_SwapChainImageViews.size(); i++)
@@ -435,13 +885,18 @@ bool Vulkan::Renderer::CreateCommandPool()
 {
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = 0;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_GraphicsQueueFamily;
 
-    if (vkCreateCommandPool(m_VkDevice, &poolInfo, nullptr, &m_VkCommandPool) != VK_SUCCESS)
+    // One pool per frame slot: BeginFrame resets the whole pool instead of
+    // individual command buffers.
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
     {
-        OutputDebugStringA("[VulkanRenderer] Failed to create command pool\n");
-        return false;
+        if (vkCreateCommandPool(m_VkDevice, &poolInfo, nullptr, &m_Frames[i].commandPool) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create command pool\n");
+            return false;
+        }
     }
 
     return true;
@@ -449,16 +904,19 @@ bool Vulkan::Renderer::CreateCommandPool()
 
 bool Vulkan::Renderer::CreateCommandBuffer()
 {
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_VkCommandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = 1;
-
-    if (vkAllocateCommandBuffers(m_VkDevice, &allocInfo, &m_VkCommandBuffer) != VK_SUCCESS)
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
     {
-        OutputDebugStringA("[VulkanRenderer] Failed to allocate command buffer\n");
-        return false;
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_Frames[i].commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_VkDevice, &allocInfo, &m_Frames[i].commandBuffer) != VK_SUCCESS)
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to allocate command buffer\n");
+            return false;
+        }
     }
 
     return true;
@@ -473,20 +931,27 @@ bool Vulkan::Renderer::CreateSynchronizationObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    if (vkCreateSemaphore(m_VkDevice, &semaphoreInfo, nullptr, &m_VkImageAvailableSemaphore) != VK_SUCCESS ||
-        vkCreateSemaphore(m_VkDevice, &semaphoreInfo, nullptr, &m_VkRenderFinishedSemaphore) != VK_SUCCESS ||
-        vkCreateFence(m_VkDevice, &fenceInfo, nullptr, &m_VkInFlightFence) != VK_SUCCESS)
+    for (uint32_t i = 0; i < m_FramesInFlight; i++)
     {
-        OutputDebugStringA("[VulkanRenderer] Failed to create sync objects\n");
-        return false;
+        FrameData& frame = m_Frames[i];
+        if (vkCreateSemaphore(m_VkDevice, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS ||
+            vkCreateSemaphore(m_VkDevice, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore) != VK_SUCCESS ||
+            (!m_bTimelineScheduler && vkCreateFence(m_VkDevice, &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS))
+        {
+            OutputDebugStringA("[VulkanRenderer] Failed to create sync objects\n");
+            return false;
+        }
     }
 
+    m_ImageFrameSlots.assign(m_SwapChainImages.size(), UINT32_MAX);
+
     return true;
 }
 
 bool Vulkan::Renderer::CreateShaders()
 {
-    return true;
+    return PostProcessing::LoadShaderModule(m_VkDevice, "basic.vert", m_VkVertexShader) &&
+           PostProcessing::LoadShaderModule(m_VkDevice, "basic.frag", m_VkFragmentShader);
 }
 
 bool Vulkan::Renderer::CreatePipeline()
@@ -519,24 +984,17 @@ bool Vulkan::Renderer::CreatePipeline()
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)m_Width;
-    viewport.height = (float)m_Height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = {m_Width, m_Height};
-
+    // Set by BindPipeline(), so a recreated swap chain keeps the pipeline.
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -572,8 +1030,14 @@ bool Vulkan::Renderer::CreatePipeline()
         return false;
     }
 
+    VkPipelineRenderingCreateInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &m_SurfaceFormat.format;
+
     VkGraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = m_bDynamicRendering ? &renderingInfo : nullptr;
     pipelineInfo.layout = m_VkPipelineLayout;
     pipelineInfo.renderPass = m_VkRenderPass;
     pipelineInfo.subpass = 0;
@@ -582,10 +1046,12 @@ bool Vulkan::Renderer::CreatePipeline()
     VkPipelineShaderStageCreateInfo stages[2] = {};
     stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = m_VkVertexShader;
     stages[0].pName = "main";
 
     stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = m_VkFragmentShader;
     stages[1].pName = "main";
 
     pipelineInfo.pStages = stages;
@@ -596,8 +1062,9 @@ bool Vulkan::Renderer::CreatePipeline()
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
 
-    if (vkCreateGraphicsPipelines(m_VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VkPipeline) != VK_SUCCESS)
+    if (PipelineCache::GetInstance().CreateGraphicsPipelines(1, &pipelineInfo, &m_VkPipeline) != VK_SUCCESS)
     {
         OutputDebugStringA("[VulkanRenderer] Failed to create graphics pipeline\n");
         return false;
@@ -608,74 +1075,407 @@ bool Vulkan::Renderer::CreatePipeline()
 
 bool Vulkan::Renderer::BeginFrame()
 {
-    vkWaitForFences(m_VkDevice, 1, &m_VkInFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(m_VkDevice, 1, &m_VkInFlightFence);
+    FrameData& frame = m_Frames[m_CurrentFrame];
+    FrameStats& frameStats = FrameStats::GetInstance();
+    frameStats.BeginFrame();
 
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_VkDevice, m_VkSwapChain, UINT64_MAX, m_VkImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+#ifdef _WIN32
+    // Low bit: pressed since the last call.
+    if (m_FrameStatsHotkey && !m_FrameStatsPath.empty() && (GetAsyncKeyState((int)m_FrameStatsHotkey) & 1))
+    {
+        frameStats.DumpCsv(m_FrameStatsPath);
+    }
+#endif
 
-    vkResetCommandBuffer(m_VkCommandBuffer, 0);
+    // Only wait for the frame that last used this slot; the other slots
+    // keep the GPU busy while the CPU records.
+    WaitForFrameSlot(m_CurrentFrame);
+    frameStats.Mark(FRAME_PHASE_FENCE_WAIT);
+
+    DeletionQueue::GetInstance().BeginFrame(m_SubmittedFrames);
+
+    if (m_bHeadless)
+    {
+        m_ImageIndex = m_CurrentFrame;
+    }
+    else
+    {
+        // Out of date: recreate and acquire again. Only a second failure
+        // (or a minimized window) drops the frame.
+        VkResult result = VK_ERROR_OUT_OF_DATE_KHR;
+        for (uint32_t attempt = 0; attempt < 2 && result == VK_ERROR_OUT_OF_DATE_KHR; attempt++)
+        {
+            if ((m_bSwapChainDirty || attempt > 0 || !m_VkSwapChain) &&
+                !RecreateSwapChain(m_PendingWidth, m_PendingHeight))
+            {
+                return false;
+            }
+
+            result = vkAcquireNextImageKHR(m_VkDevice, m_VkSwapChain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &m_ImageIndex);
+        }
+
+        if (result == VK_SUBOPTIMAL_KHR)
+        {
+            // Still presentable; replace it before the next frame.
+            m_bSwapChainDirty = true;
+        }
+        else if (result != VK_SUCCESS)
+        {
+            m_bSwapChainDirty = true;
+            return false;
+        }
+    }
+
+    // With fewer swap chain images than slots an image can still be owned
+    // by an older slot.
+    if (m_ImageFrameSlots[m_ImageIndex] != UINT32_MAX && m_ImageFrameSlots[m_ImageIndex] != m_CurrentFrame)
+    {
+        WaitForFrameSlot(m_ImageFrameSlots[m_ImageIndex]);
+    }
+    m_ImageFrameSlots[m_ImageIndex] = m_CurrentFrame;
+    frameStats.Mark(FRAME_PHASE_ACQUIRE_WAIT);
+
+    if (!m_bTimelineScheduler) vkResetFences(m_VkDevice, 1, &frame.inFlightFence);
+    vkResetCommandPool(m_VkDevice, frame.commandPool, 0);
 
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+    GpuProfiler& profiler = GpuProfiler::GetInstance();
+    profiler.BeginFrame(frame.commandBuffer, m_CurrentFrame);
 
-    vkBeginCommandBuffer(m_VkCommandBuffer, &beginInfo);
+    UploadScheduler::GetInstance().BeginFrame(frame.commandBuffer);
+
+    SceneRecorder& recorder = SceneRecorder::GetInstance();
+    recorder.BeginFrame(m_CurrentFrame, m_VkRenderPass, GetFramebuffer(), m_SurfaceFormat.format);
+
+    // Timestamps cannot go into a subpass with secondary contents, so the
+    // scene pass is timed around the render pass.
+    profiler.BeginPass(GPU_PASS_SCENE);
+
+    VkClearColorValue clearColor = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+    if (m_bDynamicRendering)
+    {
+        // The render pass's initial layout transition, ordered after the
+        // acquire semaphore's wait at COLOR_ATTACHMENT_OUTPUT.
+        DynamicRendering& dynamicRendering = DynamicRendering::GetInstance();
+        DynamicRendering::Transition(frame.commandBuffer, m_SwapChainImages[m_ImageIndex],
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+        dynamicRendering.Begin(frame.commandBuffer, m_SwapChainImageViews[m_ImageIndex], {m_Width, m_Height}, &clearColor,
+            recorder.UsesSecondaryBuffers() ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0);
+        if (!recorder.UsesSecondaryBuffers()) BindPipeline(frame.commandBuffer);
+        return true;
+    }
 
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = m_VkRenderPass;
-    renderPassInfo.framebuffer = m_Framebuffers[imageIndex];
+    renderPassInfo.framebuffer = m_Framebuffers[m_ImageIndex];
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = {m_Width, m_Height};
 
-    VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+    VkClearValue clearValue = {};
+    clearValue.color = clearColor;
     renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    renderPassInfo.pClearValues = &clearValue;
 
-    vkCmdBeginRenderPass(m_VkCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdBindPipeline(m_VkCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkPipeline);
+    if (recorder.UsesSecondaryBuffers())
+    {
+        vkCmdBeginRenderPass(frame.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
+    else
+    {
+        vkCmdBeginRenderPass(frame.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        BindPipeline(frame.commandBuffer);
+    }
 
     return true;
 }
 
 void Vulkan::Renderer::EndFrame()
 {
-    vkCmdEndRenderPass(m_VkCommandBuffer);
+    FrameData& frame = m_Frames[m_CurrentFrame];
+
+    SceneRecorder::GetInstance().Record(frame.commandBuffer);
+
+    RenderUI();
+
+    if (m_bDynamicRendering)
+    {
+        // The render pass's final layout transition.
+        DynamicRendering::GetInstance().End(frame.commandBuffer);
+        if (m_bHeadless)
+        {
+            DynamicRendering::Transition(frame.commandBuffer, m_SwapChainImages[m_ImageIndex],
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        }
+        else
+        {
+            DynamicRendering::Transition(frame.commandBuffer, m_SwapChainImages[m_ImageIndex],
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        }
+    }
+    else
+    {
+        vkCmdEndRenderPass(frame.commandBuffer);
+    }
+
+    GpuProfiler& profiler = GpuProfiler::GetInstance();
+    profiler.EndPass(GPU_PASS_SCENE);
+
+    if (m_bReadback) RecordReadback(frame.commandBuffer);
+
+    profiler.EndFrame();
 
-    if (vkEndCommandBuffer(m_VkCommandBuffer) != VK_SUCCESS)
+    if (vkEndCommandBuffer(frame.commandBuffer) != VK_SUCCESS)
     {
         OutputDebugStringA("[VulkanRenderer] Failed to record command buffer\n");
     }
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &m_VkImageAvailableSemaphore;
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_VkCommandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_VkRenderFinishedSemaphore;
+    FrameStats& frameStats = FrameStats::GetInstance();
+    frameStats.Mark(FRAME_PHASE_RECORD);
+
+    // Nothing to acquire or present in headless mode. Texture uploads
+    // handed to this frame are waited for before the fragment shaders.
+    UploadScheduler& uploadScheduler = UploadScheduler::GetInstance();
+    if (m_bTimelineScheduler)
+    {
+        // One timeline value on the transfer queue covers every batch the
+        // frame has seen.
+        FrameScheduler& scheduler = FrameScheduler::GetInstance();
+        VkSemaphoreSubmitInfo waits[2] = {};
+        uint32_t waitCount = 0;
+        if (!m_bHeadless)
+        {
+            waits[waitCount].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            waits[waitCount].semaphore = frame.imageAvailableSemaphore;
+            waits[waitCount].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+            waitCount++;
+        }
+        uint64_t uploadValue = uploadScheduler.TakeWaitValue();
+        if (uploadValue != 0)
+        {
+            waits[waitCount].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            waits[waitCount].semaphore = scheduler.GetTimeline(m_VkTransferQueue);
+            waits[waitCount].value = uploadValue;
+            waits[waitCount].stageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+            waitCount++;
+        }
+
+        frame.timelineValue = scheduler.Submit(m_VkGraphicsQueue, waits, waitCount, frame.commandBuffer,
+            m_bHeadless ? VK_NULL_HANDLE : frame.renderFinishedSemaphore);
+    }
+    else
+    {
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        if (!m_bHeadless)
+        {
+            waitSemaphores.push_back(frame.imageAvailableSemaphore);
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+        uploadScheduler.TakeWaitSemaphores(waitSemaphores);
+        waitStages.resize(waitSemaphores.size(), VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = (uint32_t)waitSemaphores.size();
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &frame.commandBuffer;
+        submitInfo.signalSemaphoreCount = m_bHeadless ? 0 : 1;
+        submitInfo.pSignalSemaphores = &frame.renderFinishedSemaphore;
+
+        vkQueueSubmit(m_VkGraphicsQueue, 1, &submitInfo, frame.inFlightFence);
+    }
+    m_LastSubmittedFrame = m_CurrentFrame;
+    m_SubmittedFrames++;
+    frameStats.Mark(FRAME_PHASE_SUBMIT);
 
-    vkQueueSubmit(m_VkGraphicsQueue, 1, &submitInfo, m_VkInFlightFence);
+    if (m_bHeadless)
+    {
+        frameStats.Mark(FRAME_PHASE_PRESENT);
+        frameStats.EndFrame();
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
+        return;
+    }
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &m_VkRenderFinishedSemaphore;
+    presentInfo.pWaitSemaphores = &frame.renderFinishedSemaphore;
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = &m_VkSwapChain;
+    presentInfo.pImageIndices = &m_ImageIndex;
+
+    VkResult presentResult = vkQueuePresentKHR(m_VkGraphicsQueue, &presentInfo);
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR)
+    {
+        m_bSwapChainDirty = true;
+    }
+    frameStats.Mark(FRAME_PHASE_PRESENT);
+    frameStats.EndFrame();
 
-    vkQueuePresentKHR(m_VkGraphicsQueue, &presentInfo);
+    m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
 }
 
 void Vulkan::Renderer::RenderScene()
 {
 }
 
+void Vulkan::Renderer::BindPipeline(VkCommandBuffer commandBuffer) const
+{
+    VkViewport viewport = {0.0f, 0.0f, (float)m_Width, (float)m_Height, 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, {m_Width, m_Height}};
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VkPipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
 void Vulkan::Renderer::RenderUI()
 {
+    if (!m_bShowGpuProfiler) return;
+
+    GpuProfiler& profiler = GpuProfiler::GetInstance();
+    if (!profiler.IsEnabled()) return;
+
+    // One bar per pass in the top-left corner: the bar is the rolling
+    // average and the white tick the p99, on a scale where half the
+    // screen width is 16.7 ms. Cleared rectangles need no pipeline.
+    static const float passColors[GPU_PASS_COUNT][3] = {
+        {0.2f, 0.8f, 0.2f}, {0.9f, 0.6f, 0.1f}, {0.3f, 0.5f, 0.9f}, {0.9f, 0.9f, 0.2f}, {0.2f, 0.9f, 0.9f}, {0.8f, 0.3f, 0.8f}
+    };
+    const float msToPixels = (m_Width * 0.5f) / 16.7f;
+    const int32_t barHeight = 8;
+    const int32_t margin = 8;
+
+    // Clear rectangles must lie inside the frame; a frame too narrow for
+    // the margins and the p99 tick gets no overlay.
+    if (m_Width <= (uint32_t)margin * 2 + 2) return;
+
+    SceneRecorder& recorder = SceneRecorder::GetInstance();
+    VkCommandBuffer primary = m_Frames[m_CurrentFrame].commandBuffer;
+    VkCommandBuffer cmd = recorder.BeginOverlay(primary);
+    if (!cmd) return;
+
+    for (uint32_t pass = 0; pass < GPU_PASS_COUNT; pass++)
+    {
+        const GpuPassStats& stats = profiler.GetStats((GpuPass)pass);
+        if (stats.sampleCount == 0) continue;
+
+        int32_t y = margin + (int32_t)pass * (barHeight + 4);
+        if ((uint32_t)(y + barHeight) > m_Height) break;
+        uint32_t avgWidth = std::min((uint32_t)(stats.avgMs * msToPixels) + 1, m_Width - margin * 2);
+        uint32_t p99X = std::min((uint32_t)(stats.p99Ms * msToPixels), m_Width - margin * 2 - 2);
+
+        VkClearAttachment attachment = {};
+        attachment.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        attachment.colorAttachment = 0;
+
+        VkClearRect rects[2] = {};
+        rects[0].rect = {{margin, y}, {avgWidth, (uint32_t)barHeight}};
+        rects[0].layerCount = 1;
+        rects[1].rect = {{margin + (int32_t)p99X, y}, {2, (uint32_t)barHeight}};
+        rects[1].layerCount = 1;
+
+        attachment.clearValue.color = {{passColors[pass][0], passColors[pass][1], passColors[pass][2], 1.0f}};
+        vkCmdClearAttachments(cmd, 1, &attachment, 1, &rects[0]);
+
+        attachment.clearValue.color = {{1.0f, 1.0f, 1.0f, 1.0f}};
+        vkCmdClearAttachments(cmd, 1, &attachment, 1, &rects[1]);
+    }
+
+    recorder.EndOverlay(primary);
+}
+
+void Vulkan::Renderer::Resize(uint32_t width, uint32_t height)
+{
+    if (!m_bInitialized) return;
+
+    if (m_bHeadless)
+    {
+        OutputDebugStringA("[VulkanRenderer] Resize is not supported in headless mode\n");
+        return;
+    }
+
+    // Never mid-frame: BeginFrame() recreates before its acquire.
+    m_PendingWidth = width;
+    m_PendingHeight = height;
+    m_bSwapChainDirty = true;
+}
+
+bool Vulkan::Renderer::RecreateSwapChain(uint32_t width, uint32_t height)
+{
+    // A minimized window has a zero extent; keep the current swap chain
+    // and try again next frame.
+    VkSurfaceCapabilitiesKHR capabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_VkPhysicalDevice, m_VkSurface, &capabilities);
+    if (capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0)
+    {
+        m_bSwapChainDirty = true;
+        return false;
+    }
+
+    // Other frame slots may still render to or present the old images.
+    // The old swap chain is passed as oldSwapchain and destroyed once
+    // those frames have finished, so nothing waits for the device.
+    VkSwapchainKHR oldSwapChain = m_VkSwapChain;
+    std::vector<VkImageView> oldImageViews;
+    std::vector<VkFramebuffer> oldFramebuffers;
+    oldImageViews.swap(m_SwapChainImageViews);
+    oldFramebuffers.swap(m_Framebuffers);
+
+    bool created = CreateSwapChain(width ? width : m_Width, height ? height : m_Height) && CreateFramebuffers();
+    if (!created && m_VkSwapChain == oldSwapChain)
+    {
+        // A failed create still retires oldSwapchain.
+        m_VkSwapChain = VK_NULL_HANDLE;
+    }
+
+    DeletionQueue& deletionQueue = DeletionQueue::GetInstance();
+    for (VkFramebuffer& framebuffer : oldFramebuffers) deletionQueue.DestroyFramebuffer(framebuffer);
+    for (VkImageView& imageView : oldImageViews) deletionQueue.DestroyImageView(imageView);
+    deletionQueue.DestroySwapchain(oldSwapChain);
+
+    if (!created)
+    {
+        OutputDebugStringA("[VulkanRenderer] Failed to recreate swap chain\n");
+        m_bSwapChainDirty = true;
+        return false;
+    }
+
+    m_ImageFrameSlots.assign(m_SwapChainImages.size(), UINT32_MAX);
+    m_PendingWidth = 0;
+    m_PendingHeight = 0;
+    m_bSwapChainDirty = false;
+
+    char msg[128];
+    sprintf_s(msg, "[VulkanRenderer] Swap chain recreated at %ux%u\n", m_Width, m_Height);
+    OutputDebugStringA(msg);
+    return true;
+}
+
+void Vulkan::Renderer::CleanupSwapChain()
+{
+    for (VkFramebuffer framebuffer : m_Framebuffers) vkDestroyFramebuffer(m_VkDevice, framebuffer, nullptr);
+    for (VkImageView imageView : m_SwapChainImageViews) vkDestroyImageView(m_VkDevice, imageView, nullptr);
+    if (m_VkSwapChain) vkDestroySwapchainKHR(m_VkDevice, m_VkSwapChain, nullptr);
+
+    m_Framebuffers.clear();
+    m_SwapChainImageViews.clear();
+    m_VkSwapChain = VK_NULL_HANDLE;
 }
 
 void Vulkan::Renderer::UpdatePipeline()
@@ -0,0 +1,151 @@
+/**
+ * @file bridge_texture_test.cpp
+ * @brief Creates, updates and releases bridge textures through the render thread
+ *
+ * Usage: ofp_bridge_texture_test
+ *
+ * Runs the bridge with [Performance] RenderThread=true on a headless
+ * renderer. Each texture is updated right after it is created, before
+ * the render thread has executed the create, and one is released before
+ * any frame has waited for its upload. Checks that every update is
+ * accepted and reaches the UploadScheduler. Exits with 77, which CTest
+ * reports as skipped, when the renderer cannot start on this machine.
+ */
+
+#include <windows.h>
+#include "../include/d3d8_bridge.h"
+#include "../include/vulkan_renderer.h"
+#include "../include/upload_scheduler.h"
+#include "../include/config.h"
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const int EXIT_SKIPPED = 77;
+const uint32_t WIDTH = 64;
+const uint32_t HEIGHT = 64;
+const UINT PITCH_PADDING = 16;              // Bytes a lock may add past each row
+
+struct TestTexture {
+    const char* name;
+    UINT width;
+    UINT height;
+    UINT levels;
+    D3DFORMAT format;
+    UINT texelBytes;
+};
+
+const TestTexture TEXTURES[] = {
+    { "A8R8G8B8", 64, 64, 2, D3DFMT_A8R8G8B8, 4 },
+    { "R5G6B5", 16, 16, 1, D3DFMT_R5G6B5, 2 },
+    { "P8", 32, 32, 1, D3DFMT_P8, 1 },
+};
+
+/**
+ * @brief Create a texture and upload every level with a padded pitch
+ * @return 0 if the create or any update fails
+ */
+Bridge::TextureHandle CreateAndUpdate(const TestTexture& desc, const PALETTEENTRY* palette, uint32_t& uploads)
+{
+    Bridge::D3D8Bridge& bridge = Bridge::D3D8Bridge::GetInstance();
+    Bridge::TextureHandle texture = bridge.CreateTexture(desc.width, desc.height, desc.levels, desc.format);
+    if (texture == 0)
+    {
+        printf("%s: CreateTexture failed\n", desc.name);
+        return 0;
+    }
+
+    for (UINT level = 0; level < desc.levels; level++)
+    {
+        UINT width = desc.width >> level;
+        UINT height = desc.height >> level;
+        UINT pitch = width * desc.texelBytes + PITCH_PADDING;
+        std::vector<uint8_t> bits((size_t)pitch * height);
+        for (size_t i = 0; i < bits.size(); i++) bits[i] = (uint8_t)(i * 7 + level);
+
+        if (!bridge.UpdateTexture(texture, level, bits.data(), pitch, palette))
+        {
+            printf("%s: UpdateTexture of level %u right after CreateTexture failed\n", desc.name, level);
+            return 0;
+        }
+        uploads++;
+    }
+    return texture;
+}
+
+void RunFrame()
+{
+    Bridge::D3D8Bridge& bridge = Bridge::D3D8Bridge::GetInstance();
+    bridge.BeginScene();
+    bridge.EndScene();
+    bridge.Present(nullptr, nullptr, nullptr, nullptr);
+}
+
+} // namespace
+
+int main()
+{
+    Config::ConfigManager& config = Config::ConfigManager::GetInstance();
+    config.Load();
+    config.GetPerformance().renderThread = true;
+
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    if (!renderer.InitializeHeadless(WIDTH, HEIGHT, false))
+    {
+        printf("No usable Vulkan device; skipping\n");
+        return EXIT_SKIPPED;
+    }
+
+    Bridge::D3D8Bridge& bridge = Bridge::D3D8Bridge::GetInstance();
+    if (!bridge.Initialize())
+    {
+        printf("Failed to initialize D3D8 bridge\n");
+        renderer.Shutdown();
+        return 1;
+    }
+    bridge.StopTrace();
+
+    bool passed = bridge.IsThreaded();
+    if (!passed) printf("The render thread did not start\n");
+
+    PALETTEENTRY palette[256];
+    for (int i = 0; i < 256; i++) palette[i] = { (BYTE)i, (BYTE)(255 - i), (BYTE)(i / 2), 0 };
+
+    Vulkan::UploadScheduler& uploads = Vulkan::UploadScheduler::GetInstance();
+    uint64_t uploadsBefore = uploads.GetStats().uploadCount;
+    uint32_t expectedUploads = 0;
+
+    std::vector<Bridge::TextureHandle> textures;
+    for (const TestTexture& desc : TEXTURES)
+    {
+        Bridge::TextureHandle texture = CreateAndUpdate(desc, palette, expectedUploads);
+        if (texture == 0) passed = false;
+        else textures.push_back(texture);
+    }
+
+    // Released before any frame has taken its upload batch
+    Bridge::TextureHandle transient = CreateAndUpdate(TEXTURES[1], palette, expectedUploads);
+    if (transient == 0) passed = false;
+    else bridge.ReleaseTexture(transient);
+
+    for (int frame = 0; frame < 3; frame++) RunFrame();
+
+    for (Bridge::TextureHandle texture : textures) bridge.ReleaseTexture(texture);
+    RunFrame();
+
+    // Joins the render thread, so every queued call has executed.
+    bridge.Shutdown();
+
+    uint64_t uploadCount = uploads.GetStats().uploadCount - uploadsBefore;
+    if (uploadCount != expectedUploads)
+    {
+        printf("UploadScheduler saw %llu uploads, expected %u\n", (unsigned long long)uploadCount, expectedUploads);
+        passed = false;
+    }
+
+    renderer.Shutdown();
+
+    printf("%s\n", passed ? "Bridge textures uploaded" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file headless_render_test.cpp
+ * @brief Renders one headless frame and checks the read-back pixels
+ *
+ * Usage: ofp_headless_test
+ *
+ * Draws a triangle with the renderer's base pipeline into a 64x64
+ * offscreen frame, reads it back and checks that the center is covered
+ * and the corners keep the clear color. Exits with 77, which CTest
+ * reports as skipped, when the machine has no Vulkan device at all;
+ * install a software driver such as lavapipe to run it without a GPU.
+ */
+
+#include "../include/vulkan_renderer.h"
+#include "../include/memory_allocator.h"
+#include "../include/scene_recorder.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int EXIT_SKIPPED = 77;
+const uint32_t WIDTH = 64;
+const uint32_t HEIGHT = 64;
+
+// Clip-space XYZ and UV; clockwise on screen, so front-facing for the base pipeline
+const float TRIANGLE[3][5] = {
+    { -0.5f, -0.5f, 0.0f, 0.0f, 0.0f },
+    {  0.5f, -0.5f, 0.0f, 1.0f, 0.0f },
+    {  0.0f,  0.5f, 0.0f, 0.5f, 1.0f },
+};
+
+bool HasVulkanDevice()
+{
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) return false;
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return deviceCount > 0;
+}
+
+// BGRA8, tightly packed
+const uint8_t* Pixel(const std::vector<uint8_t>& pixels, uint32_t x, uint32_t y)
+{
+    return &pixels[((size_t)y * WIDTH + x) * 4];
+}
+
+bool CheckPixels(const std::vector<uint8_t>& pixels)
+{
+    if (pixels.size() != (size_t)WIDTH * HEIGHT * 4)
+    {
+        printf("Read back %zu bytes, expected %u\n", pixels.size(), WIDTH * HEIGHT * 4);
+        return false;
+    }
+
+    bool passed = true;
+    const uint8_t* center = Pixel(pixels, WIDTH / 2, HEIGHT / 2);
+    if (center[0] != 255 || center[3] != 255)
+    {
+        printf("Center pixel %u,%u,%u,%u (BGRA) is not covered by the triangle\n", center[0], center[1], center[2], center[3]);
+        passed = false;
+    }
+
+    const uint32_t corners[4][2] = { { 0, 0 }, { WIDTH - 1, 0 }, { 0, HEIGHT - 1 }, { WIDTH - 1, HEIGHT - 1 } };
+    for (const uint32_t* corner : corners)
+    {
+        const uint8_t* pixel = Pixel(pixels, corner[0], corner[1]);
+        if (pixel[0] != 0 || pixel[1] != 0 || pixel[2] != 0 || pixel[3] != 255)
+        {
+            printf("Corner %u,%u is %u,%u,%u,%u (BGRA), expected the clear color\n",
+                corner[0], corner[1], pixel[0], pixel[1], pixel[2], pixel[3]);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+} // namespace
+
+int main()
+{
+    if (!HasVulkanDevice())
+    {
+        printf("No Vulkan device; skipping\n");
+        return EXIT_SKIPPED;
+    }
+
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    if (!renderer.InitializeHeadless(WIDTH, HEIGHT, true))
+    {
+        printf("Failed to initialize the headless renderer\n");
+        return 1;
+    }
+
+    VkDevice device = renderer.GetDevice();
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = sizeof(TRIANGLE);
+    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    Vulkan::Allocation vertexMemory;
+    Vulkan::MemoryAllocator& allocator = Vulkan::MemoryAllocator::GetInstance();
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &vertexBuffer) != VK_SUCCESS ||
+        !allocator.AllocateForBuffer(vertexBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            Vulkan::ALLOCATION_MAPPED, vertexMemory) || !vertexMemory.mapped)
+    {
+        printf("Failed to create the vertex buffer\n");
+        if (vertexBuffer) vkDestroyBuffer(device, vertexBuffer, nullptr);
+        renderer.Shutdown();
+        return 1;
+    }
+    memcpy(vertexMemory.mapped, TRIANGLE, sizeof(TRIANGLE));
+
+    bool passed = false;
+    std::vector<uint8_t> pixels;
+    if (renderer.BeginFrame())
+    {
+        // The overlay buffer is valid inside the scene pass whether or not
+        // the scene is recorded into secondaries.
+        Vulkan::SceneRecorder& recorder = Vulkan::SceneRecorder::GetInstance();
+        VkCommandBuffer primary = renderer.GetCommandBuffer();
+        VkCommandBuffer cmd = recorder.BeginOverlay(primary);
+        if (cmd)
+        {
+            VkDeviceSize offset = 0;
+            renderer.BindPipeline(cmd);
+            vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, &offset);
+            vkCmdDraw(cmd, 3, 1, 0, 0);
+            recorder.EndOverlay(primary);
+        }
+        renderer.EndFrame();
+
+        if (!cmd) printf("No command buffer for the draw\n");
+        else if (!renderer.ReadbackFrame(pixels)) printf("Readback failed\n");
+        else passed = CheckPixels(pixels);
+    }
+    else
+    {
+        printf("BeginFrame failed\n");
+    }
+
+    vkDeviceWaitIdle(device);
+    vkDestroyBuffer(device, vertexBuffer, nullptr);
+    allocator.Free(vertexMemory);
+    renderer.Shutdown();
+
+    printf("%s\n", passed ? "Headless frame matches" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file matrix_bench.cpp
+ * @brief Compares per-draw world-view-projection concatenation strategies
+ *
+ * Usage: ofp_matrix_bench [--draws N] [--loops N]
+ *
+ * Each draw gets its own world matrix while view and projection stay
+ * fixed, as in a typical OFP frame. The naive strategy concatenates
+ * world * view * projection * fixup with scalar code on every draw; the
+ * cached one multiplies the world matrix with a precomputed view *
+ * projection. The SSE results must be bit-identical to the scalar ones.
+ */
+
+#include "../include/matrix_math.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace Math;
+
+namespace {
+
+// xorshift32, so runs are reproducible
+float RandomFloat(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (float)(state & 0xFFFFFF) / (float)0x800000 - 1.0f;
+}
+
+void RandomMatrix(uint32_t& state, Matrix4& out)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++) out.m[i][j] = RandomFloat(state);
+    }
+}
+
+template <typename F>
+double Measure(uint32_t draws, uint32_t loops, F&& body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t loop = 0; loop < loops; loop++)
+    {
+        for (uint32_t i = 0; i < draws; i++) body(i);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / ((double)draws * loops);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t draws = 10000;
+    uint32_t loops = 200;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)
+        {
+            draws = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+        {
+            loops = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            printf("Usage: ofp_matrix_bench [--draws N] [--loops N]\n");
+            return 1;
+        }
+    }
+    if (draws == 0 || loops == 0)
+    {
+        printf("--draws and --loops must be positive\n");
+        return 1;
+    }
+
+    uint32_t state = 0x2545F491u;
+    std::vector<Matrix4> worlds(draws);
+    std::vector<Matrix4> results(draws);
+    for (Matrix4& world : worlds) RandomMatrix(state, world);
+
+    Matrix4 view, projection, fixup, viewProjection;
+    RandomMatrix(state, view);
+    RandomMatrix(state, projection);
+    ClipSpaceFixup(fixup);
+    MultiplyScalar(projection, fixup, projection);
+    Multiply(view, projection, viewProjection);
+
+    // Correctness: SSE against scalar, bit for bit
+    bool passed = true;
+    for (uint32_t i = 0; i < draws && passed; i++)
+    {
+        Matrix4 simd, scalar;
+        Multiply(worlds[i], viewProjection, simd);
+        MultiplyScalar(worlds[i], viewProjection, scalar);
+        if (memcmp(&simd, &scalar, sizeof(simd)) != 0)
+        {
+            printf("MISMATCH Multiply, draw %u\n", i);
+            passed = false;
+        }
+
+        Transpose(worlds[i], simd);
+        TransposeScalar(worlds[i], scalar);
+        if (memcmp(&simd, &scalar, sizeof(simd)) != 0)
+        {
+            printf("MISMATCH Transpose, draw %u\n", i);
+            passed = false;
+        }
+
+        bool simdOk = InverseTranspose3x3(worlds[i], simd);
+        bool scalarOk = InverseTranspose3x3Scalar(worlds[i], scalar);
+        if (simdOk != scalarOk || memcmp(&simd, &scalar, sizeof(simd)) != 0)
+        {
+            printf("MISMATCH InverseTranspose3x3, draw %u\n", i);
+            passed = false;
+        }
+    }
+
+    // The normal matrix must undo the world matrix: N^T * W = I for the 3x3.
+    double maxInverseError = 0.0;
+    for (uint32_t i = 0; i < draws; i++)
+    {
+        Matrix4 normal, transposed, product;
+        if (!InverseTranspose3x3(worlds[i], normal)) continue;
+        Transpose(normal, transposed);
+        MultiplyScalar(worlds[i], transposed, product);
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                double error = fabs(product.m[r][c] - (r == c ? 1.0 : 0.0));
+                if (error > maxInverseError) maxInverseError = error;
+            }
+        }
+    }
+
+    printf("Implementation: %s, %u draws x %u loops\n", GetMatrixImplementationName(), draws, loops);
+
+    double naive = Measure(draws, loops, [&](uint32_t i)
+    {
+        Matrix4 temp;
+        MultiplyScalar(worlds[i], view, temp);
+        MultiplyScalar(temp, projection, temp);
+        results[i] = temp;
+    });
+    double cachedScalar = Measure(draws, loops, [&](uint32_t i)
+    {
+        MultiplyScalar(worlds[i], viewProjection, results[i]);
+    });
+    double cachedSimd = Measure(draws, loops, [&](uint32_t i)
+    {
+        Multiply(worlds[i], viewProjection, results[i]);
+    });
+    double normalScalar = Measure(draws, loops, [&](uint32_t i)
+    {
+        InverseTranspose3x3Scalar(worlds[i], results[i]);
+    });
+    double normalSimd = Measure(draws, loops, [&](uint32_t i)
+    {
+        InverseTranspose3x3(worlds[i], results[i]);
+    });
+
+    // Keep the results observable
+    volatile float sink = results[draws / 2].m[0][0];
+    (void)sink;
+
+    printf("%-32s %8.2f ns/draw\n", "WVP naive scalar (W * V * P)", naive);
+    printf("%-32s %8.2f ns/draw  (%.1fx)\n", "WVP cached VP, scalar", cachedScalar, naive / cachedScalar);
+    printf("%-32s %8.2f ns/draw  (%.1fx)\n", "WVP cached VP, SIMD", cachedSimd, naive / cachedSimd);
+    printf("%-32s %8.2f ns/draw\n", "Normal matrix, scalar", normalScalar);
+    printf("%-32s %8.2f ns/draw  (%.1fx)\n", "Normal matrix, SIMD", normalSimd, normalScalar / normalSimd);
+    printf("Normal matrix max error vs identity: %.3g\n", maxInverseError);
+
+    printf("%s\n", passed ? "SIMD results match the scalar reference" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file ofp_replay.cpp
+ * @brief Replays a D3D8 bridge trace and reports frame-time statistics
+ *
+ * Usage: ofp_replay <trace> [--window] [--loops N]
+ *
+ * Records are loaded into memory up front and then issued back-to-back,
+ * so the timings measure the bridge and renderer rather than the disk.
+ * Without --window the renderer runs headless. With [Performance]
+ * RenderThread=true the timings are those of the issuing thread.
+ */
+
+#include <windows.h>
+#include "../include/d3d8_bridge.h"
+#include "../include/d3d8_trace.h"
+#include "../include/vulkan_renderer.h"
+#include "../include/config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <vector>
+
+namespace {
+
+struct TraceRecord {
+    Bridge::TraceOp op;
+    std::vector<uint8_t> payload;
+};
+
+HWND CreateReplayWindow(uint32_t width, uint32_t height)
+{
+    WNDCLASSEXW windowClass = {};
+    windowClass.cbSize = sizeof(windowClass);
+    windowClass.lpfnWndProc = DefWindowProcW;
+    windowClass.hInstance = GetModuleHandleW(nullptr);
+    windowClass.lpszClassName = L"OFPReplay";
+    RegisterClassExW(&windowClass);
+
+    RECT rect = {0, 0, (LONG)width, (LONG)height};
+    AdjustWindowRect(&rect, WS_OVERLAPPEDWINDOW, FALSE);
+
+    HWND hwnd = CreateWindowExW(0, windowClass.lpszClassName, L"OFP Replay", WS_OVERLAPPEDWINDOW,
+        CW_USEDEFAULT, CW_USEDEFAULT, rect.right - rect.left, rect.bottom - rect.top,
+        nullptr, nullptr, windowClass.hInstance, nullptr);
+    if (hwnd) ShowWindow(hwnd, SW_SHOW);
+    return hwnd;
+}
+
+void PumpMessages()
+{
+    MSG msg;
+    while (PeekMessageW(&msg, nullptr, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+void ReportFrameTimes(std::vector<double>& frameTimes, double totalSeconds)
+{
+    if (frameTimes.empty())
+    {
+        printf("No frames presented\n");
+        return;
+    }
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    double sum = 0.0;
+    for (double t : frameTimes) sum += t;
+
+    size_t count = frameTimes.size();
+    double average = sum / count;
+    double p50 = frameTimes[count / 2];
+    double p99 = frameTimes[std::min(count - 1, (size_t)(count * 0.99))];
+
+    printf("Frames:     %zu in %.3f s (%.1f FPS)\n", count, totalSeconds, count / totalSeconds);
+    printf("Frame time: min %.3f ms, avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        frameTimes.front(), average, p50, p99, frameTimes.back());
+}
+
+} // namespace
+
+int wmain(int argc, wchar_t** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: ofp_replay <trace> [--window] [--loops N]\n");
+        return 1;
+    }
+
+    bool windowed = false;
+    int loops = 1;
+    for (int i = 2; i < argc; i++)
+    {
+        if (wcscmp(argv[i], L"--window") == 0) windowed = true;
+        else if (wcscmp(argv[i], L"--loops") == 0 && i + 1 < argc) loops = std::max(1, _wtoi(argv[++i]));
+    }
+
+    Bridge::TraceReader reader;
+    if (!reader.Open(argv[1]))
+    {
+        printf("Failed to open trace\n");
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (reader.Next(record.op, record.payload)) records.push_back(record);
+    if (reader.IsTruncated())
+    {
+        printf("Trace is truncated after %zu calls\n", records.size());
+        return 1;
+    }
+
+    const Bridge::TraceFileHeader& header = reader.GetHeader();
+    printf("Loaded %zu calls, %ux%u\n", records.size(), header.width, header.height);
+
+    Config::ConfigManager::GetInstance().Load();
+
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    HWND hwnd = windowed ? CreateReplayWindow(header.width, header.height) : nullptr;
+    bool initialized = windowed ? (hwnd && renderer.Initialize(hwnd, header.width, header.height))
+                                : renderer.InitializeHeadless(header.width, header.height, false);
+    if (!initialized)
+    {
+        printf("Failed to initialize renderer\n");
+        return 1;
+    }
+
+    Bridge::D3D8Bridge& bridge = Bridge::D3D8Bridge::GetInstance();
+    if (!bridge.Initialize())
+    {
+        printf("Failed to initialize D3D8 bridge\n");
+        renderer.Shutdown();
+        return 1;
+    }
+
+    // Never record the replay itself, even if the ini asks for a trace.
+    bridge.StopTrace();
+
+    std::vector<double> frameTimes;
+    auto start = std::chrono::steady_clock::now();
+    auto frameStart = start;
+    bool malformed = false;
+
+    for (int loop = 0; loop < loops && !malformed; loop++)
+    {
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const TraceRecord& call = records[i];
+            if (!bridge.Dispatch(call.op, call.payload.data(), (uint32_t)call.payload.size()))
+            {
+                printf("Malformed record %zu (op %u, %zu bytes)\n", i, (unsigned)call.op, call.payload.size());
+                malformed = true;
+                break;
+            }
+            if (call.op != Bridge::TraceOp::Present) continue;
+
+            auto now = std::chrono::steady_clock::now();
+            frameTimes.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+            frameStart = now;
+
+            if (windowed) PumpMessages();
+        }
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    bridge.Shutdown();
+    renderer.Shutdown();
+    if (hwnd) DestroyWindow(hwnd);
+
+    if (malformed) return 1;
+
+    ReportFrameTimes(frameTimes, totalSeconds);
+    return 0;
+}
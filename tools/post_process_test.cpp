@@ -0,0 +1,348 @@
+/**
+ * @file post_process_test.cpp
+ * @brief Runs the post-processing chain headless in fused and separate passes
+ *
+ * Usage: ofp_post_process_test
+ *
+ * Copies a gradient into the PostProcessor's input, runs
+ * BeginPostProcessing, the Apply* calls and EndPostProcessing, and reads
+ * the output target back. Hard light and desaturation are checked
+ * against the uber shader's math on the CPU in both modes. Glare and
+ * desaturation are checked against each other across the modes, and
+ * must come out brighter than desaturation alone. Hard light is left out
+ * there: it jumps at 0.5, where the separate passes' rounding after the
+ * glare could land on either side. Exits with 77, which CTest reports
+ * as skipped, when the machine has no Vulkan device.
+ */
+
+#include "../include/vulkan_renderer.h"
+#include "../include/memory_allocator.h"
+#include "../include/post_processing.h"
+#include "../include/config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int EXIT_SKIPPED = 77;
+const uint32_t WIDTH = 64;
+const uint32_t HEIGHT = 64;
+const VkDeviceSize IMAGE_BYTES = (VkDeviceSize)WIDTH * HEIGHT * 4;    // R8G8B8A8_UNORM targets
+
+const float HARD_LIGHT[3] = { 0.6f, 0.4f, 0.8f };
+const float DESATURATION = 0.5f;
+const float GLARE_STRENGTH = 0.5f;
+const int GLARE_SIZE = 3;
+
+// Separate passes round to 8 bits between effects; the fused pass does not.
+const int FUSED_TOLERANCE = 2;
+const int SEPARATE_TOLERANCE = 3;
+
+struct Buffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    Vulkan::Allocation memory;
+};
+
+bool HasVulkanDevice()
+{
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) return false;
+
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    vkDestroyInstance(instance, nullptr);
+    return deviceCount > 0;
+}
+
+bool CreateBuffer(VkDevice device, VkBufferUsageFlags usage, Buffer& buffer)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = IMAGE_BYTES;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer) != VK_SUCCESS) return false;
+    return Vulkan::MemoryAllocator::GetInstance().AllocateForBuffer(buffer.buffer,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        Vulkan::ALLOCATION_MAPPED, buffer.memory) && buffer.memory.mapped;
+}
+
+void DestroyBuffer(VkDevice device, Buffer& buffer)
+{
+    if (buffer.buffer) vkDestroyBuffer(device, buffer.buffer, nullptr);
+    if (buffer.memory.mapped) Vulkan::MemoryAllocator::GetInstance().Free(buffer.memory);
+    buffer = Buffer();
+}
+
+// Smooth in both directions, so linear filtering at any offset stays close
+void FillGradient(uint8_t* pixels)
+{
+    for (uint32_t y = 0; y < HEIGHT; y++)
+    {
+        for (uint32_t x = 0; x < WIDTH; x++)
+        {
+            uint8_t* pixel = &pixels[((size_t)y * WIDTH + x) * 4];
+            pixel[0] = (uint8_t)(x * 4);
+            pixel[1] = (uint8_t)(y * 4);
+            pixel[2] = (uint8_t)((x + y) * 2);
+            pixel[3] = 255;
+        }
+    }
+}
+
+// As applyHardLight and applyDesaturate in shaders/post_uber.frag
+void ExpectedPixels(const uint8_t* input, bool hardLight, std::vector<uint8_t>& expected)
+{
+    expected.resize((size_t)IMAGE_BYTES);
+    for (size_t i = 0; i < (size_t)WIDTH * HEIGHT; i++)
+    {
+        float color[3];
+        for (int c = 0; c < 3; c++)
+        {
+            float value = input[i * 4 + c] / 255.0f;
+            float blended = value < 0.5f ? value * 2.0f : 1.0f - 2.0f * (1.0f - value);
+            color[c] = hardLight ? value + (blended - value) * HARD_LIGHT[c] : value;
+        }
+
+        float luminance = color[0] * 0.299f + color[1] * 0.587f + color[2] * 0.114f;
+        for (int c = 0; c < 3; c++)
+        {
+            float value = color[c] + (luminance - color[c]) * DESATURATION;
+            expected[i * 4 + c] = (uint8_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+        }
+        expected[i * 4 + 3] = input[i * 4 + 3];
+    }
+}
+
+/**
+ * @brief Copy the input into the chain, run it and read the output back
+ */
+bool RunChain(VkCommandBuffer cmd, const Buffer& upload, const Buffer& readback, bool fused, bool glare,
+    std::vector<uint8_t>& pixels)
+{
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    PostProcessing::PostProcessor& post = PostProcessing::PostProcessor::GetInstance();
+
+    // Rebuilds the targets when the mode changes, so fetch them afterwards.
+    post.SetFused(fused);
+    VkImage input = post.GetInputImage();
+    if (!input)
+    {
+        printf("No post-processing targets\n");
+        return false;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &beginInfo);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = input;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { WIDTH, HEIGHT, 1 };
+    vkCmdCopyBufferToImage(cmd, upload.buffer, input, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // As BeginPostProcessing() expects the scene
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    // Glare first, so both modes build the bloom from the unprocessed scene.
+    post.BeginPostProcessing(cmd);
+    if (glare) post.ApplyGlare(GLARE_STRENGTH, GLARE_SIZE, false);
+    else post.ApplyHardLight(HARD_LIGHT[0], HARD_LIGHT[1], HARD_LIGHT[2]);
+    post.ApplyDesaturation(DESATURATION);
+    post.EndPostProcessing();
+
+    // The last pass leaves the output ready to be sampled or copied.
+    barrier.image = post.GetOutputImage();
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdCopyImageToBuffer(cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+    VkBufferMemoryBarrier hostBarrier = {};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = readback.buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+    vkEndCommandBuffer(cmd);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmd;
+    VkQueue queue = renderer.GetGraphicsQueue();
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS || vkQueueWaitIdle(queue) != VK_SUCCESS)
+    {
+        printf("Post-processing submit failed (%s)\n", fused ? "fused" : "separate");
+        return false;
+    }
+
+    pixels.assign((const uint8_t*)readback.memory.mapped, (const uint8_t*)readback.memory.mapped + IMAGE_BYTES);
+    return true;
+}
+
+bool Compare(const char* name, const std::vector<uint8_t>& pixels, const std::vector<uint8_t>& expected, int tolerance)
+{
+    int worst = 0;
+    size_t worstIndex = 0;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        int difference = std::abs((int)pixels[i] - (int)expected[i]);
+        if (difference <= worst) continue;
+        worst = difference;
+        worstIndex = i;
+    }
+
+    if (worst <= tolerance) return true;
+
+    size_t pixel = worstIndex / 4;
+    printf("%s: pixel %zu,%zu channel %zu is %u, expected %u\n", name, pixel % WIDTH, pixel / WIDTH,
+        worstIndex % 4, pixels[worstIndex], expected[worstIndex]);
+    return false;
+}
+
+uint64_t Sum(const std::vector<uint8_t>& pixels)
+{
+    uint64_t sum = 0;
+    for (uint8_t value : pixels) sum += value;
+    return sum;
+}
+
+} // namespace
+
+int main()
+{
+    if (!HasVulkanDevice())
+    {
+        printf("No Vulkan device; skipping\n");
+        return EXIT_SKIPPED;
+    }
+
+    Config::ConfigManager& config = Config::ConfigManager::GetInstance();
+    config.EnsureLoaded();
+    Config::EffectSettings& effects = config.GetEffects();
+    effects.enablePostProcessing = true;
+    effects.enableHardLight = true;
+    effects.enableDesaturate = true;
+    effects.enableGlare = true;
+
+    Vulkan::Renderer& renderer = Vulkan::Renderer::GetInstance();
+    if (!renderer.InitializeHeadless(WIDTH, HEIGHT, false))
+    {
+        printf("Failed to initialize the headless renderer\n");
+        return 1;
+    }
+
+    VkDevice device = renderer.GetDevice();
+    PostProcessing::PostProcessor& post = PostProcessing::PostProcessor::GetInstance();
+    if (!post.Initialize(device, renderer.GetPhysicalDevice(), WIDTH, HEIGHT))
+    {
+        printf("Failed to initialize the post-processor\n");
+        renderer.Shutdown();
+        return 1;
+    }
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = renderer.GetGraphicsQueueFamily();
+
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    Buffer upload;
+    Buffer readback;
+    bool created = vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) == VK_SUCCESS;
+    if (created)
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        created = vkAllocateCommandBuffers(device, &allocInfo, &cmd) == VK_SUCCESS &&
+                  CreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, upload) &&
+                  CreateBuffer(device, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readback);
+    }
+
+    bool passed = false;
+    if (created)
+    {
+        uint8_t* input = (uint8_t*)upload.memory.mapped;
+        FillGradient(input);
+        std::vector<uint8_t> expected, desaturated;
+        ExpectedPixels(input, true, expected);
+        ExpectedPixels(input, false, desaturated);
+
+        std::vector<uint8_t> fused, separate, fusedGlare, separateGlare;
+        passed = RunChain(cmd, upload, readback, true, false, fused) &&
+                 RunChain(cmd, upload, readback, false, false, separate) &&
+                 RunChain(cmd, upload, readback, true, true, fusedGlare) &&
+                 RunChain(cmd, upload, readback, false, true, separateGlare);
+        if (passed)
+        {
+            passed = Compare("Fused", fused, expected, FUSED_TOLERANCE);
+            passed = Compare("Separate", separate, expected, SEPARATE_TOLERANCE) && passed;
+            passed = Compare("Separate with glare", separateGlare, fusedGlare, SEPARATE_TOLERANCE) && passed;
+            if (Sum(fusedGlare) <= Sum(desaturated))
+            {
+                printf("Glare did not brighten the image\n");
+                passed = false;
+            }
+        }
+    }
+    else
+    {
+        printf("Failed to create the test's command buffer or buffers\n");
+    }
+
+    vkDeviceWaitIdle(device);
+    DestroyBuffer(device, upload);
+    DestroyBuffer(device, readback);
+    if (commandPool) vkDestroyCommandPool(device, commandPool, nullptr);
+    post.Shutdown();
+    renderer.Shutdown();
+
+    printf("%s\n", passed ? "Post-processing output matches" : "FAILED");
+    return passed ? 0 : 1;
+}
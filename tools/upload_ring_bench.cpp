@@ -0,0 +1,211 @@
+/**
+ * @file upload_ring_bench.cpp
+ * @brief Times UploadRing sub-allocation and checks its overflow accounting
+ *
+ * Usage: ofp_upload_ring_bench [--frames N] [--draws N]
+ *
+ * The ring only needs buffers and host-visible memory, so the handful of
+ * Vulkan entry points it reaches are implemented here over malloc. That
+ * keeps the tool independent of a driver; the numbers measure the CPU
+ * side of the bump allocator, not the copies into device memory.
+ *
+ * Before timing, one frame overflows twice: the per-frame usage and
+ * high-water mark must equal the bytes handed out, however many chunks
+ * the frame was spread across.
+ */
+
+#include "../include/upload_ring.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const VkDeviceSize HEAP_SIZE = 1024ull * 1024 * 1024;
+
+struct FakeBuffer {
+    VkDeviceSize size;
+};
+
+struct FakeMemory {
+    void* data;
+};
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Vulkan entry points used by UploadRing and MemoryAllocator
+// ---------------------------------------------------------------------------
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties* properties)
+{
+    *properties = VkPhysicalDeviceMemoryProperties();
+    properties->memoryTypeCount = 1;
+    properties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    properties->memoryTypes[0].heapIndex = 0;
+    properties->memoryHeapCount = 1;
+    properties->memoryHeaps[0].size = HEAP_SIZE;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateBuffer(VkDevice, const VkBufferCreateInfo* createInfo, const VkAllocationCallbacks*, VkBuffer* buffer)
+{
+    *buffer = reinterpret_cast<VkBuffer>(new FakeBuffer{ createInfo->size });
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*)
+{
+    delete reinterpret_cast<FakeBuffer*>(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetBufferMemoryRequirements(VkDevice, VkBuffer buffer, VkMemoryRequirements* requirements)
+{
+    requirements->size = reinterpret_cast<FakeBuffer*>(buffer)->size;
+    requirements->alignment = 256;
+    requirements->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetImageMemoryRequirements(VkDevice, VkImage, VkMemoryRequirements* requirements)
+{
+    *requirements = VkMemoryRequirements();
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateMemory(VkDevice, const VkMemoryAllocateInfo* allocateInfo, const VkAllocationCallbacks*, VkDeviceMemory* memory)
+{
+    void* data = malloc((size_t)allocateInfo->allocationSize);
+    if (!data) return VK_ERROR_OUT_OF_HOST_MEMORY;
+    *memory = reinterpret_cast<VkDeviceMemory>(new FakeMemory{ data });
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkFreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+{
+    FakeMemory* fake = reinterpret_cast<FakeMemory*>(memory);
+    if (!fake) return;
+    free(fake->data);
+    delete fake;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkMapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** data)
+{
+    *data = static_cast<uint8_t*>(reinterpret_cast<FakeMemory*>(memory)->data) + offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkUnmapMemory(VkDevice, VkDeviceMemory)
+{
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize)
+{
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize)
+{
+    return VK_SUCCESS;
+}
+
+namespace {
+
+// Two overflows in one frame: 48 KB fits the 64 KB slot, the next 48 KB
+// chains a chunk, and 512 KB outgrows that chunk too.
+bool CheckOverflowAccounting()
+{
+    const VkDeviceSize sizes[] = { 48 * 1024, 48 * 1024, 512 * 1024, 16 };
+
+    Bridge::UploadRing ring;
+    if (!ring.Initialize(VK_NULL_HANDLE, VK_NULL_HANDLE, 64 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT))
+    {
+        printf("Failed to create the ring\n");
+        return false;
+    }
+
+    ring.BeginFrame(0);
+    VkDeviceSize expected = 0;
+    for (VkDeviceSize size : sizes)
+    {
+        Bridge::UploadAllocation allocation;
+        if (!ring.Allocate(size, 16, allocation))
+        {
+            printf("Allocation of %llu bytes failed\n", (unsigned long long)size);
+            return false;
+        }
+        memset(allocation.data, 0xCD, (size_t)size);
+        expected += size;
+    }
+    ring.BeginFrame(1);
+
+    const Bridge::UploadRingStats& stats = ring.GetStats();
+    bool passed = stats.growCount == 2 && stats.lastFrameBytes == expected && stats.highWaterMark == expected;
+    printf("Overflow frame: %llu bytes, high-water mark %llu, %u overflows (expected %llu, %llu, 2)\n",
+        (unsigned long long)stats.lastFrameBytes, (unsigned long long)stats.highWaterMark, stats.growCount,
+        (unsigned long long)expected, (unsigned long long)expected);
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = 2000;
+    uint32_t draws = 2000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)
+        {
+            draws = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            printf("Usage: ofp_upload_ring_bench [--frames N] [--draws N]\n");
+            return 1;
+        }
+    }
+    if (frames == 0 || draws == 0)
+    {
+        printf("--frames and --draws must be positive\n");
+        return 1;
+    }
+
+    Vulkan::MemoryAllocator::GetInstance().Initialize(VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+    bool passed = CheckOverflowAccounting();
+
+    // A UP draw's vertices and indices, sized like OFP's particles and HUD
+    Bridge::UploadRing ring;
+    if (!ring.Initialize(VK_NULL_HANDLE, VK_NULL_HANDLE, 1024 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+    {
+        printf("Failed to create the ring\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        ring.BeginFrame(frame % Vulkan::MAX_FRAMES_IN_FLIGHT);
+        for (uint32_t i = 0; i < draws; i++)
+        {
+            Bridge::UploadAllocation vertices, indices;
+            ring.Allocate(4 * 32 + (i & 7) * 32, 32, vertices);
+            ring.Allocate(6 * 2, 4, indices);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Bridge::UploadRingStats& stats = ring.GetStats();
+    printf("%-32s %8.2f ns/allocation\n", "UploadRing::Allocate", seconds * 1e9 / ((double)frames * draws * 2));
+    printf("Capacity %llu KB, high-water mark %llu KB, %u overflows\n",
+        (unsigned long long)(stats.capacity / 1024), (unsigned long long)(stats.highWaterMark / 1024), stats.growCount);
+
+    ring.Shutdown();
+    Vulkan::MemoryAllocator::GetInstance().Shutdown();
+
+    printf("%s\n", passed ? "Overflow accounting matches the bytes allocated" : "FAILED");
+    return passed ? 0 : 1;
+}